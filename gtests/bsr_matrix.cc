@@ -0,0 +1,113 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/bsr_matrix.h"
+
+#include <deal.II/base/quadrature_lib.h>
+
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_system.h>
+#include <deal.II/fe/mapping_q.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/sparse_matrix.h>
+
+#include <deal.II/numerics/matrix_tools.h>
+
+#include <gtest/gtest.h>
+
+using namespace dealii;
+
+TEST(BSRMatrix, VmultAndSmoothers)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(3);
+
+  MappingQ<dim>   mapping_q1(1);
+  FESystem<dim>   fe(FE_Q<dim>(1), dim);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(fe);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+
+  // Make the matrix nonsymmetric, to check the transpose product
+  A.add(0, 1, 1.0);
+
+  ParsedLAC::BSRMatrix bsr;
+  bsr.initialize(A, dim);
+  EXPECT_EQ(bsr.m(), A.m());
+  EXPECT_EQ(bsr.n(), A.n());
+  EXPECT_EQ(bsr.n_block_rows(), A.m() / dim);
+  // All components of a node are coupled: the blocks contain no zeros
+  EXPECT_EQ(bsr.n_blocks() * dim * dim, A.n_nonzero_elements());
+
+  Vector<double> u(dof_handler.n_dofs());
+  for (unsigned int i = 0; i < u.size(); ++i)
+    u[i] = (double)(i + 1);
+
+  Vector<double> v(u.size()), w(u.size());
+  A.vmult(v, u);
+  bsr.vmult(w, u);
+  w -= v;
+  EXPECT_LT(w.l2_norm(), 1e-12 * v.l2_norm());
+
+  A.Tvmult(v, u);
+  bsr.Tvmult(w, u);
+  w -= v;
+  EXPECT_LT(w.l2_norm(), 1e-12 * v.l2_norm());
+
+  A.vmult(v, u);
+  w = v;
+  bsr.vmult_add(w, u);
+  w.add(-2.0, v);
+  EXPECT_LT(w.l2_norm(), 1e-12 * v.l2_norm());
+
+  // Symmetric smoothers as preconditioners for CG on the mass matrix
+  A.add(0, 1, -1.0);
+  bsr.initialize(A, dim);
+  for (const auto type : {ParsedLAC::BSRSmoother::Type::jacobi,
+                          ParsedLAC::BSRSmoother::Type::symmetric_gauss_seidel})
+    {
+      ParsedLAC::BSRSmoother smoother;
+      smoother.initialize(bsr, type);
+
+      SolverControl            control(100, 1e-10 * u.l2_norm());
+      SolverCG<Vector<double>> cg(control);
+      Vector<double>           x(u.size());
+      cg.solve(bsr, x, u, smoother);
+
+      A.vmult(v, x);
+      v -= u;
+      EXPECT_LT(v.l2_norm(), 1e-8 * u.l2_norm());
+    }
+}
@@ -70,4 +70,27 @@ TEST(Constants, FunctionAndConstants)
 
   ASSERT_EQ(constants["c"], 0.0);
   ASSERT_EQ(function.value(p), 3.0);
-}
\ No newline at end of file
+}
+
+TEST(Constants, Handles)
+{
+  ParsedTools::Constants constants("/Handles", {"a", "b"}, {1.0, 2.0});
+
+  const auto a = constants.get_handle("a");
+  const auto b = constants.get_handle("b");
+  ASSERT_EQ(a, 1.0);
+  ASSERT_EQ(b, 2.0);
+  ASSERT_EQ(constants.get_handle("PI"), numbers::PI);
+  ASSERT_ANY_THROW(constants.get_handle("d"));
+
+  // Handles see the values parsed after they were created
+  ParameterAcceptor::prm.parse_input_from_string(R"(
+    subsection Handles
+      set a = 3
+      set b = 4
+    end
+  )");
+
+  ASSERT_EQ(a, 3.0);
+  ASSERT_EQ(b * a, 12.0);
+}
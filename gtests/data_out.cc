@@ -27,7 +27,9 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 
 #include "dim_spacedim_tester.h"
@@ -72,3 +74,187 @@ TYPED_TEST(DimSpacedimTester, DataOut)
     check_and_remove(fname + ".pvd");
   }
 }
+
+
+
+TYPED_TEST(DimSpacedimTester, DataOutAsynchronous)
+{
+  Triangulation<TestFixture::dim, TestFixture::spacedim> tria;
+  GridGenerator::hyper_cube(tria);
+  FE_Q<TestFixture::dim, TestFixture::spacedim>       fe(1);
+  DoFHandler<TestFixture::dim, TestFixture::spacedim> dof_handler(tria);
+  dof_handler.distribute_dofs(fe);
+  Vector<double> solution(dof_handler.n_dofs());
+  ParsedTools::DataOut<TestFixture::dim, TestFixture::spacedim> pdo(this->id());
+  ParameterAcceptor::initialize();
+
+  std::stringstream ss;
+  ss << "pdo_async_" << TestFixture::dim << "_" << TestFixture::spacedim;
+  const auto fname = ss.str();
+
+  this->parse("set Problem base name = " + fname + "\n" +
+                "set Output format = vtu\n" +
+                "set Asynchronous output = true\n" +
+                "set Output queue size = 1",
+              pdo);
+
+  for (unsigned int i = 0; i < 3; ++i)
+    {
+      pdo.attach_dof_handler(dof_handler, std::to_string(i));
+      pdo.add_data_vector(solution, "solution");
+      pdo.write_data_and_clear();
+    }
+  pdo.flush();
+
+  for (unsigned int i = 0; i < 3; ++i)
+    {
+      const auto name = fname + "_" + std::to_string(i) + ".vtu";
+      ASSERT_TRUE(std::ifstream(name));
+      std::remove(name.c_str());
+    }
+
+  // The pvd file contains all records
+  std::ifstream pvd(fname + ".pvd");
+  ASSERT_TRUE(pvd);
+  const std::string content((std::istreambuf_iterator<char>(pvd)),
+                            std::istreambuf_iterator<char>());
+  for (unsigned int i = 0; i < 3; ++i)
+    EXPECT_NE(content.find(fname + "_" + std::to_string(i) + ".vtu"),
+              std::string::npos);
+  EXPECT_NE(content.find("</VTKFile>"), std::string::npos);
+  std::remove((fname + ".pvd").c_str());
+}
+
+
+
+TYPED_TEST(DimSpacedimTester, DataOutAsynchronousError)
+{
+  Triangulation<TestFixture::dim, TestFixture::spacedim> tria;
+  GridGenerator::hyper_cube(tria);
+  FE_Q<TestFixture::dim, TestFixture::spacedim>       fe(1);
+  DoFHandler<TestFixture::dim, TestFixture::spacedim> dof_handler(tria);
+  dof_handler.distribute_dofs(fe);
+  Vector<double> solution(dof_handler.n_dofs());
+  ParsedTools::DataOut<TestFixture::dim, TestFixture::spacedim> pdo(this->id());
+  ParameterAcceptor::initialize();
+
+  std::stringstream ss;
+  ss << "pdo_async_error_" << TestFixture::dim << "_" << TestFixture::spacedim;
+  const auto fname = ss.str();
+
+  this->parse("set Problem base name = " + fname + "\n" +
+                "set Output format = vtu\n" +
+                "set Asynchronous output = true",
+              pdo);
+
+  // A directory with the name of the output file cannot be opened for
+  // writing, and the background thread fails
+  const auto blocked = fname + "_0.vtu";
+  std::filesystem::create_directory(blocked);
+  pdo.attach_dof_handler(dof_handler, "0");
+  pdo.add_data_vector(solution, "solution");
+  pdo.write_data_and_clear();
+  EXPECT_ANY_THROW(pdo.flush());
+  std::filesystem::remove(blocked);
+
+  // The error is reported only once, and the next outputs are written
+  EXPECT_NO_THROW(pdo.flush());
+  pdo.attach_dof_handler(dof_handler, "1");
+  pdo.add_data_vector(solution, "solution");
+  pdo.write_data_and_clear();
+  EXPECT_NO_THROW(pdo.flush());
+  ASSERT_TRUE(std::ifstream(fname + "_1.vtu"));
+  std::remove((fname + "_1.vtu").c_str());
+  std::remove((fname + ".pvd").c_str());
+}
+
+
+
+#ifdef DEAL_II_WITH_HDF5
+TEST(DataOut, ResumeXdmfRecord)
+{
+  Triangulation<2> tria;
+  GridGenerator::hyper_cube(tria);
+  FE_Q<2>       fe(1);
+  DoFHandler<2> dof_handler(tria);
+  dof_handler.distribute_dofs(fe);
+  Vector<double>          solution(dof_handler.n_dofs());
+  ParsedTools::DataOut<2> pdo("/DataOut/ResumeXdmfRecord");
+  ParameterAcceptor::initialize();
+
+  const std::string fname = "pdo_resume_xdmf";
+  parse("set Problem base name = " + fname + "\n" +
+          "set Output format = hdf5",
+        pdo);
+
+  auto write = [&](const unsigned int i) {
+    pdo.attach_dof_handler(dof_handler, std::to_string(i));
+    pdo.add_data_vector(solution, "solution");
+    pdo.write_data_and_clear();
+  };
+
+  auto count_time_steps = [&]() {
+    std::ifstream     xdmf(fname + ".xdmf");
+    const std::string content((std::istreambuf_iterator<char>(xdmf)),
+                              std::istreambuf_iterator<char>());
+    const std::string key = "GridType=\"Uniform\"";
+    unsigned int      n   = 0;
+    auto              p   = content.find(key);
+    while (p != std::string::npos)
+      {
+        ++n;
+        p = content.find(key, p + 1);
+      }
+    return n;
+  };
+
+  for (unsigned int i = 0; i < 3; ++i)
+    write(i);
+  EXPECT_EQ(count_time_steps(), 3u);
+
+  // Restart from the second output: the third one is replaced
+  pdo.resume_pvd_record(2);
+  write(2);
+  EXPECT_EQ(count_time_steps(), 3u);
+  write(3);
+  EXPECT_EQ(count_time_steps(), 4u);
+
+  for (unsigned int i = 0; i < 4; ++i)
+    std::remove((fname + "_" + std::to_string(i) + ".h5").c_str());
+  for (unsigned int i = 0; i < 4; ++i)
+    std::remove((fname + "_" + std::to_string(i) + "_mesh.h5").c_str());
+  std::remove((fname + ".xdmf").c_str());
+}
+#endif
+
+
+
+TYPED_TEST(DimSpacedimTester, DataOutParallelVtu)
+{
+  Triangulation<TestFixture::dim, TestFixture::spacedim> tria;
+  GridGenerator::hyper_cube(tria);
+  FE_Q<TestFixture::dim, TestFixture::spacedim>       fe(1);
+  DoFHandler<TestFixture::dim, TestFixture::spacedim> dof_handler(tria);
+  dof_handler.distribute_dofs(fe);
+  Vector<double> solution(dof_handler.n_dofs());
+  ParsedTools::DataOut<TestFixture::dim, TestFixture::spacedim> pdo(this->id());
+  ParameterAcceptor::initialize();
+
+  std::stringstream ss;
+  ss << "pdo_parallel_" << TestFixture::dim << "_" << TestFixture::spacedim;
+  const auto fname = ss.str();
+
+  this->parse("set Problem base name = " + fname + "\n" +
+                "set Output format = parallel vtu",
+              pdo);
+
+  pdo.attach_dof_handler(dof_handler, "0");
+  pdo.add_data_vector(solution, "solution");
+  pdo.write_data_and_clear();
+
+  // A single file is written, and referenced in the pvd file
+  ASSERT_TRUE(std::ifstream(fname + "_0.vtu"));
+  std::remove((fname + "_0.vtu").c_str());
+  ASSERT_TRUE(std::ifstream(fname + ".pvd"));
+  std::remove((fname + ".pvd").c_str());
+}
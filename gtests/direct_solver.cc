@@ -0,0 +1,131 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/direct_solver.h"
+
+#include <deal.II/base/quadrature_lib.h>
+
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/mapping_q.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/linear_operator_tools.h>
+#include <deal.II/lac/sparse_matrix.h>
+
+#include <deal.II/numerics/matrix_tools.h>
+
+#include <gtest/gtest.h>
+
+using namespace dealii;
+
+TEST(DirectSolver, ReuseFactorization)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(2);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+
+  QGauss<dim> quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+
+  ParsedLAC::DirectSolver direct("/", true);
+  ASSERT_TRUE(direct.enabled());
+
+  const auto op_a  = linear_operator<Vector<double>>(A);
+  const auto inv_a = linear_operator<Vector<double>>(op_a, direct);
+
+  Vector<double> u(dof_handler.n_dofs());
+  for (unsigned int i = 0; i < u.size(); ++i)
+    u[i] = (double)(i + 1);
+
+  // Same matrix: a single factorization.
+  for (unsigned int k = 0; k < 3; ++k)
+    {
+      direct.initialize(A);
+      Vector<double> v     = inv_a * u;
+      Vector<double> new_u = op_a * v;
+      new_u -= u;
+      EXPECT_NEAR(new_u.l2_norm(), 0.0, 1e-10 * u.l2_norm());
+    }
+  EXPECT_EQ(direct.n_factorizations(), 1u);
+
+  // Changing the values triggers a new factorization.
+  A *= 2.0;
+  direct.initialize(A);
+  EXPECT_EQ(direct.n_factorizations(), 2u);
+  Vector<double> v     = inv_a * u;
+  Vector<double> new_u = op_a * v;
+  new_u -= u;
+  EXPECT_NEAR(new_u.l2_norm(), 0.0, 1e-10 * u.l2_norm());
+}
+
+
+
+TEST(DirectSolver, MatrixChecksum)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(2);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+
+  QGauss<dim> quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+
+  ParsedLAC::MatrixChecksum checksum;
+  EXPECT_TRUE(checksum.update(A));
+  EXPECT_FALSE(checksum.update(A));
+
+  // Flipping the sign of an entry does not change the Frobenius norm
+  const double norm = A.frobenius_norm();
+  A.set(0, 0, -A(0, 0));
+  EXPECT_DOUBLE_EQ(A.frobenius_norm(), norm);
+  EXPECT_TRUE(checksum.update(A));
+  EXPECT_FALSE(checksum.update(A));
+
+  checksum.clear();
+  EXPECT_TRUE(checksum.update(A));
+}
@@ -0,0 +1,101 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_tools/dof_renumbering.h"
+
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/distributed/tria.h>
+
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_renumbering.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_system.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace dealii;
+
+TEST(DoFRenumbering, LocallyOwnedDoFsAreUnchanged)
+{
+  static const int dim = 2;
+
+  parallel::distributed::Triangulation<dim> triangulation(MPI_COMM_WORLD);
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(4);
+
+  FESystem<dim>   fe(FE_Q<dim>(2), dim);
+  DoFHandler<dim> dof_handler(triangulation);
+
+  const std::vector<unsigned int> blocks(dim, 0);
+  for (const std::string type :
+       {"none", "cuthill_mckee", "hilbert", "morton", "downstream"})
+    {
+      dof_handler.distribute_dofs(fe);
+      const IndexSet owned = dof_handler.locally_owned_dofs();
+
+      ParsedTools::DoFRenumbering<dim> renumbering("/DoFRenumbering/" + type,
+                                                   type);
+      renumbering.renumber(dof_handler, blocks);
+
+      EXPECT_EQ(dof_handler.locally_owned_dofs(), owned) << type;
+      EXPECT_EQ(dof_handler.n_dofs(), owned.size()) << type;
+    }
+}
+
+
+
+TEST(DoFRenumbering, CuthillMcKeeReducesBandwidth)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(4);
+
+  FESystem<dim>   fe(FE_Q<dim>(2), dim);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(fe);
+
+  // Start from a numbering with a large bandwidth, that also separates the
+  // components of the nodes
+  const std::vector<unsigned int> blocks(dim, 0);
+  dealii::DoFRenumbering::random(dof_handler);
+  const auto bandwidth_before =
+    ParsedTools::DoFRenumbering<dim>::bandwidth(dof_handler, blocks);
+  EXPECT_FALSE(
+    ParsedTools::DoFRenumbering<dim>::is_node_interleaved(dof_handler, dim));
+
+  ParsedTools::DoFRenumbering<dim> renumbering("/DoFRenumbering/Bandwidth",
+                                               "cuthill_mckee");
+  renumbering.renumber(dof_handler, blocks);
+
+  const auto bandwidth_after =
+    ParsedTools::DoFRenumbering<dim>::bandwidth(dof_handler, blocks);
+  EXPECT_LT(bandwidth_after, bandwidth_before);
+  // A band of a few rows of nodes around the diagonal
+  EXPECT_LT(bandwidth_after, dof_handler.n_dofs() / 4);
+
+  // The components of each node are numbered consecutively
+  EXPECT_TRUE(
+    ParsedTools::DoFRenumbering<dim>::is_node_interleaved(dof_handler, dim));
+}
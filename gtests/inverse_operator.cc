@@ -31,13 +31,17 @@
 #include <deal.II/lac/linear_operator_tools.h>
 #include <deal.II/lac/precondition.h>
 #include <deal.II/lac/solver_cg.h>
+#include <deal.II/lac/solver_control.h>
 #include <deal.II/lac/sparse_matrix.h>
 
 #include <deal.II/numerics/matrix_tools.h>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <memory>
 #include <sstream>
 
 using namespace dealii;
@@ -87,4 +91,286 @@ TEST(InverseOperator, InvertPoisson)
     {
       EXPECT_NEAR(u[i], new_u[i], 1e-12 * u.l2_norm());
     }
-}
\ No newline at end of file
+}
+
+
+
+TEST(InverseOperator, CommunicationReducingSolvers)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(4);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  // A symmetric positive definite matrix: mass plus stiffness.
+  SparseMatrix<double> A(sparsity_pattern);
+  SparseMatrix<double> K(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+  MatrixCreator::create_laplace_matrix(mapping_q1,
+                                       dof_handler,
+                                       quadrature,
+                                       K);
+  A.add(1.0, K);
+
+  PreconditionSSOR<SparseMatrix<double>> prec;
+  prec.initialize(A);
+
+  const auto op_a = linear_operator<Vector<double>>(A);
+
+  Vector<double> u(dof_handler.n_dofs());
+  for (unsigned int i = 0; i < u.size(); ++i)
+    u[i] = (double)(i + 1);
+
+  for (const std::string name : {"pipecg", "sstepcg", "srgmres"})
+    {
+      ParsedLAC::InverseOperator inverse("/" + name, name);
+
+      const auto     inv_a = inverse(op_a, prec, 1e-10 * u.l2_norm());
+      Vector<double> v     = inv_a * u;
+      Vector<double> res   = op_a * v;
+      res -= u;
+      EXPECT_LT(res.l2_norm(), 1e-9 * u.l2_norm()) << name;
+
+      // The same through the solve() interface
+      Vector<double> w(u.size());
+      inverse.solve(A, prec, u, w, 1e-10 * u.l2_norm());
+      w -= v;
+      EXPECT_LT(w.l2_norm(), 1e-8 * v.l2_norm()) << name;
+    }
+
+  // Different s-step sizes and restart lengths
+  for (const unsigned int s : {1u, 2u, 3u})
+    {
+      SolverControl control(1000, 1e-10 * u.l2_norm());
+
+      ParsedLAC::SolverSStepCG<Vector<double>> solver(
+        control, ParsedLAC::SolverSStepCG<Vector<double>>::AdditionalData(s));
+      Vector<double> v(u.size());
+      solver.solve(A, v, u, prec);
+      Vector<double> res = op_a * v;
+      res -= u;
+      EXPECT_LT(res.l2_norm(), 1e-9 * u.l2_norm()) << s;
+    }
+
+  {
+    SolverControl control(1000, 1e-10 * u.l2_norm());
+
+    ParsedLAC::SolverSingleReductionGMRES<Vector<double>> solver(
+      control,
+      ParsedLAC::SolverSingleReductionGMRES<Vector<double>>::AdditionalData(5));
+    Vector<double> v(u.size());
+    solver.solve(A, v, u, prec);
+    Vector<double> res = op_a * v;
+    res -= u;
+    EXPECT_LT(res.l2_norm(), 1e-9 * u.l2_norm());
+  }
+}
+
+
+
+TEST(InverseOperator, DeflatedCGRecycling)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(4);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+  SparseMatrix<double> K(sparsity_pattern);
+  SparseMatrix<double> M(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, M);
+  MatrixCreator::create_laplace_matrix(mapping_q1,
+                                       dof_handler,
+                                       quadrature,
+                                       K);
+
+  ParsedLAC::InverseOperator inverse("/Deflated", "dcg");
+
+  // A sequence of slowly changing operators, as in a quasi-static problem
+  for (unsigned int step = 0; step < 6; ++step)
+    {
+      A.copy_from(K);
+      A.add(1.0 + 0.01 * step, M);
+      const auto op_a = linear_operator<Vector<double>>(A);
+
+      Vector<double> u(dof_handler.n_dofs());
+      for (unsigned int i = 0; i < u.size(); ++i)
+        u[i] = std::sin(1.0 + i + step);
+
+      const auto inv_a =
+        inverse(op_a, PreconditionIdentity(), 1e-10 * u.l2_norm());
+      Vector<double> v   = inv_a * u;
+      Vector<double> res = op_a * v;
+      res -= u;
+      EXPECT_LT(res.l2_norm(), 1e-9 * u.l2_norm()) << step;
+    }
+
+  const auto space = inverse.get_deflation_space<Vector<double>>();
+  EXPECT_EQ(space->n_solves, 6u);
+  EXPECT_EQ(space->vectors.size(), 8u);
+  EXPECT_LT(space->last_iterations, space->reference_iterations);
+  EXPECT_GT(space->saved_iterations, 0);
+}
+
+
+
+TEST(InverseOperator, BlockCG)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(4);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+  SparseMatrix<double> K(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+  MatrixCreator::create_laplace_matrix(mapping_q1,
+                                       dof_handler,
+                                       quadrature,
+                                       K);
+  A.add(1.0, K);
+
+  PreconditionSSOR<SparseMatrix<double>> prec;
+  prec.initialize(A);
+
+  // Three right hand sides, the last one linearly dependent on the others
+  const unsigned int          n = dof_handler.n_dofs();
+  std::vector<Vector<double>> b(3, Vector<double>(n));
+  for (unsigned int i = 0; i < n; ++i)
+    {
+      b[0][i] = std::sin(1.0 + i);
+      b[1][i] = std::cos(2.0 * i);
+      b[2][i] = b[0][i] - 2 * b[1][i];
+    }
+  double max_norm = 0;
+  for (const auto &v : b)
+    max_norm = std::max(max_norm, v.l2_norm());
+
+  ParsedLAC::InverseOperator  inverse("/Block", "cg");
+  std::vector<Vector<double>> x(3, Vector<double>(n));
+  inverse.solve_block(A, prec, b, x, 1e-10 * max_norm);
+
+  Vector<double> res(n);
+  for (unsigned int j = 0; j < 3; ++j)
+    {
+      A.vmult(res, x[j]);
+      res -= b[j];
+      EXPECT_LT(res.l2_norm(), 1e-9 * max_norm) << j;
+    }
+
+  // The block method needs fewer iterations than the independent solves
+  SolverControl               block_control(1000, 1e-10 * max_norm);
+  ParsedLAC::SolverBlockCG<>  block_solver(block_control);
+  std::vector<Vector<double>> y(3, Vector<double>(n));
+  block_solver.solve(A, y, b, prec);
+
+  SolverControl  control(1000, 1e-10 * max_norm);
+  SolverCG<>     solver(control);
+  Vector<double> z(n);
+  solver.solve(A, z, b[0], prec);
+  EXPECT_LE(block_control.last_step(), control.last_step());
+}
+
+
+
+TEST(InverseOperator, DeflatedCGConstantOperator)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(4);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+  SparseMatrix<double> M(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, M);
+  MatrixCreator::create_laplace_matrix(mapping_q1,
+                                       dof_handler,
+                                       quadrature,
+                                       A);
+  A.add(1.0, M);
+
+  // Count the products with the operator
+  unsigned int n_products = 0;
+  auto         op_a       = linear_operator<Vector<double>>(A);
+  op_a.vmult = [&](Vector<double> &dst, const Vector<double> &src) {
+    ++n_products;
+    A.vmult(dst, src);
+  };
+
+  const auto space =
+    std::make_shared<ParsedLAC::DeflationSpace<Vector<double>>>();
+  const ParsedLAC::SolverDeflatedCG<Vector<double>>::AdditionalData data(
+    8, 5, false, true);
+
+  for (unsigned int step = 0; step < 6; ++step)
+    {
+      Vector<double> u(dof_handler.n_dofs());
+      for (unsigned int i = 0; i < u.size(); ++i)
+        u[i] = std::sin(1.0 + i + step);
+
+      SolverControl control(1000, 1e-10 * u.l2_norm());
+      ParsedLAC::SolverDeflatedCG<Vector<double>> solver(control, space, data);
+
+      Vector<double> v(u.size());
+      n_products = 0;
+      solver.solve(op_a, v, u, PreconditionIdentity());
+
+      // One product for the initial residual, and one per iteration: the
+      // deflation space is never multiplied by the operator again
+      EXPECT_EQ(n_products, control.last_step() + 1) << step;
+
+      Vector<double> res(u.size());
+      A.vmult(res, v);
+      res -= u;
+      EXPECT_LT(res.l2_norm(), 1e-9 * u.l2_norm()) << step;
+    }
+  EXPECT_GT(space->saved_iterations, 0);
+}
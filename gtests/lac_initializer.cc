@@ -0,0 +1,129 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include <deal.II/base/config.h>
+
+#ifdef DEAL_II_WITH_PETSC
+
+#  include "lac_initializer.h"
+
+#  include <deal.II/base/mpi.h>
+
+#  include <deal.II/distributed/tria.h>
+
+#  include <deal.II/dofs/dof_handler.h>
+#  include <deal.II/dofs/dof_renumbering.h>
+#  include <deal.II/dofs/dof_tools.h>
+
+#  include <deal.II/fe/fe_q.h>
+#  include <deal.II/fe/fe_system.h>
+
+#  include <deal.II/grid/grid_generator.h>
+
+#  include <deal.II/lac/affine_constraints.h>
+#  include <deal.II/lac/dynamic_sparsity_pattern.h>
+
+#  include <gtest/gtest.h>
+
+#  include <set>
+#  include <vector>
+
+using namespace dealii;
+
+// Run with two or more processes to test the distributed path of the
+// BlockInitializer: the rows of the sparsity pattern that are built by a
+// process, but owned by another one, are sent to their owner.
+TEST(LACInitializerMPI, PETScSparsityPattern)
+{
+  static const int dim  = 2;
+  const MPI_Comm   comm = MPI_COMM_WORLD;
+  const auto       rank = Utilities::MPI::this_mpi_process(comm);
+
+  parallel::distributed::Triangulation<dim> triangulation(comm);
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(3);
+
+  // Two blocks, with a different number of degrees of freedom
+  FESystem<dim>   fe(FE_Q<dim>(2), 1, FE_Q<dim>(1), 1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(fe);
+
+  const std::vector<unsigned int> blocks = {0, 1};
+  dealii::DoFRenumbering::component_wise(dof_handler, blocks);
+  const std::vector<types::global_dof_index> dofs_per_block =
+    DoFTools::count_dofs_per_fe_block(dof_handler, blocks);
+
+  IndexSet relevant_set;
+  DoFTools::extract_locally_relevant_dofs(dof_handler, relevant_set);
+  const std::vector<IndexSet> owned =
+    dof_handler.locally_owned_dofs().split_by_block(dofs_per_block);
+  const std::vector<IndexSet> relevant =
+    relevant_set.split_by_block(dofs_per_block);
+
+  AffineConstraints<double> constraints(relevant_set);
+  constraints.close();
+
+  Table<2, DoFTools::Coupling> coupling(2, 2);
+  coupling.fill(DoFTools::always);
+
+  LAC::BlockInitializer initializer(dofs_per_block, owned, relevant, comm);
+
+  LAC::LAPETSc::BlockSparsityPattern sparsity;
+  LAC::LAPETSc::BlockSparseMatrix    matrix;
+  initializer(sparsity, dof_handler, constraints, coupling);
+  initializer(sparsity, matrix);
+
+  // The whole pattern, built from the locally owned cells of all processes
+  const auto             n_dofs = dof_handler.n_dofs();
+  DynamicSparsityPattern local_dsp(n_dofs, n_dofs);
+  DoFTools::make_sparsity_pattern(
+    dof_handler, local_dsp, constraints, false, rank);
+  std::vector<unsigned int> whole(n_dofs * n_dofs, 0);
+  for (const auto &entry : local_dsp)
+    whole[entry.row() * n_dofs + entry.column()] = 1;
+  whole = Utilities::MPI::sum(whole, comm);
+
+  std::vector<types::global_dof_index> shifts = {0, dofs_per_block[0]};
+  types::global_dof_index              n_local_nonzeros = 0;
+  for (unsigned int b = 0; b < 2; ++b)
+    for (const auto i : owned[b])
+      {
+        const auto row = shifts[b] + i;
+
+        std::set<types::global_dof_index> columns;
+        for (unsigned int c = 0; c < 2; ++c)
+          for (auto entry = matrix.block(b, c).begin(i);
+               entry != matrix.block(b, c).end(i);
+               ++entry)
+            columns.insert(shifts[c] + entry->column());
+
+        std::set<types::global_dof_index> expected;
+        for (types::global_dof_index j = 0; j < n_dofs; ++j)
+          if (whole[row * n_dofs + j] > 0)
+            expected.insert(j);
+
+        EXPECT_EQ(columns, expected) << "Row " << row << " on process "
+                                     << rank;
+        n_local_nonzeros += expected.size();
+      }
+
+  // All the rows are owned by some process
+  types::global_dof_index n_whole_nonzeros = 0;
+  for (const auto w : whole)
+    n_whole_nonzeros += (w > 0);
+  EXPECT_EQ(Utilities::MPI::sum(n_local_nonzeros, comm), n_whole_nonzeros);
+}
+
+#endif
@@ -0,0 +1,90 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/mixed_precision.h"
+
+#include <deal.II/base/quadrature_lib.h>
+
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/mapping_q.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/linear_operator_tools.h>
+#include <deal.II/lac/sparse_matrix.h>
+
+#include <deal.II/numerics/matrix_tools.h>
+
+#include <gtest/gtest.h>
+
+#include "parsed_lac/inverse_operator.h"
+
+using namespace dealii;
+
+TEST(MixedPrecisionPreconditioner, DoublePrecisionAccuracy)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(4);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  // A symmetric positive definite matrix: mass plus stiffness.
+  SparseMatrix<double> A(sparsity_pattern);
+  SparseMatrix<double> K(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+  MatrixCreator::create_laplace_matrix(mapping_q1,
+                                       dof_handler,
+                                       quadrature,
+                                       K);
+  A.add(1.0, K);
+
+  const auto op_a = linear_operator<Vector<double>>(A);
+
+  Vector<double> u(dof_handler.n_dofs());
+  for (unsigned int i = 0; i < u.size(); ++i)
+    u[i] = (double)(i + 1);
+
+  for (const std::string type : {"jacobi", "ssor", "ilu"})
+    {
+      ParsedLAC::MixedPrecisionPreconditioner prec("/" + type, true, type);
+      ParsedLAC::InverseOperator inverse("/" + type, "fgmres");
+      ASSERT_TRUE(prec.enabled());
+      prec.initialize(A);
+
+      // The tolerance is well below single precision accuracy.
+      const auto     inv_a = inverse(op_a, prec, 1e-12 * u.l2_norm());
+      Vector<double> v     = inv_a * u;
+      Vector<double> res   = op_a * v;
+      res -= u;
+      EXPECT_LT(res.l2_norm(), 1e-11 * u.l2_norm()) << type;
+    }
+}
@@ -17,10 +17,14 @@
 
 #include "projection_operator.h"
 
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/la_parallel_vector.h>
 #include <deal.II/lac/vector.h>
 
 #include <gtest/gtest.h>
 
+#include <cmath>
 #include <fstream>
 #include <sstream>
 
@@ -85,3 +89,171 @@ TEST(ProjectionOperator, ProjectionOnSubspace)
   // again, q should have the same norm as w
   ASSERT_DOUBLE_EQ(p.l2_norm(), w_norm);
 }
+
+
+
+TEST(ProjectionOperator, ManyBasisVectors)
+{
+  // Compare with the dot products and linear combinations computed vector by
+  // vector, using a non orthogonal basis.
+  const unsigned int          N = 37;
+  const unsigned int          M = 11;
+  std::vector<Vector<double>> v(M, Vector<double>(N));
+  for (unsigned int i = 0; i < M; ++i)
+    for (unsigned int j = 0; j < N; ++j)
+      v[i][j] = std::sin(1.0 + i * N + j);
+  std::vector<std::reference_wrapper<const Vector<double>>> basis(v.begin(),
+                                                                  v.end());
+  Vector<double> w(M);
+  Vector<double> x(N);
+  for (unsigned int j = 0; j < N; ++j)
+    x[j] = std::cos(1.0 + j);
+  for (unsigned int i = 0; i < M; ++i)
+    w[i] = i + 1.0;
+
+  auto C  = projection_operator(w, basis);
+  auto Ct = transpose_operator(C);
+
+  Vector<double> p = C * x;
+  Vector<double> y = Ct * w;
+
+  Vector<double> y_expected(N);
+  for (unsigned int i = 0; i < M; ++i)
+    {
+      ASSERT_NEAR(p[i], v[i] * x, 1e-12);
+      y_expected.add(w[i], v[i]);
+    }
+  y -= y_expected;
+  ASSERT_NEAR(y.l2_norm(), 0.0, 1e-12);
+
+  // The _add variants accumulate on the destination.
+  Vector<double> p_add = p;
+  C.vmult_add(p_add, x);
+  p_add.add(-2.0, p);
+  ASSERT_NEAR(p_add.l2_norm(), 0.0, 1e-12);
+}
+
+
+
+TEST(ProjectionOperator, IndependentOperators)
+{
+  // Two operators with different range sizes must not share any state.
+  const unsigned int          N = 5;
+  std::vector<Vector<double>> v(3, Vector<double>(N));
+  for (unsigned int i = 0; i < 3; ++i)
+    v[i][i] = 1;
+  std::vector<std::reference_wrapper<const Vector<double>>> basis3(v.begin(),
+                                                                   v.end());
+  std::vector<std::reference_wrapper<const Vector<double>>> basis2(v.begin(),
+                                                                   v.begin() +
+                                                                     2);
+  Vector<double> w3(3);
+  Vector<double> w2(2);
+  Vector<double> x(N);
+  for (unsigned int i = 0; i < N; ++i)
+    x[i] = i + 1.0;
+
+  const auto C3 = projection_operator(w3, basis3);
+  const auto C2 = projection_operator(w2, basis2);
+
+  const Vector<double> p3 = C3 * x;
+  const Vector<double> p2 = C2 * x;
+  ASSERT_EQ(p3.size(), 3u);
+  ASSERT_EQ(p2.size(), 2u);
+  for (unsigned int i = 0; i < 2; ++i)
+    ASSERT_DOUBLE_EQ(p2[i], p3[i]);
+  ASSERT_DOUBLE_EQ(p3[2], 3.0);
+}
+
+
+
+TEST(ProjectionOperator, DistributedRange)
+{
+  // Serial domain, and a range space distributed among all processes. Each
+  // process provides the basis vectors of the range elements it owns.
+  using RangeVector = LinearAlgebra::distributed::Vector<double>;
+
+  const MPI_Comm     comm    = MPI_COMM_WORLD;
+  const unsigned int n_procs = Utilities::MPI::n_mpi_processes(comm);
+  const unsigned int rank    = Utilities::MPI::this_mpi_process(comm);
+  const unsigned int N       = 7;
+  const unsigned int M       = 2 * n_procs + 1;
+
+  const IndexSet owned =
+    Utilities::create_evenly_distributed_partitioning(rank, n_procs, M);
+  RangeVector w(owned, comm);
+
+  std::vector<Vector<double>> v(M, Vector<double>(N));
+  for (unsigned int i = 0; i < M; ++i)
+    for (unsigned int j = 0; j < N; ++j)
+      v[i][j] = std::sin(1.0 + i * N + j);
+
+  std::vector<std::reference_wrapper<const Vector<double>>> basis;
+  for (const auto i : owned)
+    basis.emplace_back(std::cref(v[i]));
+
+  Vector<double> x(N);
+  for (unsigned int j = 0; j < N; ++j)
+    x[j] = std::cos(1.0 + j);
+
+  const auto C = projection_operator(w, basis, &x);
+
+  RangeVector p(owned, comm);
+  C.vmult(p, x);
+  for (const auto i : owned)
+    ASSERT_NEAR(p[i], v[i] * x, 1e-12);
+}
+
+
+
+TEST(ProjectionOperator, DistributedRangeAndDomain)
+{
+  // Both spaces are distributed. Every process provides all basis vectors.
+  using VectorType = LinearAlgebra::distributed::Vector<double>;
+
+  const MPI_Comm     comm    = MPI_COMM_WORLD;
+  const unsigned int n_procs = Utilities::MPI::n_mpi_processes(comm);
+  const unsigned int rank    = Utilities::MPI::this_mpi_process(comm);
+  const unsigned int N       = 5 * n_procs + 2;
+  const unsigned int M       = 2 * n_procs + 1;
+
+  const IndexSet owned_range =
+    Utilities::create_evenly_distributed_partitioning(rank, n_procs, M);
+  const IndexSet owned_domain =
+    Utilities::create_evenly_distributed_partitioning(rank, n_procs, N);
+
+  std::vector<VectorType> v(M, VectorType(owned_domain, comm));
+  for (unsigned int i = 0; i < M; ++i)
+    for (const auto j : owned_domain)
+      v[i][j] = std::sin(1.0 + i * N + j);
+  std::vector<std::reference_wrapper<const VectorType>> basis(v.begin(),
+                                                              v.end());
+
+  VectorType x(owned_domain, comm);
+  for (const auto j : owned_domain)
+    x[j] = std::cos(1.0 + j);
+  VectorType w(owned_range, comm);
+  for (const auto i : owned_range)
+    w[i] = i + 1.0;
+
+  const auto C  = projection_operator(w, basis);
+  const auto Ct = transpose_operator(C);
+
+  std::vector<double> expected_p(M);
+  VectorType          expected_y(owned_domain, comm);
+  for (unsigned int i = 0; i < M; ++i)
+    {
+      expected_p[i] = v[i] * x;
+      expected_y.add(i + 1.0, v[i]);
+    }
+
+  VectorType p(owned_range, comm);
+  C.vmult(p, x);
+  for (const auto i : owned_range)
+    ASSERT_NEAR(p[i], expected_p[i], 1e-12);
+
+  VectorType y(owned_domain, comm);
+  Ct.vmult(y, w);
+  y -= expected_y;
+  ASSERT_NEAR(y.l2_norm(), 0.0, 1e-12);
+}
@@ -0,0 +1,116 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include <deal.II/base/config.h>
+
+#include "parsed_tools/reduced_output.h"
+
+#include <deal.II/base/function.h>
+
+#include <deal.II/dofs/dof_handler.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/mapping_q.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <deal.II/numerics/vector_tools.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "dim_spacedim_tester.h"
+
+using namespace dealii;
+
+TYPED_TEST(DimTester, ReducedOutput)
+{
+  constexpr auto dim = TestFixture::dim;
+
+  Triangulation<dim> tria;
+  GridGenerator::hyper_cube(tria, 0, 1, true);
+  tria.refine_global(2);
+  FE_Q<dim>       fe(1);
+  MappingQ<dim>   mapping(1);
+  DoFHandler<dim> dof_handler(tria);
+  dof_handler.distribute_dofs(fe);
+
+  // The solution is u(x) = x_0, which is represented exactly by FE_Q(1).
+  Vector<double> solution(dof_handler.n_dofs());
+  VectorTools::interpolate(mapping,
+                           dof_handler,
+                           ScalarFunctionFromFunctionObject<dim>(
+                             [](const Point<dim> &p) { return p[0]; }),
+                           solution);
+
+  ParsedTools::ReducedOutput<dim> reduced_output(this->id(), "u", "reduced");
+  ParameterAcceptor::initialize();
+
+  Point<dim> probe;
+  Point<dim> end;
+  for (unsigned int d = 0; d < dim; ++d)
+    probe[d] = 0.3;
+  end[0] = 1;
+
+  this->parse("set Probe points = " + Patterns::Tools::to_string(probe) +
+                "\n"
+                "set Line samples = " +
+                Patterns::Tools::to_string(Point<dim>()) + " : " +
+                Patterns::Tools::to_string(end) + " : 3\n"
+                "set Boundary ids = 1\n"
+                "set Volume integrals = true\n",
+              reduced_output);
+
+  ASSERT_TRUE(reduced_output.enabled());
+
+  const auto values =
+    reduced_output.point_values(mapping, dof_handler, solution);
+  ASSERT_EQ(values.size(), 4u);
+  EXPECT_NEAR(values[0], 0.3, 1e-10);
+  EXPECT_NEAR(values[1], 0.0, 1e-10);
+  EXPECT_NEAR(values[2], 0.5, 1e-10);
+  EXPECT_NEAR(values[3], 1.0, 1e-10);
+
+  // The volume integral of x_0 on the unit cube is 1/2, and its integral on
+  // the face x_0 = 1 is the measure of the face.
+  const auto integrals =
+    reduced_output.integrals(mapping, dof_handler, solution);
+  ASSERT_EQ(integrals.size(), 2u);
+  EXPECT_NEAR(integrals[0], 0.5, 1e-10);
+  EXPECT_NEAR(integrals[1], 1.0, 1e-10);
+
+  reduced_output.write(0.0, mapping, dof_handler, solution);
+  reduced_output.write(1.0, mapping, dof_handler, solution);
+
+  for (const auto &fname : {"reduced_probes.csv",
+                            "reduced_line_0.csv",
+                            "reduced_integrals.csv"})
+    {
+      std::ifstream in(fname);
+      ASSERT_TRUE(in);
+      unsigned int n_lines = 0;
+      std::string  line;
+      while (std::getline(in, line))
+        ++n_lines;
+      // One header line, and one line per call to write()
+      EXPECT_EQ(n_lines, 3u);
+      in.close();
+      std::remove(fname);
+    }
+}
@@ -0,0 +1,74 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/rigid_body_modes.h"
+
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_system.h>
+#include <deal.II/fe/mapping_q.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+using namespace dealii;
+
+TEST(RigidBodyModes, Elasticity3D)
+{
+  static const int dim = 3;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation, -1, 1);
+  triangulation.refine_global(1);
+
+  MappingQ<dim>   mapping(1);
+  FESystem<dim>   fe(FE_Q<dim>(2), dim);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(fe);
+
+  const auto modes =
+    ParsedLAC::rigid_body_modes(mapping, dof_handler, ComponentMask(dim, true));
+  ASSERT_EQ(modes.size(), 6u);
+
+  std::map<types::global_dof_index, Point<dim>> support_points;
+  DoFTools::map_dofs_to_support_points(mapping, dof_handler, support_points);
+
+  std::vector<unsigned int>            component(dof_handler.n_dofs());
+  std::vector<types::global_dof_index> dof_indices(fe.n_dofs_per_cell());
+  for (const auto &cell : dof_handler.active_cell_iterators())
+    {
+      cell->get_dof_indices(dof_indices);
+      for (unsigned int j = 0; j < fe.n_dofs_per_cell(); ++j)
+        component[dof_indices[j]] = fe.system_to_component_index(j).first;
+    }
+
+  for (unsigned int i = 0; i < dof_handler.n_dofs(); ++i)
+    {
+      const auto        &p = support_points.at(i);
+      const unsigned int c = component[i];
+      for (unsigned int d = 0; d < dim; ++d)
+        EXPECT_EQ(modes[d][i], c == d ? 1.0 : 0.0);
+      // Rotations in the planes (0, 1), (0, 2), and (1, 2)
+      EXPECT_EQ(modes[3][i], c == 0 ? -p[1] : c == 1 ? p[0] : 0.0);
+      EXPECT_EQ(modes[4][i], c == 0 ? -p[2] : c == 2 ? p[0] : 0.0);
+      EXPECT_EQ(modes[5][i], c == 1 ? -p[2] : c == 2 ? p[1] : 0.0);
+    }
+}
@@ -142,4 +142,36 @@ TEST(Runner, PrmFromCommandLine)
   EXPECT_EQ(verbosity, 1);
   ASSERT_TRUE(std::ifstream("output.prm"));
   std::remove("output.prm");
-}
\ No newline at end of file
+}
+
+
+TEST(Runner, Restart)
+{
+  {
+    char *argv[] = {(char *)"./app", (char *)"input.prm", NULL};
+    EXPECT_FALSE(Runner::restart_requested(argv));
+  }
+  {
+    char *argv[] = {(char *)"./app", (char *)"input.prm", (char *)"-r", NULL};
+    EXPECT_TRUE(Runner::restart_requested(argv));
+  }
+  {
+    char *argv[] = {(char *)"./app",
+                    (char *)"-i",
+                    (char *)"input.prm",
+                    (char *)"--restart",
+                    NULL};
+    EXPECT_TRUE(Runner::restart_requested(argv));
+  }
+  {
+    // The flag does not take the parameter file as its value
+    char *argv[] = {(char *)"./app", (char *)"-r", (char *)"input.prm", NULL};
+    EXPECT_TRUE(Runner::restart_requested(argv));
+    auto [dim, spacedim, in_file, out_file] =
+      Runner::get_dimensions_and_parameter_files(argv);
+    EXPECT_EQ(dim, 2);
+    EXPECT_EQ(spacedim, 2);
+    EXPECT_EQ(in_file, "input.prm");
+    EXPECT_EQ(out_file, "used_input.prm");
+  }
+}
@@ -0,0 +1,91 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "pdes/shape_cache.h"
+
+#include <deal.II/base/quadrature_lib.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/fe_system.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <gtest/gtest.h>
+
+using namespace dealii;
+
+TEST(ShapeCache, StokesElement)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation, -1, 1);
+
+  FESystem<dim> fe(FE_Q<dim>(2), dim, FE_Q<dim>(1), 1);
+  QGauss<dim>   quadrature(3);
+
+  MeshWorker::ScratchData<dim> scratch(fe,
+                                       quadrature,
+                                       update_values | update_gradients);
+  const auto &fe_values = scratch.reinit(triangulation.begin_active());
+
+  const FEValuesExtractors::Vector velocity(0);
+  const FEValuesExtractors::Scalar pressure(dim);
+
+  const auto &u = PDEs::reinit_shape_cache(scratch, velocity);
+  const auto &p = PDEs::reinit_shape_cache(scratch, pressure);
+
+  ASSERT_EQ(u.n_dofs(), 9u * dim);
+  ASSERT_EQ(p.n_dofs(), 4u);
+
+  for (const auto q : fe_values.quadrature_point_indices())
+    {
+      for (unsigned int k = 0; k < u.n_dofs(); ++k)
+        {
+          const auto i = u.get_dofs()[k];
+          EXPECT_EQ(u.value(k, q), fe_values[velocity].value(i, q));
+          EXPECT_EQ(u.symmetric_gradient(k, q),
+                    fe_values[velocity].symmetric_gradient(i, q));
+          EXPECT_EQ(u.divergence(k, q), fe_values[velocity].divergence(i, q));
+        }
+      for (unsigned int k = 0; k < p.n_dofs(); ++k)
+        {
+          const auto i = p.get_dofs()[k];
+          EXPECT_EQ(p.value(k, q), fe_values[pressure].value(i, q));
+          EXPECT_EQ(p.gradient(k, q), fe_values[pressure].gradient(i, q));
+        }
+    }
+
+  // The cache is stored in the scratch data, and returned on the next call
+  EXPECT_EQ(&u, &PDEs::reinit_shape_cache(scratch, velocity));
+}
+
+
+
+TEST(ShapeCache, MirrorLowerTriangle)
+{
+  FullMatrix<double> matrix(3, 3);
+  for (unsigned int i = 0; i < 3; ++i)
+    for (unsigned int j = 0; j <= i; ++j)
+      matrix(i, j) = 1.0 + i * 3 + j;
+
+  PDEs::mirror_lower_triangle(matrix);
+
+  for (unsigned int i = 0; i < 3; ++i)
+    for (unsigned int j = 0; j < 3; ++j)
+      EXPECT_EQ(matrix(i, j), matrix(j, i));
+  EXPECT_EQ(matrix(0, 2), 7.0);
+}
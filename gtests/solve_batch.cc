@@ -0,0 +1,79 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "pdes/linear_elasticity.h"
+
+#include <deal.II/base/function.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <vector>
+
+using namespace dealii;
+
+TEST(LinearProblem, BlockCGBatchMatchesSequentialSolves)
+{
+  static const int dim = 2;
+  using Problem        = PDEs::LinearProblem<dim, dim, LAC::LAdealii>;
+
+  PDEs::LinearElasticity<dim> elasticity;
+  ParameterAcceptor::initialize();
+
+  elasticity.grid_generator.generate(elasticity.triangulation);
+  elasticity.triangulation.refine_global(3);
+  elasticity.setup_system();
+  elasticity.assemble_system();
+
+  // Forcing terms along different directions, so that the batch is not
+  // linearly dependent
+  const std::vector<std::vector<double>> values = {{1.0, 0.0},
+                                                   {0.0, 1.0},
+                                                   {2.0, -1.0}};
+
+  std::vector<std::unique_ptr<Functions::ConstantFunction<dim>>> functions;
+  std::vector<const Function<dim> *>                             forcing_terms;
+  for (const auto &v : values)
+    {
+      functions.emplace_back(
+        std::make_unique<Functions::ConstantFunction<dim>>(v));
+      forcing_terms.push_back(functions.back().get());
+    }
+
+  std::vector<Problem::BlockVectorType> rhs_batch;
+  std::vector<Problem::BlockVectorType> solutions;
+  elasticity.assemble_rhs_batch(forcing_terms, rhs_batch);
+  ASSERT_EQ(rhs_batch.size(), values.size());
+
+  // The solution is the initial guess of the block CG method
+  elasticity.solution = 0;
+  elasticity.solve_batch(rhs_batch, solutions);
+  ASSERT_EQ(solutions.size(), values.size());
+
+  // solve() is protected in LinearElasticity
+  Problem &problem = elasticity;
+  for (unsigned int k = 0; k < rhs_batch.size(); ++k)
+    {
+      problem.rhs      = rhs_batch[k];
+      problem.solution = 0;
+      problem.solve();
+
+      ASSERT_GT(problem.solution.l2_norm(), 0.0);
+      auto difference = solutions[k];
+      difference -= problem.solution;
+      EXPECT_LT(difference.l2_norm(), 1e-8 * problem.solution.l2_norm())
+        << "Right hand side " << k;
+    }
+}
@@ -0,0 +1,196 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/solver_telemetry.h"
+
+#include <deal.II/base/quadrature_lib.h>
+
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe_q.h>
+#include <deal.II/fe/mapping_q.h>
+
+#include <deal.II/grid/grid_generator.h>
+#include <deal.II/grid/tria.h>
+
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/linear_operator_tools.h>
+#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/sparse_matrix.h>
+
+#include <deal.II/numerics/matrix_tools.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "parsed_lac/inverse_operator.h"
+
+using namespace dealii;
+
+TEST(SolverTelemetry, RecordSolves)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(3);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+
+  PreconditionJacobi<SparseMatrix<double>> prec;
+  prec.initialize(A);
+
+  Vector<double> u(dof_handler.n_dofs());
+  for (unsigned int i = 0; i < u.size(); ++i)
+    u[i] = (double)(i + 1);
+
+  ParsedLAC::SolverTelemetry::clear();
+  ParsedLAC::SolverTelemetry::set_enabled(true);
+
+  // A deal.II solver, called through solve()
+  ParsedLAC::InverseOperator cg("/Telemetry cg", "cg");
+  Vector<double>             v(u.size());
+  cg.solve(A, prec, u, v, 1e-10 * u.l2_norm());
+
+  // A solver with fused reductions, called through a linear operator
+  ParsedLAC::InverseOperator pipecg("/Telemetry pipecg", "pipecg");
+
+  const auto     op_a  = linear_operator<Vector<double>>(A);
+  const auto     inv_a = pipecg(op_a, prec, 1e-10 * u.l2_norm());
+  Vector<double> w     = inv_a * u;
+
+  const auto &records = ParsedLAC::SolverTelemetry::get_records();
+  ASSERT_EQ(records.size(), 2u);
+
+  EXPECT_EQ(records[0].solver_name, "cg");
+  EXPECT_TRUE(records[0].reductions_estimated);
+  EXPECT_EQ(records[1].solver_name, "pipecg");
+  EXPECT_FALSE(records[1].reductions_estimated);
+
+  for (const auto &record : records)
+    {
+      EXPECT_TRUE(record.converged);
+      EXPECT_GT(record.n_iterations, 0u);
+      EXPECT_EQ(record.residual_history.size(), record.n_iterations + 1);
+      EXPECT_GE(record.n_matvecs, record.n_iterations);
+      EXPECT_GE(record.n_preconditioner_applications, record.n_iterations);
+      EXPECT_GT(record.n_reductions, 0u);
+      EXPECT_GT(record.bytes_moved, 0.0);
+    }
+
+  std::stringstream csv;
+  ParsedLAC::SolverTelemetry::write_csv(csv, 3, records, true);
+  std::string  line;
+  unsigned int n_lines = 0;
+  while (std::getline(csv, line))
+    ++n_lines;
+  EXPECT_EQ(n_lines, 3u);
+
+  std::stringstream json;
+  ParsedLAC::SolverTelemetry::write_json(json, 3, records);
+  EXPECT_NE(json.str().find("\"stage\": 3"), std::string::npos);
+  EXPECT_NE(json.str().find("\"solver\": \"pipecg\""), std::string::npos);
+
+  ParsedLAC::SolverTelemetry::clear();
+  ParsedLAC::SolverTelemetry::set_enabled(false);
+  EXPECT_TRUE(ParsedLAC::SolverTelemetry::get_records().empty());
+
+  // When disabled, nothing is recorded
+  cg.solve(A, prec, u, v, 1e-10 * u.l2_norm());
+  EXPECT_TRUE(ParsedLAC::SolverTelemetry::get_records().empty());
+}
+
+
+
+TEST(SolverTelemetry, NestedSolves)
+{
+  static const int dim = 2;
+
+  Triangulation<dim> triangulation;
+  GridGenerator::hyper_cube(triangulation);
+  triangulation.refine_global(3);
+
+  MappingQ<dim>   mapping_q1(1);
+  FE_Q<dim>       q1(1);
+  DoFHandler<dim> dof_handler(triangulation);
+  dof_handler.distribute_dofs(q1);
+
+  DynamicSparsityPattern dsp(dof_handler.n_dofs(), dof_handler.n_dofs());
+  DoFTools::make_sparsity_pattern(dof_handler, dsp);
+  SparsityPattern sparsity_pattern;
+  sparsity_pattern.copy_from(dsp);
+
+  SparseMatrix<double> A(sparsity_pattern);
+  QGauss<dim>          quadrature(2);
+  MatrixCreator::create_mass_matrix(mapping_q1, dof_handler, quadrature, A);
+
+  PreconditionJacobi<SparseMatrix<double>> prec;
+  prec.initialize(A);
+
+  Vector<double> u(dof_handler.n_dofs());
+  for (unsigned int i = 0; i < u.size(); ++i)
+    u[i] = (double)(i + 1);
+
+  ParsedLAC::SolverTelemetry::clear();
+  ParsedLAC::SolverTelemetry::set_enabled(true);
+  const unsigned int reductions_at_start =
+    ParsedLAC::SolverTelemetry::n_reductions();
+
+  // An outer solve whose operator is itself an inner solve, as for a Schur
+  // complement
+  ParsedLAC::InverseOperator inner("/Telemetry inner", "pipecg");
+  ParsedLAC::InverseOperator outer("/Telemetry outer", "pipecg");
+
+  const double   tolerance = 1e-4 * u.l2_norm();
+  const auto     op_a      = linear_operator<Vector<double>>(A);
+  const auto     inv_a     = inner(op_a, prec, 1e-8 * tolerance);
+  const auto     op_aa     = inv_a * inv_a;
+  const auto     inv_aa    = outer(op_aa, PreconditionIdentity(), tolerance);
+  Vector<double> w         = inv_aa * u;
+
+  const auto &records = ParsedLAC::SolverTelemetry::get_records();
+  ASSERT_GT(records.size(), 2u);
+
+  // The outer solve finishes last, and only counts its own reductions: one
+  // fused reduction per iteration, plus the initial ones
+  const auto &outer_record = records.back();
+  EXPECT_NE(outer_record.label.find("outer"), std::string::npos);
+  EXPECT_LE(outer_record.n_reductions, 2 * (outer_record.n_iterations + 1));
+
+  unsigned int inner_reductions = 0;
+  for (unsigned int i = 0; i + 1 < records.size(); ++i)
+    inner_reductions += records[i].n_reductions;
+  EXPECT_GT(inner_reductions, outer_record.n_reductions);
+
+  // All the reductions are in the records
+  EXPECT_EQ(ParsedLAC::SolverTelemetry::n_reductions(), reductions_at_start);
+
+  ParsedLAC::SolverTelemetry::clear();
+  ParsedLAC::SolverTelemetry::set_enabled(false);
+}
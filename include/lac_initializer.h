@@ -17,6 +17,10 @@
 #define fsi_lac_initializer_h
 
 // This includes all types we know of.
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/sparsity_tools.h>
+
 #include <mpi.h>
 
 #include "lac.h"
@@ -122,6 +126,13 @@ namespace LAC
 
     /**
      * Initialize a Deal.II Sparsity Pattern.
+     *
+     * This is also used by the PETSc backend. If the degrees of freedom are
+     * distributed among several processes, only the locally relevant rows
+     * are built, the rows owned by other processes are sent to their owners,
+     * and the resulting pattern is only used to preallocate the PETSc
+     * matrix. In this case @p s is left untouched, since a
+     * dealii::BlockSparsityPattern cannot store a distributed pattern.
      */
     template <int dim, int spacedim>
     void
@@ -130,13 +141,34 @@ namespace LAC
                const dealii::AffineConstraints<double>            &cm,
                const dealii::Table<2, dealii::DoFTools::Coupling> &coupling)
     {
-      dsp =
-        std::make_unique<dealii::BlockDynamicSparsityPattern>(dofs_per_block,
-                                                              dofs_per_block);
-
-      dealii::DoFTools::make_sparsity_pattern(dh, coupling, *dsp, cm, false);
-      dsp->compress();
-      s.copy_from(*dsp);
+      if (is_distributed() == false)
+        {
+          dsp = std::make_unique<dealii::BlockDynamicSparsityPattern>(
+            dofs_per_block, dofs_per_block);
+
+          dealii::DoFTools::make_sparsity_pattern(dh,
+                                                  coupling,
+                                                  *dsp,
+                                                  cm,
+                                                  false);
+          dsp->compress();
+          s.copy_from(*dsp);
+        }
+      else
+        {
+          dsp = std::make_unique<dealii::BlockDynamicSparsityPattern>(relevant);
+
+          dealii::DoFTools::make_sparsity_pattern(
+            dh,
+            coupling,
+            *dsp,
+            cm,
+            false,
+            dealii::Utilities::MPI::this_mpi_process(comm));
+          dealii::SparsityTools::distribute_sparsity_pattern(
+            *dsp, merge_blocks(owned), comm, merge_blocks(relevant));
+          dsp->compress();
+        }
     }
 
     /**
@@ -163,7 +195,9 @@ namespace LAC
 
 
     /**
-     * Initialize a PETSc matrix
+     * Initialize a PETSc matrix. The number of nonzero entries of each
+     * locally owned row, in the diagonal and off-diagonal parts, is
+     * preallocated exactly from the dynamic sparsity pattern.
      */
     void
     operator()(const LAPETSc::BlockSparsityPattern &,
@@ -176,7 +210,48 @@ namespace LAC
 
   private:
     /**
-     * The dynamic sparisty pattern.
+     * Return true if some degrees of freedom are owned by other processes.
+     *
+     * The answer is the same on all processes of the communicator, since the
+     * distributed path calls collective functions: a process that owns all
+     * degrees of freedom still takes part in the communication if other
+     * processes do not.
+     */
+    bool
+    is_distributed() const
+    {
+      unsigned int local_distributed = 0;
+      for (unsigned int b = 0; b < owned.size(); ++b)
+        if (owned[b].n_elements() != dofs_per_block[b])
+          local_distributed = 1;
+      return dealii::Utilities::MPI::max(local_distributed, comm) > 0;
+    }
+
+    /**
+     * Merge a set of block index sets into a single index set, numbering the
+     * indices of each block after the ones of the previous blocks.
+     */
+    dealii::IndexSet
+    merge_blocks(const std::vector<dealii::IndexSet> &sets) const
+    {
+      dealii::types::global_dof_index n_dofs = 0;
+      for (const auto &n : dofs_per_block)
+        n_dofs += n;
+
+      dealii::IndexSet                merged(n_dofs);
+      dealii::types::global_dof_index shift = 0;
+      for (unsigned int b = 0; b < sets.size(); ++b)
+        {
+          merged.add_indices(sets[b], shift);
+          shift += dofs_per_block[b];
+        }
+      merged.compress();
+      return merged;
+    }
+
+    /**
+     * The dynamic sparisty pattern. When the degrees of freedom are
+     * distributed, only the locally relevant rows are stored.
      */
     std::unique_ptr<dealii::BlockDynamicSparsityPattern> dsp;
 
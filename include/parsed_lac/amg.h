@@ -66,6 +66,16 @@ namespace ParsedLAC
     void
     set_constant_modes(const std::vector<std::vector<bool>> &constant_modes);
 
+    /**
+     * Set the near null space of the AMG preconditioner to the given modes,
+     * e.g., the rigid body modes of an elasticity problem computed with
+     * ParsedLAC::rigid_body_modes(). The modes are indexed as
+     * `modes[mode][i]`, where `i` runs over the locally owned rows of the
+     * matrix. When this is not empty, the constant modes are ignored.
+     */
+    void
+    set_rigid_body_modes(const std::vector<std::vector<double>> &modes);
+
   private:
     /**
      * Declare preconditioner options.
@@ -166,6 +176,11 @@ namespace ParsedLAC
      * Constant modes of the matrix.
      */
     std::vector<std::vector<bool>> constant_modes;
+
+    /**
+     * Near null space of the matrix, with values.
+     */
+    std::vector<std::vector<double>> rigid_body_modes;
   };
 
 
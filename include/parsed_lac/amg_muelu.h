@@ -60,6 +60,20 @@ namespace ParsedLAC
 
     using dealii::TrilinosWrappers::PreconditionAMGMueLu::initialize;
 
+    /**
+     * Set the near null space of the AMG preconditioner to the given modes,
+     * e.g., the rigid body modes of an elasticity problem computed with
+     * ParsedLAC::rigid_body_modes(). The modes are indexed as
+     * `modes[mode][i]`, where `i` runs over the locally owned rows of the
+     * matrix.
+     *
+     * The deal.II interface to MueLu only accepts constant modes: only the
+     * modes whose values are all zero or one (i.e., the translations) are
+     * passed to MueLu.
+     */
+    void
+    set_rigid_body_modes(const std::vector<std::vector<double>> &modes);
+
   private:
     /**
      * Add all parameter options.
@@ -142,6 +156,11 @@ namespace ParsedLAC
      * settings as for the smoother type are possible.
      */
     std::string coarse_type;
+
+    /**
+     * Constant modes of the matrix.
+     */
+    std::vector<std::vector<bool>> constant_modes;
   };
 
 
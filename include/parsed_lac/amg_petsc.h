@@ -64,6 +64,31 @@ namespace ParsedLAC
     void
     initialize(const dealii::PETScWrappers::MatrixBase &matrix);
 
+    /**
+     * Set the near null space of the AMG preconditioner to the given modes,
+     * e.g., the rigid body modes of an elasticity problem computed with
+     * ParsedLAC::rigid_body_modes(). The modes are indexed as
+     * `modes[mode][i]`, where `i` runs over the locally owned rows of the
+     * matrix.
+     *
+     * The modes are orthonormalized and attached to the matrix as its near
+     * null space (see `MatSetNearNullSpace`), when the preconditioner is
+     * initialized. BoomerAMG ignores the near null space, unless it treats
+     * the matrix as a system with @p n_components unknowns per node: if
+     * @p n_components is larger than one, the block size of the matrix is
+     * set to @p n_components, and nodal coarsening and vector interpolation
+     * (`-pc_hypre_boomeramg_nodal_coarsen` and
+     * `-pc_hypre_boomeramg_vec_interp_variant`) are enabled for this
+     * preconditioner. This requires the unknowns of each node to be numbered
+     * consecutively, starting from a multiple of @p n_components: callers
+     * must pass one for any other numbering (see
+     * ParsedTools::DoFRenumbering::is_node_interleaved()), in which case the
+     * modes are attached to the matrix, but they are not used by BoomerAMG.
+     */
+    void
+    set_rigid_body_modes(const std::vector<std::vector<double>> &modes,
+                         const unsigned int n_components = 1);
+
   private:
     /**
      * Declare preconditioner options.
@@ -146,6 +171,16 @@ namespace ParsedLAC
      * setting of a v-cycle.
      */
     bool w_cycle;
+
+    /**
+     * Near null space of the matrix.
+     */
+    std::vector<std::vector<double>> rigid_body_modes;
+
+    /**
+     * Number of unknowns per node, used by the vector interpolation.
+     */
+    unsigned int n_components = 1;
   };
 
 
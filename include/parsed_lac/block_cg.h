@@ -0,0 +1,259 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_block_cg_h
+#define parsed_lac_block_cg_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/lapack_full_matrix.h>
+#include <deal.II/lac/solver.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/vector.h>
+#include <deal.II/lac/vector_memory.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "parsed_lac/pipelined_solvers.h"
+
+namespace ParsedLAC
+{
+  /**
+   * Block preconditioned conjugate gradient method (O'Leary, 1980), for a
+   * symmetric positive definite operator and several right hand sides.
+   *
+   * All the right hand sides are solved together: the search space of every
+   * column is the sum of the Krylov spaces of all the columns, so that the
+   * number of iterations is smaller than the one of the independent solves,
+   * especially when the right hand sides share the same slowly converging
+   * components. Every iteration applies the operator and the preconditioner
+   * once to each column, and computes all the inner products among the
+   * columns with two fused global reductions, instead of two reductions per
+   * column.
+   *
+   * The small Gram matrices of the block recurrence become singular when
+   * some columns converge before the others, or when the right hand sides
+   * are linearly dependent. They are inverted with a pseudo inverse based on
+   * their singular value decomposition, which removes the dependent
+   * directions from the block.
+   *
+   * The convergence test is applied to the largest residual norm among the
+   * columns.
+   */
+  template <typename VectorType = dealii::Vector<double>>
+  class SolverBlockCG : public dealii::SolverBase<VectorType>
+  {
+  public:
+    /**
+     * Constructor.
+     */
+    SolverBlockCG(dealii::SolverControl            &cn,
+                  dealii::VectorMemory<VectorType> &mem);
+
+    /**
+     * Constructor. Use an object of type GrowingVectorMemory as a default to
+     * allocate memory.
+     */
+    SolverBlockCG(dealii::SolverControl &cn);
+
+    /**
+     * Solve the linear systems $Ax_j=b_j$ for all $x_j$. The vectors in @p x
+     * are used as initial guesses.
+     */
+    template <typename MatrixType, typename PreconditionerType>
+    void
+    solve(const MatrixType              &A,
+          std::vector<VectorType>       &x,
+          const std::vector<VectorType> &b,
+          const PreconditionerType      &preconditioner);
+
+  private:
+    /**
+     * Compute the symmetric matrix $U^T V$, and the largest norm among the
+     * vectors @p norms, with a single global reduction.
+     */
+    static double
+    gram_matrix(const std::vector<VectorType> &U,
+                const std::vector<VectorType> &V,
+                const std::vector<VectorType> &norms,
+                dealii::FullMatrix<double>    &result);
+
+    /**
+     * Compute $M^+ B$, where $M^+$ is the pseudo inverse of @p M.
+     */
+    static void
+    pseudo_inverse_mmult(const dealii::FullMatrix<double> &M,
+                         const dealii::FullMatrix<double> &B,
+                         dealii::FullMatrix<double>       &result);
+  };
+
+
+
+#ifndef DOXYGEN
+  // Template implementation
+  template <typename VectorType>
+  SolverBlockCG<VectorType>::SolverBlockCG(
+    dealii::SolverControl            &cn,
+    dealii::VectorMemory<VectorType> &mem)
+    : dealii::SolverBase<VectorType>(cn, mem)
+  {}
+
+
+
+  template <typename VectorType>
+  SolverBlockCG<VectorType>::SolverBlockCG(dealii::SolverControl &cn)
+    : dealii::SolverBase<VectorType>(cn)
+  {}
+
+
+
+  template <typename VectorType>
+  double
+  SolverBlockCG<VectorType>::gram_matrix(const std::vector<VectorType> &U,
+                                         const std::vector<VectorType> &V,
+                                         const std::vector<VectorType> &norms,
+                                         dealii::FullMatrix<double> &result)
+  {
+    const unsigned int s = U.size();
+
+    std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+    for (unsigned int i = 0; i < s; ++i)
+      for (unsigned int j = i; j < s; ++j)
+        pairs.emplace_back(&U[i], &V[j]);
+    for (const auto &v : norms)
+      pairs.emplace_back(&v, &v);
+    const auto d = internal::FusedReductions::dot_products(pairs);
+
+    result.reinit(s, s);
+    unsigned int n = 0;
+    for (unsigned int i = 0; i < s; ++i)
+      for (unsigned int j = i; j < s; ++j, ++n)
+        result(i, j) = result(j, i) = d[n];
+
+    double max_norm = 0;
+    for (; n < d.size(); ++n)
+      max_norm = std::max(max_norm, std::sqrt(std::abs(d[n])));
+    return max_norm;
+  }
+
+
+
+  template <typename VectorType>
+  void
+  SolverBlockCG<VectorType>::pseudo_inverse_mmult(
+    const dealii::FullMatrix<double> &M,
+    const dealii::FullMatrix<double> &B,
+    dealii::FullMatrix<double>       &result)
+  {
+    const unsigned int s = M.m();
+
+    dealii::LAPACKFullMatrix<double> M_inv(s, s);
+    M_inv = M;
+    M_inv.compute_inverse_svd(1e-12);
+
+    result.reinit(s, B.n());
+    dealii::Vector<double> column(s);
+    dealii::Vector<double> product(s);
+    for (unsigned int j = 0; j < B.n(); ++j)
+      {
+        for (unsigned int i = 0; i < s; ++i)
+          column[i] = B(i, j);
+        M_inv.vmult(product, column);
+        for (unsigned int i = 0; i < s; ++i)
+          result(i, j) = product[i];
+      }
+  }
+
+
+
+  template <typename VectorType>
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  SolverBlockCG<VectorType>::solve(const MatrixType              &A,
+                                   std::vector<VectorType>       &x,
+                                   const std::vector<VectorType> &b,
+                                   const PreconditionerType &preconditioner)
+  {
+    using namespace dealii;
+
+    const unsigned int s = b.size();
+    AssertDimension(x.size(), s);
+    if (s == 0)
+      return;
+
+    std::vector<VectorType> r(s), z(s), p(s), q(s), tmp(s);
+    for (unsigned int j = 0; j < s; ++j)
+      {
+        for (auto *v : {&r[j], &z[j], &p[j], &q[j], &tmp[j]})
+          v->reinit(x[j]);
+        A.vmult(r[j], x[j]);
+        r[j].sadd(-1.0, 1.0, b[j]);
+        preconditioner.vmult(z[j], r[j]);
+        p[j] = z[j];
+      }
+
+    FullMatrix<double> gamma, gamma_new, delta, alpha, beta;
+    double             residual = gram_matrix(z, r, r, gamma);
+
+    unsigned int         it   = 0;
+    SolverControl::State conv = this->iteration_status(it, residual, x[0]);
+    while (conv == SolverControl::iterate)
+      {
+        // alpha = (P^T A P)^+ (Z^T R)
+        for (unsigned int j = 0; j < s; ++j)
+          A.vmult(q[j], p[j]);
+        gram_matrix(p, q, {}, delta);
+        pseudo_inverse_mmult(delta, gamma, alpha);
+
+        for (unsigned int j = 0; j < s; ++j)
+          for (unsigned int i = 0; i < s; ++i)
+            if (alpha(i, j) != 0.0)
+              {
+                x[j].add(alpha(i, j), p[i]);
+                r[j].add(-alpha(i, j), q[i]);
+              }
+        for (unsigned int j = 0; j < s; ++j)
+          preconditioner.vmult(z[j], r[j]);
+
+        residual = gram_matrix(z, r, r, gamma_new);
+        ++it;
+        conv = this->iteration_status(it, residual, x[0]);
+        if (conv != SolverControl::iterate)
+          break;
+
+        // P = Z + P (Z^T R)_old^+ (Z^T R)_new
+        pseudo_inverse_mmult(gamma, gamma_new, beta);
+        for (unsigned int j = 0; j < s; ++j)
+          {
+            tmp[j] = z[j];
+            for (unsigned int i = 0; i < s; ++i)
+              if (beta(i, j) != 0.0)
+                tmp[j].add(beta(i, j), p[i]);
+          }
+        std::swap(p, tmp);
+        gamma = gamma_new;
+      }
+
+    AssertThrow(conv == SolverControl::success,
+                SolverControl::NoConvergence(it, residual));
+  }
+#endif
+} // namespace ParsedLAC
+
+#endif
@@ -0,0 +1,343 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_bsr_matrix_h
+#define parsed_lac_bsr_matrix_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/parameter_acceptor.h>
+
+#include <deal.II/lac/sparse_matrix.h>
+#include <deal.II/lac/vector.h>
+
+#include <string>
+#include <vector>
+
+namespace ParsedLAC
+{
+  /**
+   * A sparse matrix in block compressed sparse row (BSR) format.
+   *
+   * The rows and the columns of the matrix are grouped in consecutive sets
+   * of `block_size` indices (e.g., the components of a vector valued finite
+   * element at a node), and a dense `block_size x block_size` block is
+   * stored for every pair of groups that has at least one nonzero entry.
+   * Only one column index is stored per block, which reduces the memory used
+   * by the indices by a factor `block_size^2` with respect to a
+   * dealii::SparseMatrix, and the matrix-vector product works on small dense
+   * blocks of fixed size, that the compiler can vectorize.
+   *
+   * The matrix is built from an assembled dealii::SparseMatrix. This is
+   * efficient when the degrees of freedom of each node are numbered
+   * consecutively (see ParsedTools::DoFRenumbering::is_node_interleaved()).
+   * Otherwise the blocks contain explicit zeros, and the block smoothers do
+   * not act on the unknowns of a node.
+   */
+  class BSRMatrix
+  {
+  public:
+    /**
+     * Copy the sparsity and the values of @p matrix, grouping rows and
+     * columns in sets of @p block_size indices.
+     */
+    void
+    initialize(const dealii::SparseMatrix<double> &matrix,
+               const unsigned int                  block_size);
+
+    /**
+     * Number of rows.
+     */
+    dealii::types::global_dof_index
+    m() const;
+
+    /**
+     * Number of columns.
+     */
+    dealii::types::global_dof_index
+    n() const;
+
+    /**
+     * Size of the dense blocks.
+     */
+    unsigned int
+    get_block_size() const;
+
+    /**
+     * Number of rows of blocks.
+     */
+    unsigned int
+    n_block_rows() const;
+
+    /**
+     * Number of stored blocks.
+     */
+    std::size_t
+    n_blocks() const;
+
+    /**
+     * Matrix-vector multiplication: dst = A * src.
+     */
+    void
+    vmult(dealii::Vector<double> &dst, const dealii::Vector<double> &src) const;
+
+    /**
+     * Transpose matrix-vector multiplication: dst = A^T * src.
+     */
+    void
+    Tvmult(dealii::Vector<double>       &dst,
+           const dealii::Vector<double> &src) const;
+
+    /**
+     * Adding matrix-vector multiplication: dst += A * src.
+     */
+    void
+    vmult_add(dealii::Vector<double>       &dst,
+              const dealii::Vector<double> &src) const;
+
+    /**
+     * Adding transpose matrix-vector multiplication: dst += A^T * src.
+     */
+    void
+    Tvmult_add(dealii::Vector<double>       &dst,
+               const dealii::Vector<double> &src) const;
+
+    /**
+     * Memory used by this object, in bytes.
+     */
+    std::size_t
+    memory_consumption() const;
+
+    /**
+     * Index of the first block of each row of blocks.
+     */
+    const std::vector<std::size_t> &
+    get_row_start() const;
+
+    /**
+     * Column of each stored block, sorted within each row of blocks.
+     */
+    const std::vector<unsigned int> &
+    get_columns() const;
+
+    /**
+     * Entries of the stored blocks, one block after the other, each stored
+     * by rows.
+     */
+    const std::vector<double> &
+    get_values() const;
+
+  private:
+    /**
+     * Size of the dense blocks.
+     */
+    unsigned int block_size = 1;
+
+    /**
+     * Number of rows and columns.
+     */
+    dealii::types::global_dof_index n_rows = 0;
+    dealii::types::global_dof_index n_cols = 0;
+
+    /**
+     * Index of the first block of each row of blocks.
+     */
+    std::vector<std::size_t> row_start;
+
+    /**
+     * Column of each stored block.
+     */
+    std::vector<unsigned int> columns;
+
+    /**
+     * Entries of the stored blocks.
+     */
+    std::vector<double> values;
+  };
+
+
+
+  /**
+   * Point block relaxation methods for a BSRMatrix, that invert exactly the
+   * dense diagonal blocks of the matrix: block Jacobi, block Gauss-Seidel
+   * (i.e., a forward SOR sweep), and symmetric block Gauss-Seidel (i.e., a
+   * forward and a backward SOR sweep, suitable for the conjugate gradient
+   * method when the matrix is symmetric).
+   */
+  class BSRSmoother
+  {
+  public:
+    /**
+     * Type of relaxation.
+     */
+    enum class Type
+    {
+      jacobi,
+      gauss_seidel,
+      symmetric_gauss_seidel
+    };
+
+    /**
+     * Invert the diagonal blocks of @p matrix. The matrix is stored by
+     * reference, and must outlive this object.
+     */
+    void
+    initialize(const BSRMatrix &matrix,
+               const Type       type       = Type::jacobi,
+               const double     relaxation = 1.0);
+
+    /**
+     * Apply the smoother to @p src.
+     */
+    void
+    vmult(dealii::Vector<double> &dst, const dealii::Vector<double> &src) const;
+
+    /**
+     * Apply the transpose of the smoother to @p src. Only implemented for
+     * block Jacobi.
+     */
+    void
+    Tvmult(dealii::Vector<double>       &dst,
+           const dealii::Vector<double> &src) const;
+
+  private:
+    /**
+     * Solve with the lower (if @p forward is true) or upper triangular part
+     * of the matrix, with diagonal blocks scaled by the inverse of the
+     * relaxation parameter.
+     */
+    void
+    sweep(dealii::Vector<double>       &dst,
+          const dealii::Vector<double> &src,
+          const bool                    forward) const;
+
+    /**
+     * The matrix.
+     */
+    const BSRMatrix *matrix = nullptr;
+
+    /**
+     * Type of relaxation.
+     */
+    Type type = Type::jacobi;
+
+    /**
+     * Relaxation parameter.
+     */
+    double relaxation = 1.0;
+
+    /**
+     * Inverse of the diagonal blocks, stored by rows.
+     */
+    std::vector<double> inverse_diagonal;
+
+    /**
+     * Index of the diagonal block of each row of blocks.
+     */
+    std::vector<std::size_t> diagonal;
+  };
+
+
+
+  /**
+   * A parsed wrapper around a BSRMatrix and its BSRSmoother.
+   *
+   * When enabled, a vector valued problem stores a copy of its system matrix
+   * in BSR format, and uses it for the matrix-vector products of the Krylov
+   * solver. If a `Smoother` is selected, it is also used as preconditioner,
+   * otherwise the preconditioner of the problem is built on the original
+   * matrix.
+   *
+   * Only the serial deal.II linear algebra is supported.
+   *
+   * The parameter file is expected to have the following structure:
+   * @code{.sh}
+   * set Relaxation parameter = 1
+   * set Smoother             = none
+   * set Use block storage    = false
+   * @endcode
+   */
+  class BSRStorage : public dealii::ParameterAcceptor
+  {
+  public:
+    /**
+     * Constructor.
+     */
+    BSRStorage(const std::string &section_name      = "",
+               const bool         use_block_storage = false,
+               const std::string &smoother          = "none",
+               const double       relaxation        = 1.0);
+
+    /**
+     * Return true if the user asked for block storage.
+     */
+    bool
+    enabled() const;
+
+    /**
+     * Return true if the user asked to use the block smoother as
+     * preconditioner.
+     */
+    bool
+    has_smoother() const;
+
+    /**
+     * Copy the matrix in BSR format, and initialize the smoother.
+     */
+    void
+    initialize(const dealii::SparseMatrix<double> &matrix,
+               const unsigned int                  block_size);
+
+    /**
+     * The matrix in BSR format.
+     */
+    const BSRMatrix &
+    get_matrix() const;
+
+    /**
+     * The block smoother.
+     */
+    const BSRSmoother &
+    get_smoother() const;
+
+  private:
+    /**
+     * Use block storage.
+     */
+    bool use_block_storage;
+
+    /**
+     * One of none, jacobi, gauss_seidel, or symmetric_gauss_seidel.
+     */
+    std::string smoother_type;
+
+    /**
+     * Relaxation parameter of the smoother.
+     */
+    double relaxation;
+
+    /**
+     * The matrix.
+     */
+    BSRMatrix matrix;
+
+    /**
+     * The smoother.
+     */
+    BSRSmoother smoother;
+  };
+} // namespace ParsedLAC
+
+#endif
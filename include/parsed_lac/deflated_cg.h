@@ -0,0 +1,497 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_deflated_cg_h
+#define parsed_lac_deflated_cg_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/logstream.h>
+
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/lapack_full_matrix.h>
+#include <deal.II/lac/solver.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/vector.h>
+#include <deal.II/lac/vector_memory.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "parsed_lac/pipelined_solvers.h"
+
+namespace ParsedLAC
+{
+  /**
+   * A deflation space that is recycled across successive solves with
+   * SolverDeflatedCG, together with some statistics on the solves.
+   */
+  template <typename VectorType>
+  struct DeflationSpace
+  {
+    /**
+     * Forget the deflation space, and the statistics.
+     */
+    void
+    clear()
+    {
+      *this = DeflationSpace<VectorType>();
+    }
+
+    /**
+     * The vectors spanning the deflation space.
+     */
+    std::vector<VectorType> vectors;
+
+    /**
+     * The deflation vectors, multiplied by the current operator.
+     */
+    std::vector<VectorType> products;
+
+    /**
+     * Search directions of the last solve, used to refresh the space.
+     */
+    std::vector<VectorType> harvested_directions;
+
+    /**
+     * Search directions of the last solve, multiplied by the operator.
+     */
+    std::vector<VectorType> harvested_products;
+
+    /**
+     * Number of solves performed with this space.
+     */
+    unsigned int n_solves = 0;
+
+    /**
+     * Number of iterations of the last solve.
+     */
+    unsigned int last_iterations = 0;
+
+    /**
+     * Number of iterations of the last solve without deflation.
+     */
+    unsigned int reference_iterations = 0;
+
+    /**
+     * Total number of iterations saved with respect to the reference solve.
+     * This is negative if deflation made things worse.
+     */
+    int saved_iterations = 0;
+  };
+
+
+
+  /**
+   * Deflated preconditioned conjugate gradient method (Saad, Yeung, Erhel,
+   * and Guyomarc'h, 2000), with a deflation space that is recycled across
+   * successive solves.
+   *
+   * The solver keeps the iterates orthogonal, in the energy norm, to a small
+   * space $W$, which removes from the spectrum seen by CG the eigenvalues
+   * whose eigenvectors are well represented in $W$. The space is stored in a
+   * DeflationSpace object, shared among all the solvers created for the same
+   * sequence of (slowly changing) operators, e.g., along the steps of a
+   * quasi-static simulation, or for many solves with the same operator.
+   *
+   * By default, at every solve the space is multiplied by the current
+   * operator, so that the deflation is exact even if the operator changed
+   * since the space was computed. This costs one product with the operator
+   * per deflation vector and per solve, which is expensive if every product
+   * is itself an inner solve, e.g., for a Schur complement. If the operator
+   * does not change between solves, set AdditionalData::constant_operator to
+   * true: the products are then only computed when the space is refreshed,
+   * as linear combinations of the harvested products, with no additional
+   * product with the operator.
+   *
+   * The space itself is refreshed every @p refresh_interval solves: the
+   * first search directions of the solve are harvested, and the new space is
+   * given by the Ritz vectors associated to the smallest Ritz values of the
+   * operator on the span of the old space and of the harvested directions.
+   * If the size or the partitioning of the vectors changes (e.g., after a
+   * refinement cycle), the space is discarded, and the next solve is a plain
+   * CG solve, used as a reference to count the iterations saved by the
+   * following ones.
+   *
+   * The Ritz vectors are computed with respect to the Euclidean inner
+   * product, i.e., for the unpreconditioned operator.
+   */
+  template <typename VectorType = dealii::Vector<double>>
+  class SolverDeflatedCG : public dealii::SolverBase<VectorType>
+  {
+  public:
+    /**
+     * Additional data for the solver.
+     */
+    struct AdditionalData
+    {
+      /**
+       * Constructor.
+       */
+      explicit AdditionalData(const unsigned int dimension         = 8,
+                              const unsigned int refresh_interval  = 5,
+                              const bool         log_statistics    = false,
+                              const bool         constant_operator = false)
+        : dimension(dimension)
+        , refresh_interval(refresh_interval)
+        , log_statistics(log_statistics)
+        , constant_operator(constant_operator)
+      {}
+
+      /**
+       * Maximum dimension of the deflation space.
+       */
+      unsigned int dimension;
+
+      /**
+       * Refresh the deflation space every this many solves. If zero, the
+       * space is only computed after the first solve.
+       */
+      unsigned int refresh_interval;
+
+      /**
+       * Print the number of iterations saved thanks to deflation on
+       * deallog after every solve.
+       */
+      bool log_statistics;
+
+      /**
+       * If true, the operator is assumed to be the same in all the solves
+       * that share the deflation space, and the products of the deflation
+       * vectors with the operator are reused.
+       */
+      bool constant_operator;
+    };
+
+    /**
+     * Constructor.
+     */
+    SolverDeflatedCG(dealii::SolverControl                       &cn,
+                     dealii::VectorMemory<VectorType>            &mem,
+                     std::shared_ptr<DeflationSpace<VectorType>> space,
+                     const AdditionalData &data = AdditionalData());
+
+    /**
+     * Constructor. Use an object of type GrowingVectorMemory as a default to
+     * allocate memory.
+     */
+    SolverDeflatedCG(dealii::SolverControl                       &cn,
+                     std::shared_ptr<DeflationSpace<VectorType>> space,
+                     const AdditionalData &data = AdditionalData());
+
+    /**
+     * Solve the linear system $Ax=b$ for x.
+     */
+    template <typename MatrixType, typename PreconditionerType>
+    void
+    solve(const MatrixType         &A,
+          VectorType               &x,
+          const VectorType         &b,
+          const PreconditionerType &preconditioner);
+
+  private:
+    /**
+     * Replace the deflation space with the Ritz vectors of the operator on
+     * the span of the current space and of the harvested directions.
+     */
+    void
+    refresh_space(const VectorType &exemplar);
+
+    /**
+     * The recycled deflation space.
+     */
+    const std::shared_ptr<DeflationSpace<VectorType>> space;
+
+    /**
+     * Solver parameters.
+     */
+    const AdditionalData additional_data;
+  };
+
+
+
+#ifndef DOXYGEN
+  // Template implementation
+  template <typename VectorType>
+  SolverDeflatedCG<VectorType>::SolverDeflatedCG(
+    dealii::SolverControl                       &cn,
+    dealii::VectorMemory<VectorType>            &mem,
+    std::shared_ptr<DeflationSpace<VectorType>> space,
+    const AdditionalData                        &data)
+    : dealii::SolverBase<VectorType>(cn, mem)
+    , space(space)
+    , additional_data(data)
+  {}
+
+
+
+  template <typename VectorType>
+  SolverDeflatedCG<VectorType>::SolverDeflatedCG(
+    dealii::SolverControl                       &cn,
+    std::shared_ptr<DeflationSpace<VectorType>> space,
+    const AdditionalData                        &data)
+    : dealii::SolverBase<VectorType>(cn)
+    , space(space)
+    , additional_data(data)
+  {}
+
+
+
+  template <typename VectorType>
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  SolverDeflatedCG<VectorType>::solve(const MatrixType         &A,
+                                      VectorType               &x,
+                                      const VectorType         &b,
+                                      const PreconditionerType &preconditioner)
+  {
+    using namespace dealii;
+    using Pointer = typename VectorMemory<VectorType>::Pointer;
+
+    Assert(space, ExcNotInitialized());
+    auto &W  = space->vectors;
+    auto &AW = space->products;
+    auto &P  = space->harvested_directions;
+    auto &AP = space->harvested_products;
+
+    // The space cannot be reused if the vectors changed
+    if (!W.empty() &&
+        W[0].locally_owned_elements() != x.locally_owned_elements())
+      space->clear();
+
+    // Harvest the search directions, and refresh the space after this solve
+    const unsigned int k        = W.size();
+    const unsigned int interval = additional_data.refresh_interval;
+    const bool         refresh =
+      (k == 0) || (interval > 0 && (space->n_solves + 1) % interval == 0);
+
+    std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+
+    // Multiply the deflation space by the current operator, unless the
+    // products of a constant operator are available, and invert the Galerkin
+    // matrix E = W^T A W
+    FullMatrix<double> E_inv(k, k);
+    if (!additional_data.constant_operator || AW.size() != k)
+      {
+        AW.resize(k);
+        for (unsigned int i = 0; i < k; ++i)
+          {
+            AW[i].reinit(x, true);
+            A.vmult(AW[i], W[i]);
+          }
+      }
+    if (k > 0)
+      {
+        for (unsigned int i = 0; i < k; ++i)
+          for (unsigned int j = i; j < k; ++j)
+            pairs.emplace_back(&W[i], &AW[j]);
+        const auto         d = internal::FusedReductions::dot_products(pairs);
+        FullMatrix<double> E(k, k);
+        unsigned int       n = 0;
+        for (unsigned int i = 0; i < k; ++i)
+          for (unsigned int j = i; j < k; ++j)
+            E(i, j) = E(j, i) = d[n++];
+        E_inv.invert(E);
+      }
+    dealii::Vector<double> c(k);
+    dealii::Vector<double> y(k);
+
+    Pointer r(this->memory), z(this->memory);
+    Pointer p(this->memory), Ap(this->memory);
+    for (auto *v : {r.get(), z.get(), p.get(), Ap.get()})
+      v->reinit(x);
+
+    // r = b - Ax. Correct the initial guess, so that the residual is
+    // orthogonal to the deflation space.
+    A.vmult(*r, x);
+    r->sadd(-1.0, 1.0, b);
+    if (k > 0)
+      {
+        pairs.clear();
+        for (unsigned int i = 0; i < k; ++i)
+          pairs.emplace_back(&W[i], r.get());
+        const auto d = internal::FusedReductions::dot_products(pairs);
+        std::copy(d.begin(), d.end(), c.begin());
+        E_inv.vmult(y, c);
+        for (unsigned int i = 0; i < k; ++i)
+          {
+            x.add(y[i], W[i]);
+            r->add(-y[i], AW[i]);
+          }
+      }
+    preconditioner.vmult(*z, *r);
+
+    if (refresh)
+      {
+        P.clear();
+        AP.clear();
+      }
+
+    double                gamma_old = 0;
+    double                residual  = 0;
+    unsigned int          it        = 0;
+    SolverControl::State conv      = SolverControl::iterate;
+    while (true)
+      {
+        // Fused reduction for the CG scalars, the residual, and the
+        // projection of the preconditioned residual on A W
+        pairs.clear();
+        pairs.emplace_back(r.get(), z.get());
+        pairs.emplace_back(r.get(), r.get());
+        for (unsigned int i = 0; i < k; ++i)
+          pairs.emplace_back(&AW[i], z.get());
+        const auto   d     = internal::FusedReductions::dot_products(pairs);
+        const double gamma = d[0];
+        residual           = std::sqrt(std::abs(d[1]));
+
+        conv = this->iteration_status(it, residual, x);
+        if (conv != SolverControl::iterate)
+          break;
+
+        // p = z + beta p - W E^{-1} (AW)^T z
+        if (it == 0)
+          *p = *z;
+        else
+          p->sadd(gamma / gamma_old, 1.0, *z);
+        if (k > 0)
+          {
+            std::copy(d.begin() + 2, d.end(), c.begin());
+            E_inv.vmult(y, c);
+            for (unsigned int i = 0; i < k; ++i)
+              p->add(-y[i], W[i]);
+          }
+
+        A.vmult(*Ap, *p);
+        const double delta =
+          internal::FusedReductions::dot_products<VectorType>(
+            {{p.get(), Ap.get()}})[0];
+        AssertThrow(delta != 0.0,
+                    ExcMessage("Breakdown of the deflated CG method."));
+
+        if (refresh && P.size() < additional_data.dimension)
+          {
+            P.push_back(*p);
+            AP.push_back(*Ap);
+          }
+
+        const double alpha = gamma / delta;
+        x.add(alpha, *p);
+        r->add(-alpha, *Ap);
+        preconditioner.vmult(*z, *r);
+
+        gamma_old = gamma;
+        ++it;
+      }
+
+    // Statistics
+    if (k == 0)
+      space->reference_iterations = it;
+    else
+      space->saved_iterations +=
+        static_cast<int>(space->reference_iterations) - static_cast<int>(it);
+    space->last_iterations = it;
+    ++space->n_solves;
+
+    if (additional_data.log_statistics)
+      deallog << "Deflated CG: " << it << " iterations with " << k
+              << " deflation vectors, " << space->saved_iterations
+              << " iterations saved in " << space->n_solves << " solves"
+              << std::endl;
+
+    if (refresh && !P.empty())
+      refresh_space(x);
+
+    AssertThrow(conv == SolverControl::success,
+                SolverControl::NoConvergence(it, residual));
+  }
+
+
+
+  template <typename VectorType>
+  void
+  SolverDeflatedCG<VectorType>::refresh_space(const VectorType &exemplar)
+  {
+    using namespace dealii;
+
+    std::vector<const VectorType *> Z;
+    std::vector<const VectorType *> AZ;
+    for (unsigned int i = 0; i < space->vectors.size(); ++i)
+      {
+        Z.push_back(&space->vectors[i]);
+        AZ.push_back(&space->products[i]);
+      }
+    for (unsigned int i = 0; i < space->harvested_directions.size(); ++i)
+      {
+        Z.push_back(&space->harvested_directions[i]);
+        AZ.push_back(&space->harvested_products[i]);
+      }
+    const unsigned int n = Z.size();
+
+    // Z^T A Z and Z^T Z, with a single reduction
+    std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+    for (unsigned int i = 0; i < n; ++i)
+      for (unsigned int j = i; j < n; ++j)
+        {
+          pairs.emplace_back(Z[i], AZ[j]);
+          pairs.emplace_back(Z[i], Z[j]);
+        }
+    const auto d = internal::FusedReductions::dot_products(pairs);
+
+    LAPACKFullMatrix<double> ZtAZ(n, n);
+    LAPACKFullMatrix<double> ZtZ(n, n);
+    unsigned int             k = 0;
+    for (unsigned int i = 0; i < n; ++i)
+      for (unsigned int j = i; j < n; ++j)
+        {
+          ZtAZ(i, j) = ZtAZ(j, i) = d[k++];
+          ZtZ(i, j) = ZtZ(j, i) = d[k++];
+        }
+
+    // The search directions are A-conjugate, so that Z^T A Z is well
+    // conditioned, while Z^T Z may not be. Solve Z^T Z y = mu Z^T A Z y: the
+    // largest mu are the inverses of the smallest Ritz values.
+    std::vector<dealii::Vector<double>> eigenvectors(
+      n, dealii::Vector<double>(n));
+    ZtZ.compute_generalized_eigenvalues_symmetric(ZtAZ, eigenvectors);
+
+    // The products with the operator are the same linear combinations of
+    // the products of Z
+    const unsigned int      dimension = std::min(additional_data.dimension, n);
+    std::vector<VectorType> vectors(dimension);
+    std::vector<VectorType> products(dimension);
+    for (unsigned int j = 0; j < dimension; ++j)
+      {
+        const auto &e = eigenvectors[n - 1 - j];
+        vectors[j].reinit(exemplar);
+        products[j].reinit(exemplar);
+        for (unsigned int i = 0; i < n; ++i)
+          {
+            vectors[j].add(e[i], *Z[i]);
+            products[j].add(e[i], *AZ[i]);
+          }
+      }
+
+    space->vectors  = std::move(vectors);
+    space->products = std::move(products);
+    space->harvested_directions.clear();
+    space->harvested_products.clear();
+  }
+#endif
+} // namespace ParsedLAC
+
+#endif
@@ -0,0 +1,296 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_direct_solver_h
+#define parsed_lac_direct_solver_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/parameter_acceptor.h>
+
+#include <deal.II/lac/block_sparse_matrix.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/sparse_direct.h>
+#include <deal.II/lac/sparse_matrix.h>
+#include <deal.II/lac/vector.h>
+
+#ifdef DEAL_II_WITH_PETSC
+#  include <deal.II/lac/petsc_block_sparse_matrix.h>
+#  include <deal.II/lac/petsc_solver.h>
+#  include <deal.II/lac/petsc_sparse_matrix.h>
+#  include <deal.II/lac/petsc_vector.h>
+#endif
+
+#ifdef DEAL_II_WITH_TRILINOS
+#  include <deal.II/lac/trilinos_block_sparse_matrix.h>
+#  include <deal.II/lac/trilinos_solver.h>
+#  include <deal.II/lac/trilinos_sparse_matrix.h>
+#  include <deal.II/lac/trilinos_vector.h>
+#endif
+
+#include <memory>
+
+namespace ParsedLAC
+{
+  /**
+   * Checksums of the sparsity pattern and of the values of a (block) sparse
+   * matrix, used to detect if a matrix changed since the last call to
+   * update(). Two matrices with the same Frobenius norm, for example with
+   * permuted or sign flipped entries, have different checksums.
+   */
+  class MatrixChecksum
+  {
+  public:
+    /**
+     * Compute the checksums of @p matrix, compare them with the stored ones,
+     * and store the new ones. Return true if the sparsity pattern or the
+     * values of @p matrix changed, or if this is the first call.
+     * @p pattern_changed is set to true if the sparsity pattern changed. The
+     * answer is the same on all processes.
+     */
+    template <typename MatrixType>
+    bool
+    update(const MatrixType &matrix, bool &pattern_changed);
+
+    /**
+     * Same as above, ignoring if the sparsity pattern changed.
+     */
+    template <typename MatrixType>
+    bool
+    update(const MatrixType &matrix);
+
+    /**
+     * Forget the stored checksums: the next call to update() returns true.
+     */
+    void
+    clear();
+
+  private:
+    /**
+     * Checksum of the sparsity pattern of the last matrix.
+     */
+    std::size_t pattern_checksum = 0;
+
+    /**
+     * Checksum of the values of the last matrix.
+     */
+    std::size_t values_checksum = 0;
+
+    /**
+     * True if the checksums have been computed at least once.
+     */
+    bool initialized = false;
+  };
+
+
+
+  /**
+   * A parsed direct solver, that reuses its factorization across calls.
+   *
+   * The backend is chosen according to the matrix type: UMFPACK for
+   * dealii::SparseMatrix, Amesos for TrilinosWrappers::SparseMatrix, and MUMPS
+   * for PETScWrappers::MPI::SparseMatrix.
+   *
+   * Every call to initialize() computes a checksum of the sparsity pattern and
+   * of the values of the matrix. If both are unchanged since the last
+   * factorization, the factorization is kept, and vmult() only performs the
+   * triangular solves. The UMFPACK and Amesos wrappers of deal.II do not
+   * expose the symbolic and numeric phases separately, and refactor the matrix
+   * from scratch when its values change. The MUMPS backend is only rebuilt
+   * when the sparsity pattern changes: PETSc keeps the symbolic factorization,
+   * and recomputes the numeric one whenever the matrix is reassembled.
+   *
+   * The object can be used wherever a preconditioner or a matrix is expected,
+   * for example
+   * @code
+   * DirectSolver direct("/Solver");
+   * ParameterAcceptor::initialize(...);
+   *
+   * direct.initialize(A);
+   * auto A_inv = linear_operator(A_op, direct);
+   * @endcode
+   *
+   * The parameter file is expected to have the following structure:
+   * @code{.sh}
+   * set Use direct solver   = false
+   * set Reuse factorization = true
+   * @endcode
+   */
+  class DirectSolver : public dealii::ParameterAcceptor
+  {
+  public:
+    /**
+     * Constructor.
+     *
+     * @param section_name The section of the parameter file where the
+     * parameters are stored.
+     * @param use_direct_solver Default value of the "Use direct solver"
+     * parameter.
+     * @param reuse_factorization Default value of the "Reuse factorization"
+     * parameter.
+     */
+    DirectSolver(const std::string &section_name        = "",
+                 const bool         use_direct_solver   = false,
+                 const bool         reuse_factorization = true);
+
+    /**
+     * Return true if the user asked for a direct solver in the parameter
+     * file.
+     */
+    bool
+    enabled() const;
+
+    /**
+     * Factorize the matrix, unless the previous factorization can be reused.
+     */
+    void
+    initialize(const dealii::SparseMatrix<double> &matrix);
+
+    /**
+     * Solve with the last factorized matrix.
+     */
+    void
+    vmult(dealii::Vector<double> &dst, const dealii::Vector<double> &src) const;
+
+    /**
+     * Solve with the transpose of the last factorized matrix.
+     */
+    void
+    Tvmult(dealii::Vector<double>       &dst,
+           const dealii::Vector<double> &src) const;
+
+#ifdef DEAL_II_WITH_TRILINOS
+    /**
+     * Factorize the matrix, unless the previous factorization can be reused.
+     */
+    void
+    initialize(const dealii::TrilinosWrappers::SparseMatrix &matrix);
+
+    /**
+     * Solve with the last factorized matrix.
+     */
+    void
+    vmult(dealii::TrilinosWrappers::MPI::Vector       &dst,
+          const dealii::TrilinosWrappers::MPI::Vector &src) const;
+
+    /**
+     * Not implemented.
+     */
+    void
+    Tvmult(dealii::TrilinosWrappers::MPI::Vector       &dst,
+           const dealii::TrilinosWrappers::MPI::Vector &src) const;
+#endif
+
+#ifdef DEAL_II_WITH_PETSC
+    /**
+     * Factorize the matrix, unless the previous factorization can be reused.
+     */
+    void
+    initialize(const dealii::PETScWrappers::MPI::SparseMatrix &matrix);
+
+    /**
+     * Solve with the last factorized matrix.
+     */
+    void
+    vmult(dealii::PETScWrappers::MPI::Vector       &dst,
+          const dealii::PETScWrappers::MPI::Vector &src) const;
+
+    /**
+     * Not implemented.
+     */
+    void
+    Tvmult(dealii::PETScWrappers::MPI::Vector       &dst,
+           const dealii::PETScWrappers::MPI::Vector &src) const;
+#endif
+
+    /**
+     * Release the factorization.
+     */
+    void
+    clear();
+
+    /**
+     * Number of (numeric) factorizations computed so far.
+     */
+    unsigned int
+    n_factorizations() const;
+
+  private:
+    /**
+     * Compare the checksums of @p matrix with the stored ones, and update
+     * them. Return true if the matrix needs to be factorized again.
+     * @p pattern_changed is set to true if the sparsity pattern changed.
+     */
+    template <typename MatrixType>
+    bool
+    needs_factorization(const MatrixType &matrix, bool &pattern_changed);
+
+    /**
+     * Use a direct solver.
+     */
+    bool use_direct_solver;
+
+    /**
+     * Reuse the factorization when the matrix did not change.
+     */
+    bool reuse_factorization;
+
+    /**
+     * Checksums of the last factorized matrix.
+     */
+    MatrixChecksum checksum;
+
+    /**
+     * True if a factorization is available.
+     */
+    bool is_factorized = false;
+
+    /**
+     * Number of factorizations computed so far.
+     */
+    unsigned int factorization_counter = 0;
+
+    /**
+     * Used by the Trilinos and PETSc backends.
+     */
+    mutable dealii::SolverControl control;
+
+    /**
+     * Serial backend.
+     */
+    std::unique_ptr<dealii::SparseDirectUMFPACK> umfpack;
+
+#ifdef DEAL_II_WITH_TRILINOS
+    /**
+     * Trilinos backend.
+     */
+    std::unique_ptr<dealii::TrilinosWrappers::SolverDirect> amesos;
+#endif
+
+#ifdef DEAL_II_WITH_PETSC
+    /**
+     * PETSc backend.
+     */
+    std::unique_ptr<dealii::PETScWrappers::SparseDirectMUMPS> mumps;
+
+    /**
+     * The MUMPS backend needs the matrix at every solve.
+     */
+    const dealii::PETScWrappers::MPI::SparseMatrix *petsc_matrix = nullptr;
+#endif
+  };
+} // namespace ParsedLAC
+
+#endif
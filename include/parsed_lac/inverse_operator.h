@@ -32,6 +32,14 @@
 #include <deal.II/lac/solver_qmrs.h>
 #include <deal.II/lac/solver_richardson.h>
 
+#include <algorithm>
+#include <typeinfo>
+
+#include "parsed_lac/block_cg.h"
+#include "parsed_lac/deflated_cg.h"
+#include "parsed_lac/pipelined_solvers.h"
+#include "parsed_lac/solver_telemetry.h"
+
 namespace ParsedLAC
 {
   /**
@@ -65,14 +73,19 @@ namespace ParsedLAC
    *
    * The parameter file is expected to have the following structure:
    * @code{.sh}
-   * set Solver name            = cg
-   * set Solver control type    = tolerance
-   * set Absolute tolerance     = 1e-12
-   * set Relative tolerance     = 1e-12
-   * set Maximum iterations     = 1000
-   * set Consecutive iterations = 2
-   * set Log history            = false
-   * set Log result             = false
+   * set Solver name                 = cg
+   * set Solver control type         = tolerance
+   * set Absolute tolerance          = 1e-12
+   * set Relative tolerance          = 1e-12
+   * set Maximum iterations          = 1000
+   * set Consecutive iterations      = 2
+   * set Log history                 = false
+   * set Log result                  = false
+   * set S-step size                 = 4
+   * set Restart length              = 30
+   * set Deflation dimension         = 8
+   * set Deflation refresh           = 5
+   * set Deflation constant operator = false
    * @endcode
    *
    * Every solver control type uses the absolute tolerance, the maximum
@@ -85,6 +98,39 @@ namespace ParsedLAC
    * It is thought to be used as an inner solver, for the cases in which you
    * want to apply a fixed number of smoothing iterations, regardless of the
    * reached tolerance.
+   *
+   * Besides the solvers of deal.II, three solvers that reduce the number of
+   * global reductions per iteration are available: `pipecg` (pipelined CG,
+   * see SolverPipeCG), `sstepcg` (s-step CG, see SolverSStepCG, which uses
+   * the `S-step size` parameter), and `srgmres` (single reduction GMRES, see
+   * SolverSingleReductionGMRES). All the GMRES solvers restart after
+   * `Restart length` iterations, except `gmres` with deal.II older than 9.6,
+   * which uses `Restart length` as the total number of its vectors, and
+   * restarts two iterations earlier. The default of 30 matches the default
+   * of deal.II in both cases.
+   *
+   * The `dcg` solver (deflated CG, see SolverDeflatedCG) recycles a small
+   * deflation space across successive solves, which is useful when solving
+   * many times with slowly changing operators, e.g., in quasi-static
+   * simulations. The space is kept in this object, one for each prefix and
+   * vector type, has at most `Deflation dimension` vectors, and is refreshed
+   * every `Deflation refresh` solves. Every solve multiplies the space by
+   * the operator, i.e., it costs `Deflation dimension` additional products
+   * with the operator, unless `Deflation constant operator` is true. Set it
+   * when all the solves use the same operator, in particular if its products
+   * are expensive, as for a Schur complement. If `Log result` is true, the
+   * number of iterations saved with respect to the first (non deflated)
+   * solve is printed after every solve.
+   *
+   * Several right hand sides that share the same symmetric positive definite
+   * operator can be solved together with solve_block(), which always uses the
+   * block CG method (see SolverBlockCG), with the solver control described
+   * above.
+   *
+   * When SolverTelemetry is enabled, every solve adds a SolveRecord to its
+   * registry, labeled with the section name of this object. The matrix and
+   * the preconditioner are then wrapped in objects that count their
+   * applications and measure the time spent in the preconditioner.
    */
   class InverseOperator : public dealii::ParameterAcceptor
   {
@@ -182,6 +228,23 @@ namespace ParsedLAC
           const double              abs_tol = 0.0) const;
 
 
+    /**
+     * Solve the systems with all the right hand sides in @p src together,
+     * with the block CG method, using the solver control specified in the
+     * parameter file, or a SolverControl with tolerance @p abs_tol if it is
+     * non-zero. The vectors in @p dst are used as initial guesses. The
+     * `Solver name` parameter is ignored.
+     */
+    template <typename MatrixType,
+              typename PreconditionerType,
+              typename VectorType>
+    void
+    solve_block(const MatrixType              &matrix,
+                const PreconditionerType      &preconditioner,
+                const std::vector<VectorType> &src,
+                std::vector<VectorType>       &dst,
+                const double                   abs_tol = 0.0) const;
+
     /**
      * Get the solver name.
      */
@@ -205,7 +268,45 @@ namespace ParsedLAC
     std::shared_ptr<dealii::SolverBase<Range>>
     setup_new_solver(const double abs_tol = 0.0) const;
 
+    /**
+     * Return the deflation space recycled by the `dcg` solver, for the given
+     * vector type and prefix. The space also stores the iteration counts of
+     * the solves that used it.
+     */
+    template <typename VectorType>
+    std::shared_ptr<DeflationSpace<VectorType>>
+    get_deflation_space(const std::string &prefix = "") const;
+
   private:
+    /**
+     * Run the solver selected in the parameter file, using the current
+     * solver control.
+     */
+    template <typename MatrixType,
+              typename PreconditionerType,
+              typename VectorType>
+    void
+    run_solver(const MatrixType         &matrix,
+               const PreconditionerType &preconditioner,
+               const VectorType         &src,
+               VectorType               &dst) const;
+
+    /**
+     * Additional data of the GMRES solver of deal.II, with a Krylov space of
+     * dimension `Restart length` (with deal.II 9.6 or newer), or with
+     * `Restart length` vectors in total (with older versions).
+     */
+    template <typename VectorType>
+    typename dealii::SolverGMRES<VectorType>::AdditionalData
+    gmres_additional_data() const;
+
+    /**
+     * Number of iterations after which the selected solver restarts, used to
+     * estimate the number of global reductions of the GMRES solvers.
+     */
+    unsigned int
+    actual_restart_length() const;
+
     /**
      * Defines the behaviour of the solver control.
      */
@@ -254,6 +355,31 @@ namespace ParsedLAC
      */
     bool log_result;
 
+    /**
+     * Number of iterations per reduction of the s-step CG solver.
+     */
+    unsigned int s_step_size = 4;
+
+    /**
+     * Restart length of the GMRES solvers.
+     */
+    unsigned int restart_length = 30;
+
+    /**
+     * Maximum dimension of the deflation space of the deflated CG solver.
+     */
+    unsigned int deflation_dimension = 8;
+
+    /**
+     * Number of solves between two refreshes of the deflation space.
+     */
+    unsigned int deflation_refresh = 5;
+
+    /**
+     * Reuse the products of the deflation space with the operator.
+     */
+    bool deflation_constant_operator = false;
+
     /**
      * Local storage for the actual solver object.
      */
@@ -276,6 +402,113 @@ namespace ParsedLAC
                          const double              abs_tol) const
   {
     control = setup_new_solver_control(abs_tol);
+    if (SolverTelemetry::enabled() == false)
+      {
+        run_solver(matrix, preconditioner, src, dst);
+        return;
+      }
+
+    using namespace internal::SolverTelemetryImplementation;
+    SolverTelemetry::Probe probe(get_section_name(),
+                                 solver_name,
+                                 *control,
+                                 actual_restart_length());
+    const CountingMatrix<MatrixType> counting_matrix{matrix, probe.counters};
+    const TimedPreconditioner<PreconditionerType> timed_preconditioner{
+      preconditioner, probe.counters};
+    const auto n_local_dofs = dst.locally_owned_elements().n_elements();
+    try
+      {
+        run_solver(counting_matrix, timed_preconditioner, src, dst);
+      }
+    catch (...)
+      {
+        probe.finish(n_local_dofs, matrix_memory(matrix));
+        throw;
+      }
+    probe.finish(n_local_dofs, matrix_memory(matrix));
+  }
+
+
+
+  template <typename MatrixType,
+            typename PreconditionerType,
+            typename VectorType>
+  void
+  InverseOperator::solve_block(const MatrixType              &matrix,
+                               const PreconditionerType      &preconditioner,
+                               const std::vector<VectorType> &src,
+                               std::vector<VectorType>       &dst,
+                               const double                   abs_tol) const
+  {
+    control = setup_new_solver_control(abs_tol);
+    SolverBlockCG<VectorType> solver(*control);
+    if (SolverTelemetry::enabled() == false || dst.empty())
+      {
+        solver.solve(matrix, dst, src, preconditioner);
+        return;
+      }
+
+    using namespace internal::SolverTelemetryImplementation;
+    SolverTelemetry::Probe probe(get_section_name(), "block cg", *control);
+    const CountingMatrix<MatrixType> counting_matrix{matrix, probe.counters};
+    const TimedPreconditioner<PreconditionerType> timed_preconditioner{
+      preconditioner, probe.counters};
+    const auto n_local_dofs = dst[0].locally_owned_elements().n_elements();
+    try
+      {
+        solver.solve(counting_matrix, dst, src, timed_preconditioner);
+      }
+    catch (...)
+      {
+        probe.finish(n_local_dofs, matrix_memory(matrix));
+        throw;
+      }
+    probe.finish(n_local_dofs, matrix_memory(matrix));
+  }
+
+
+
+  template <typename VectorType>
+  typename dealii::SolverGMRES<VectorType>::AdditionalData
+  InverseOperator::gmres_additional_data() const
+  {
+    typename dealii::SolverGMRES<VectorType>::AdditionalData data;
+#if DEAL_II_VERSION_GTE(9, 6, 0)
+    data.max_basis_size = restart_length;
+#else
+    // Two of the temporary vectors are not part of the Krylov space. deal.II
+    // requires at least three of them.
+    data.max_n_tmp_vectors = std::max(restart_length, 3u);
+#endif
+    return data;
+  }
+
+
+
+  inline unsigned int
+  InverseOperator::actual_restart_length() const
+  {
+#if DEAL_II_VERSION_GTE(9, 6, 0)
+    return restart_length;
+#else
+    if (solver_name == "gmres")
+      return std::max(restart_length, 3u) - 2;
+    return restart_length;
+#endif
+  }
+
+
+
+  template <typename MatrixType,
+            typename PreconditionerType,
+            typename VectorType>
+  void
+  InverseOperator::run_solver(const MatrixType         &matrix,
+                              const PreconditionerType &preconditioner,
+                              const VectorType         &src,
+                              VectorType               &dst) const
+  {
     if (solver_name == "cg")
       {
         dealii::SolverCG<VectorType> solver(*control);
@@ -288,12 +521,16 @@ namespace ParsedLAC
       }
     else if (solver_name == "gmres")
       {
-        dealii::SolverGMRES<VectorType> solver(*control);
+        dealii::SolverGMRES<VectorType> solver(
+          *control, gmres_additional_data<VectorType>());
         solver.solve(matrix, dst, src, preconditioner);
       }
     else if (solver_name == "fgmres")
       {
-        dealii::SolverFGMRES<VectorType> solver(*control);
+        dealii::SolverFGMRES<VectorType> solver(
+          *control,
+          typename dealii::SolverFGMRES<VectorType>::AdditionalData(
+            restart_length));
         solver.solve(matrix, dst, src, preconditioner);
       }
     else if (solver_name == "minres")
@@ -311,6 +548,38 @@ namespace ParsedLAC
         dealii::SolverRichardson<VectorType> solver(*control);
         solver.solve(matrix, dst, src, preconditioner);
       }
+    else if (solver_name == "pipecg")
+      {
+        SolverPipeCG<VectorType> solver(*control);
+        solver.solve(matrix, dst, src, preconditioner);
+      }
+    else if (solver_name == "sstepcg")
+      {
+        SolverSStepCG<VectorType> solver(
+          *control,
+          typename SolverSStepCG<VectorType>::AdditionalData(s_step_size));
+        solver.solve(matrix, dst, src, preconditioner);
+      }
+    else if (solver_name == "srgmres")
+      {
+        SolverSingleReductionGMRES<VectorType> solver(
+          *control,
+          typename SolverSingleReductionGMRES<VectorType>::AdditionalData(
+            restart_length));
+        solver.solve(matrix, dst, src, preconditioner);
+      }
+    else if (solver_name == "dcg")
+      {
+        SolverDeflatedCG<VectorType> solver(
+          *control,
+          get_deflation_space<VectorType>(),
+          typename SolverDeflatedCG<VectorType>::AdditionalData(
+            deflation_dimension,
+            deflation_refresh,
+            log_result,
+            deflation_constant_operator));
+        solver.solve(matrix, dst, src, preconditioner);
+      }
     else
       {
         Assert(false,
@@ -341,9 +610,29 @@ namespace ParsedLAC
 
     dealii::LinearOperator<Range, Domain, Payload> inverse;
 
+    // When collecting telemetry, count the products with the operator and
+    // the applications of the preconditioner. The counters are shared by
+    // the wrappers and by the inverse operator, and are reset at every solve.
+    using TimedPreconditioner = internal::SolverTelemetryImplementation::
+      TimedPreconditioner<PreconditionerType>;
+    const bool telemetry   = SolverTelemetry::enabled();
+    const auto counters    = std::make_shared<SolverTelemetry::Counters>();
+    const auto timed_prec  = std::make_shared<TimedPreconditioner>(
+      TimedPreconditioner{prec, counters});
+    auto       counting_op = op;
+    if (telemetry)
+      counting_op.vmult = [vmult = op.vmult, counters](auto       &dst,
+                                                       const auto &src) {
+        ++counters->n_matvecs;
+        vmult(dst, src);
+      };
+
     auto initialize_solver = [&](auto *s) {
       solver.reset(s);
-      inverse = dealii::inverse_operator(op, *s, prec);
+      if (telemetry)
+        inverse = dealii::inverse_operator(counting_op, *s, *timed_prec);
+      else
+        inverse = dealii::inverse_operator(op, *s, prec);
     };
 
     if (solver_name == "cg")
@@ -356,11 +645,15 @@ namespace ParsedLAC
       }
     else if (solver_name == "gmres")
       {
-        initialize_solver(new dealii::SolverGMRES<Range>(*control));
+        initialize_solver(new dealii::SolverGMRES<Range>(
+          *control, gmres_additional_data<Range>()));
       }
     else if (solver_name == "fgmres")
       {
-        initialize_solver(new dealii::SolverFGMRES<Range>(*control));
+        initialize_solver(new dealii::SolverFGMRES<Range>(
+          *control,
+          typename dealii::SolverFGMRES<Range>::AdditionalData(
+            restart_length)));
       }
     else if (solver_name == "minres")
       {
@@ -374,11 +667,73 @@ namespace ParsedLAC
       {
         initialize_solver(new dealii::SolverRichardson<Range>(*control));
       }
+    else if (solver_name == "pipecg")
+      {
+        initialize_solver(new SolverPipeCG<Range>(*control));
+      }
+    else if (solver_name == "sstepcg")
+      {
+        initialize_solver(new SolverSStepCG<Range>(
+          *control,
+          typename SolverSStepCG<Range>::AdditionalData(s_step_size)));
+      }
+    else if (solver_name == "srgmres")
+      {
+        initialize_solver(new SolverSingleReductionGMRES<Range>(
+          *control,
+          typename SolverSingleReductionGMRES<Range>::AdditionalData(
+            restart_length)));
+      }
+    else if (solver_name == "dcg")
+      {
+        initialize_solver(new SolverDeflatedCG<Range>(
+          *control,
+          get_deflation_space<Range>(prefix),
+          typename SolverDeflatedCG<Range>::AdditionalData(
+            deflation_dimension,
+            deflation_refresh,
+            log_result,
+            deflation_constant_operator)));
+      }
     else
       {
         Assert(false,
                dealii::ExcInternalError("Solver should not be unknonw."));
       }
+
+    if (telemetry)
+      {
+        // The timed preconditioner is captured by the wrappers, so that it
+        // lives as long as the inverse operator.
+        const auto label   = get_section_name();
+        const auto name    = solver_name;
+        const auto restart = actual_restart_length();
+        auto      &current = *control;
+        auto       wrap =
+          [label, name, restart, counters, timed_prec, &current](
+            const auto &function) {
+            return [=, &current](auto &dst, const auto &src) {
+              *counters = SolverTelemetry::Counters();
+              SolverTelemetry::Probe probe(label, name, current, restart);
+              const auto n_local_dofs =
+                dst.locally_owned_elements().n_elements();
+              try
+                {
+                  function(dst, src);
+                }
+              catch (...)
+                {
+                  *probe.counters = *counters;
+                  probe.finish(n_local_dofs);
+                  throw;
+                }
+              *probe.counters = *counters;
+              probe.finish(n_local_dofs);
+            };
+          };
+        inverse.vmult     = wrap(inverse.vmult);
+        inverse.vmult_add = wrap(inverse.vmult_add);
+      }
     return inverse;
   }
 
@@ -397,6 +752,20 @@ namespace ParsedLAC
   {
     return solver<Range, Payload>(op, prec, abs_tol, prefix);
   }
+
+
+
+  template <typename VectorType>
+  std::shared_ptr<DeflationSpace<VectorType>>
+  InverseOperator::get_deflation_space(const std::string &prefix) const
+  {
+    using SpaceType = std::shared_ptr<DeflationSpace<VectorType>>;
+    auto &space = storage.template get_or_add_object_with_name<SpaceType>(
+      prefix + "deflation space " + typeid(VectorType).name());
+    if (!space)
+      space = std::make_shared<DeflationSpace<VectorType>>();
+    return space;
+  }
 #endif
 } // namespace ParsedLAC
 
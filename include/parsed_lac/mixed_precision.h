@@ -0,0 +1,193 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_mixed_precision_h
+#define parsed_lac_mixed_precision_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/parameter_acceptor.h>
+
+#include <deal.II/lac/precondition.h>
+#include <deal.II/lac/sparse_ilu.h>
+#include <deal.II/lac/sparse_matrix.h>
+#include <deal.II/lac/vector.h>
+
+#ifdef DEAL_II_WITH_PETSC
+#  include <deal.II/lac/petsc_sparse_matrix.h>
+#  include <deal.II/lac/petsc_vector.h>
+#endif
+
+#ifdef DEAL_II_WITH_TRILINOS
+#  include <deal.II/lac/trilinos_sparse_matrix.h>
+#  include <deal.II/lac/trilinos_vector.h>
+#endif
+
+namespace ParsedLAC
+{
+  /**
+   * A parsed preconditioner that is built and applied in single precision.
+   *
+   * The system matrix is copied into a SparseMatrix<float>, on which a
+   * Jacobi, SSOR, or ILU preconditioner is built. When the preconditioner is
+   * applied, the input vector is converted to float, the preconditioner is
+   * applied, and the result is converted back to double. This halves the
+   * memory traffic of the preconditioner, while the outer Krylov solver,
+   * which computes its residuals in double precision, still converges to
+   * double precision accuracy.
+   *
+   * Since rounding makes the preconditioner slightly nonlinear, a flexible
+   * outer solver (i.e., `fgmres`) is the safest choice.
+   *
+   * Only the serial deal.II linear algebra is supported: the Trilinos and
+   * PETSc preconditioners are available in double precision only.
+   *
+   * The parameter file is expected to have the following structure:
+   * @code{.sh}
+   * set Use single precision   = false
+   * set Type                   = ilu
+   * set Relaxation parameter   = 1
+   * set Strengthen diagonal    = 0
+   * set Extra off diagonals    = 0
+   * @endcode
+   */
+  class MixedPrecisionPreconditioner : public dealii::ParameterAcceptor
+  {
+  public:
+    /**
+     * Constructor.
+     */
+    MixedPrecisionPreconditioner(
+      const std::string &section_name         = "",
+      const bool         use_single_precision = false,
+      const std::string &type                 = "ilu",
+      const double       relaxation           = 1.0);
+
+    /**
+     * Return true if the user asked for a single precision preconditioner.
+     */
+    bool
+    enabled() const;
+
+    /**
+     * Copy the matrix in single precision, and build the preconditioner.
+     */
+    void
+    initialize(const dealii::SparseMatrix<double> &matrix);
+
+    /**
+     * Apply the preconditioner.
+     */
+    void
+    vmult(dealii::Vector<double> &dst, const dealii::Vector<double> &src) const;
+
+    /**
+     * Apply the transpose of the preconditioner.
+     */
+    void
+    Tvmult(dealii::Vector<double>       &dst,
+           const dealii::Vector<double> &src) const;
+
+#ifdef DEAL_II_WITH_TRILINOS
+    /**
+     * Not implemented. Throws an exception.
+     */
+    void
+    initialize(const dealii::TrilinosWrappers::SparseMatrix &matrix);
+
+    /**
+     * Not implemented. Throws an exception.
+     */
+    void
+    vmult(dealii::TrilinosWrappers::MPI::Vector       &dst,
+          const dealii::TrilinosWrappers::MPI::Vector &src) const;
+
+    /**
+     * Not implemented. Throws an exception.
+     */
+    void
+    Tvmult(dealii::TrilinosWrappers::MPI::Vector       &dst,
+           const dealii::TrilinosWrappers::MPI::Vector &src) const;
+#endif
+
+#ifdef DEAL_II_WITH_PETSC
+    /**
+     * Not implemented. Throws an exception.
+     */
+    void
+    initialize(const dealii::PETScWrappers::MPI::SparseMatrix &matrix);
+
+    /**
+     * Not implemented. Throws an exception.
+     */
+    void
+    vmult(dealii::PETScWrappers::MPI::Vector       &dst,
+          const dealii::PETScWrappers::MPI::Vector &src) const;
+
+    /**
+     * Not implemented. Throws an exception.
+     */
+    void
+    Tvmult(dealii::PETScWrappers::MPI::Vector       &dst,
+           const dealii::PETScWrappers::MPI::Vector &src) const;
+#endif
+
+  private:
+    /**
+     * Use a single precision preconditioner.
+     */
+    bool use_single_precision;
+
+    /**
+     * One of jacobi, ssor, or ilu.
+     */
+    std::string type;
+
+    /**
+     * Relaxation parameter of the jacobi and ssor preconditioners.
+     */
+    double relaxation;
+
+    /**
+     * Strengthen the diagonal of the ILU decomposition.
+     */
+    double strengthen_diagonal = 0.0;
+
+    /**
+     * Extra off diagonals of the ILU decomposition.
+     */
+    unsigned int extra_off_diagonals = 0;
+
+    /**
+     * The system matrix, in single precision.
+     */
+    dealii::SparseMatrix<float> matrix;
+
+    /**
+     * The actual preconditioners.
+     */
+    dealii::PreconditionJacobi<dealii::SparseMatrix<float>> jacobi;
+    dealii::PreconditionSSOR<dealii::SparseMatrix<float>>   ssor;
+    dealii::SparseILU<float>                                ilu;
+
+    /**
+     * Single precision copies of the input and output vectors.
+     */
+    mutable dealii::Vector<float> src_float;
+    mutable dealii::Vector<float> dst_float;
+  };
+} // namespace ParsedLAC
+
+#endif
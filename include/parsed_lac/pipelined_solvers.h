@@ -0,0 +1,819 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_pipelined_solvers_h
+#define parsed_lac_pipelined_solvers_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/solver.h>
+#include <deal.II/lac/solver_control.h>
+#include <deal.II/lac/vector.h>
+#include <deal.II/lac/vector_memory.h>
+
+#ifdef DEAL_II_WITH_PETSC
+#  include <deal.II/lac/exceptions.h>
+#  include <deal.II/lac/petsc_block_vector.h>
+#  include <deal.II/lac/petsc_vector.h>
+#endif
+
+#ifdef DEAL_II_WITH_TRILINOS
+#  include <deal.II/lac/trilinos_parallel_block_vector.h>
+#  include <deal.II/lac/trilinos_vector.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "parsed_lac/solver_telemetry.h"
+
+namespace ParsedLAC
+{
+  namespace internal
+  {
+    /**
+     * Fused reductions: the local parts of many dot products are computed
+     * first, and then summed over all processes with a single call to
+     * MPI_Allreduce.
+     */
+    namespace FusedReductions
+    {
+      /**
+       * The locally owned part of the dot product of two vectors. For serial
+       * vectors, and for vector types without direct access to their local
+       * data, this is the full dot product, and get_mpi_communicator()
+       * returns MPI_COMM_SELF, so that the final sum is a no-op.
+       */
+      template <typename VectorType>
+      double
+      local_dot(const VectorType &a, const VectorType &b)
+      {
+        return a * b;
+      }
+
+      /**
+       * The communicator used to sum the local dot products.
+       */
+      template <typename VectorType>
+      MPI_Comm
+      get_mpi_communicator(const VectorType &)
+      {
+        return MPI_COMM_SELF;
+      }
+
+#ifdef DEAL_II_WITH_TRILINOS
+      inline double
+      local_dot(const dealii::TrilinosWrappers::MPI::Vector &a,
+                const dealii::TrilinosWrappers::MPI::Vector &b)
+      {
+        return std::inner_product(a.begin(), a.end(), b.begin(), 0.0);
+      }
+
+      inline MPI_Comm
+      get_mpi_communicator(const dealii::TrilinosWrappers::MPI::Vector &a)
+      {
+        return a.get_mpi_communicator();
+      }
+
+      inline double
+      local_dot(const dealii::TrilinosWrappers::MPI::BlockVector &a,
+                const dealii::TrilinosWrappers::MPI::BlockVector &b)
+      {
+        double result = 0;
+        for (unsigned int i = 0; i < a.n_blocks(); ++i)
+          result += local_dot(a.block(i), b.block(i));
+        return result;
+      }
+
+      inline MPI_Comm
+      get_mpi_communicator(const dealii::TrilinosWrappers::MPI::BlockVector &a)
+      {
+        return a.block(0).get_mpi_communicator();
+      }
+#endif
+
+#ifdef DEAL_II_WITH_PETSC
+      inline double
+      local_dot(const dealii::PETScWrappers::MPI::Vector &a,
+                const dealii::PETScWrappers::MPI::Vector &b)
+      {
+        const PetscScalar *a_values = nullptr;
+        const PetscScalar *b_values = nullptr;
+        PetscInt           n_local  = 0;
+
+        PetscErrorCode ierr = VecGetLocalSize(a, &n_local);
+        AssertThrow(ierr == 0, dealii::ExcPETScError(ierr));
+        ierr = VecGetArrayRead(a, &a_values);
+        AssertThrow(ierr == 0, dealii::ExcPETScError(ierr));
+        ierr = VecGetArrayRead(b, &b_values);
+        AssertThrow(ierr == 0, dealii::ExcPETScError(ierr));
+
+        double result = 0;
+        for (PetscInt i = 0; i < n_local; ++i)
+          result += PetscRealPart(a_values[i] * b_values[i]);
+
+        ierr = VecRestoreArrayRead(b, &b_values);
+        AssertThrow(ierr == 0, dealii::ExcPETScError(ierr));
+        ierr = VecRestoreArrayRead(a, &a_values);
+        AssertThrow(ierr == 0, dealii::ExcPETScError(ierr));
+        return result;
+      }
+
+      inline MPI_Comm
+      get_mpi_communicator(const dealii::PETScWrappers::MPI::Vector &a)
+      {
+        return a.get_mpi_communicator();
+      }
+
+      inline double
+      local_dot(const dealii::PETScWrappers::MPI::BlockVector &a,
+                const dealii::PETScWrappers::MPI::BlockVector &b)
+      {
+        double result = 0;
+        for (unsigned int i = 0; i < a.n_blocks(); ++i)
+          result += local_dot(a.block(i), b.block(i));
+        return result;
+      }
+
+      inline MPI_Comm
+      get_mpi_communicator(const dealii::PETScWrappers::MPI::BlockVector &a)
+      {
+        return a.block(0).get_mpi_communicator();
+      }
+#endif
+
+      /**
+       * Compute the dot products of all the given pairs of vectors, with a
+       * single global reduction.
+       */
+      template <typename VectorType>
+      std::vector<double>
+      dot_products(
+        const std::vector<std::pair<const VectorType *, const VectorType *>>
+          &pairs)
+      {
+        std::vector<double> result(pairs.size());
+        for (unsigned int i = 0; i < pairs.size(); ++i)
+          result[i] = local_dot(*pairs[i].first, *pairs[i].second);
+        if (pairs.size() > 0)
+          {
+            dealii::Utilities::MPI::sum(result,
+                                        get_mpi_communicator(*pairs[0].first),
+                                        result);
+            if (SolverTelemetry::enabled())
+              SolverTelemetry::count_reduction();
+          }
+        return result;
+      }
+    } // namespace FusedReductions
+  }   // namespace internal
+
+
+
+  /**
+   * Pipelined preconditioned conjugate gradient method, as described by
+   * Ghysels and Vanroose (Parallel Computing, 2014).
+   *
+   * The algorithm is mathematically equivalent to dealii::SolverCG, but it
+   * uses additional recurrences, so that all the dot products of one
+   * iteration (the two scalars of the CG recurrence and the norm of the
+   * residual) are computed with a single global reduction, instead of the
+   * three reductions of the standard algorithm. The price is four more
+   * vector updates per iteration, and a slightly lower attainable accuracy.
+   *
+   * In the original algorithm, the reduction is overlapped with the
+   * application of the preconditioner and of the matrix. The vector
+   * interfaces of deal.II only offer blocking reductions, so here the
+   * reduction is completed before the matrix-vector product starts: the
+   * saving comes from the smaller number of synchronization points.
+   */
+  template <typename VectorType = dealii::Vector<double>>
+  class SolverPipeCG : public dealii::SolverBase<VectorType>
+  {
+  public:
+    /**
+     * Constructor.
+     */
+    SolverPipeCG(dealii::SolverControl            &cn,
+                 dealii::VectorMemory<VectorType> &mem);
+
+    /**
+     * Constructor. Use an object of type GrowingVectorMemory as a default to
+     * allocate memory.
+     */
+    SolverPipeCG(dealii::SolverControl &cn);
+
+    /**
+     * Solve the linear system $Ax=b$ for x.
+     */
+    template <typename MatrixType, typename PreconditionerType>
+    void
+    solve(const MatrixType         &A,
+          VectorType               &x,
+          const VectorType         &b,
+          const PreconditionerType &preconditioner);
+  };
+
+
+
+  /**
+   * Preconditioned s-step conjugate gradient method (Chronopoulos and Gear,
+   * 1989), also known as communication avoiding CG.
+   *
+   * Every outer iteration builds a monomial basis of the Krylov spaces
+   * generated by the current search direction and by the current
+   * preconditioned residual, of dimension $2s+1$, and computes their Gram
+   * matrices with a single global reduction. The next @p s iterations of CG
+   * are then performed on the coefficients of the vectors with respect to
+   * this basis, without any communication, and the full vectors are
+   * recovered at the end. This trades $s-1$ additional applications of the
+   * matrix and of the preconditioner, and $O(s^2)$ local dot products, for
+   * a single reduction every @p s iterations.
+   *
+   * The monomial basis becomes ill conditioned as @p s grows: values between
+   * 2 and 6 are recommended.
+   */
+  template <typename VectorType = dealii::Vector<double>>
+  class SolverSStepCG : public dealii::SolverBase<VectorType>
+  {
+  public:
+    /**
+     * Additional data for the solver.
+     */
+    struct AdditionalData
+    {
+      /**
+       * Constructor.
+       */
+      explicit AdditionalData(const unsigned int s_step_size = 4)
+        : s_step_size(s_step_size)
+      {}
+
+      /**
+       * Number of CG iterations per global reduction.
+       */
+      unsigned int s_step_size;
+    };
+
+    /**
+     * Constructor.
+     */
+    SolverSStepCG(dealii::SolverControl            &cn,
+                  dealii::VectorMemory<VectorType> &mem,
+                  const AdditionalData             &data = AdditionalData());
+
+    /**
+     * Constructor. Use an object of type GrowingVectorMemory as a default to
+     * allocate memory.
+     */
+    SolverSStepCG(dealii::SolverControl &cn,
+                  const AdditionalData  &data = AdditionalData());
+
+    /**
+     * Solve the linear system $Ax=b$ for x.
+     */
+    template <typename MatrixType, typename PreconditionerType>
+    void
+    solve(const MatrixType         &A,
+          VectorType               &x,
+          const VectorType         &b,
+          const PreconditionerType &preconditioner);
+
+  private:
+    /**
+     * Solver parameters.
+     */
+    const AdditionalData additional_data;
+  };
+
+
+
+  /**
+   * Restarted GMRES with right preconditioning, and a single global reduction
+   * per iteration.
+   *
+   * The new Krylov vector is orthogonalized against the previous ones with
+   * classical Gram-Schmidt, computing all the projections and the norm of the
+   * new vector at once. The norm of the orthogonalized vector is then
+   * recovered from the Pythagorean theorem. When this formula suffers from
+   * cancellation, i.e., when the orthogonalization removes most of the new
+   * vector, a second Gram-Schmidt pass is performed (with a second
+   * reduction), to preserve the orthogonality of the basis.
+   */
+  template <typename VectorType = dealii::Vector<double>>
+  class SolverSingleReductionGMRES : public dealii::SolverBase<VectorType>
+  {
+  public:
+    /**
+     * Additional data for the solver.
+     */
+    struct AdditionalData
+    {
+      /**
+       * Constructor.
+       */
+      explicit AdditionalData(const unsigned int restart_length = 30)
+        : restart_length(restart_length)
+      {}
+
+      /**
+       * Maximum dimension of the Krylov space before a restart.
+       */
+      unsigned int restart_length;
+    };
+
+    /**
+     * Constructor.
+     */
+    SolverSingleReductionGMRES(
+      dealii::SolverControl            &cn,
+      dealii::VectorMemory<VectorType> &mem,
+      const AdditionalData             &data = AdditionalData());
+
+    /**
+     * Constructor. Use an object of type GrowingVectorMemory as a default to
+     * allocate memory.
+     */
+    SolverSingleReductionGMRES(
+      dealii::SolverControl &cn,
+      const AdditionalData  &data = AdditionalData());
+
+    /**
+     * Solve the linear system $Ax=b$ for x.
+     */
+    template <typename MatrixType, typename PreconditionerType>
+    void
+    solve(const MatrixType         &A,
+          VectorType               &x,
+          const VectorType         &b,
+          const PreconditionerType &preconditioner);
+
+  private:
+    /**
+     * Solver parameters.
+     */
+    const AdditionalData additional_data;
+  };
+
+
+
+#ifndef DOXYGEN
+  // Template implementation
+  template <typename VectorType>
+  SolverPipeCG<VectorType>::SolverPipeCG(
+    dealii::SolverControl            &cn,
+    dealii::VectorMemory<VectorType> &mem)
+    : dealii::SolverBase<VectorType>(cn, mem)
+  {}
+
+
+
+  template <typename VectorType>
+  SolverPipeCG<VectorType>::SolverPipeCG(dealii::SolverControl &cn)
+    : dealii::SolverBase<VectorType>(cn)
+  {}
+
+
+
+  template <typename VectorType>
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  SolverPipeCG<VectorType>::solve(const MatrixType         &A,
+                                  VectorType               &x,
+                                  const VectorType         &b,
+                                  const PreconditionerType &preconditioner)
+  {
+    using namespace dealii;
+    using Pointer = typename VectorMemory<VectorType>::Pointer;
+
+    Pointer r(this->memory), u(this->memory), w(this->memory);
+    Pointer m(this->memory), n(this->memory);
+    Pointer p(this->memory), s(this->memory), q(this->memory), z(this->memory);
+    for (auto *v : {r.get(),
+                    u.get(),
+                    w.get(),
+                    m.get(),
+                    n.get(),
+                    p.get(),
+                    s.get(),
+                    q.get(),
+                    z.get()})
+      v->reinit(x);
+
+    // r = b - Ax, u = Pr, w = Au
+    A.vmult(*r, x);
+    r->sadd(-1.0, 1.0, b);
+    preconditioner.vmult(*u, *r);
+    A.vmult(*w, *u);
+
+    double gamma_old = 0;
+    double alpha_old = 0;
+    double residual  = 0;
+
+    unsigned int         it   = 0;
+    SolverControl::State conv = SolverControl::iterate;
+    while (true)
+      {
+        // The only global reduction of the iteration
+        const auto d = internal::FusedReductions::dot_products<VectorType>(
+          {{r.get(), u.get()}, {w.get(), u.get()}, {r.get(), r.get()}});
+        const double gamma = d[0];
+        const double delta = d[1];
+        residual           = std::sqrt(std::abs(d[2]));
+
+        conv = this->iteration_status(it, residual, x);
+        if (conv != SolverControl::iterate)
+          break;
+
+        // m = Pw, n = Am
+        preconditioner.vmult(*m, *w);
+        A.vmult(*n, *m);
+
+        double alpha = 0;
+        double beta  = 0;
+        if (it > 0)
+          {
+            beta               = gamma / gamma_old;
+            const double denom = delta - beta * gamma / alpha_old;
+            AssertThrow(denom != 0.0,
+                        ExcMessage("Breakdown of the pipelined CG method."));
+            alpha = gamma / denom;
+          }
+        else
+          {
+            AssertThrow(delta != 0.0,
+                        ExcMessage("Breakdown of the pipelined CG method."));
+            alpha = gamma / delta;
+          }
+
+        z->sadd(beta, 1.0, *n);
+        q->sadd(beta, 1.0, *m);
+        s->sadd(beta, 1.0, *w);
+        p->sadd(beta, 1.0, *u);
+
+        x.add(alpha, *p);
+        r->add(-alpha, *s);
+        u->add(-alpha, *q);
+        w->add(-alpha, *z);
+
+        gamma_old = gamma;
+        alpha_old = alpha;
+        ++it;
+      }
+
+    AssertThrow(conv == SolverControl::success,
+                SolverControl::NoConvergence(it, residual));
+  }
+
+
+
+  template <typename VectorType>
+  SolverSStepCG<VectorType>::SolverSStepCG(
+    dealii::SolverControl            &cn,
+    dealii::VectorMemory<VectorType> &mem,
+    const AdditionalData             &data)
+    : dealii::SolverBase<VectorType>(cn, mem)
+    , additional_data(data)
+  {}
+
+
+
+  template <typename VectorType>
+  SolverSStepCG<VectorType>::SolverSStepCG(dealii::SolverControl &cn,
+                                           const AdditionalData  &data)
+    : dealii::SolverBase<VectorType>(cn)
+    , additional_data(data)
+  {}
+
+
+
+  template <typename VectorType>
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  SolverSStepCG<VectorType>::solve(const MatrixType         &A,
+                                   VectorType               &x,
+                                   const VectorType         &b,
+                                   const PreconditionerType &preconditioner)
+  {
+    using namespace dealii;
+    using Pointer = typename VectorMemory<VectorType>::Pointer;
+
+    const unsigned int s = additional_data.s_step_size;
+    AssertThrow(s > 0, ExcMessage("The s-step size must be positive."));
+
+    // Columns 0,...,s of the basis span the Krylov space of the search
+    // direction p, columns s+1,...,2s the one of the preconditioned residual
+    // z, both with respect to the operator T = PA. The columns of W are the
+    // columns of V multiplied by the inverse of the preconditioner, which are
+    // available without ever applying it.
+    const unsigned int   N = 2 * s + 1;
+    std::vector<Pointer> V;
+    std::vector<Pointer> W;
+    for (unsigned int i = 0; i < N; ++i)
+      {
+        V.emplace_back(this->memory);
+        V.back()->reinit(x);
+        W.emplace_back(this->memory);
+        W.back()->reinit(x);
+      }
+
+    // r = b - Ax, z = Pr, p = z, and p_hat = P^{-1} p = r
+    Pointer r(this->memory), z(this->memory);
+    Pointer p(this->memory), p_hat(this->memory);
+    for (auto *v : {r.get(), z.get(), p.get(), p_hat.get()})
+      v->reinit(x);
+    A.vmult(*r, x);
+    r->sadd(-1.0, 1.0, b);
+    preconditioner.vmult(*z, *r);
+    *p     = *z;
+    *p_hat = *r;
+
+    // Gram matrices G = W^T V (the P^{-1} inner product of the basis), and
+    // H = W^T W, used to compute the norm of the unpreconditioned residual.
+    FullMatrix<double>     G(N, N);
+    FullMatrix<double>     H(N, N);
+    dealii::Vector<double> x_coefficients(N);
+    dealii::Vector<double> z_coefficients(N);
+    dealii::Vector<double> p_coefficients(N);
+    dealii::Vector<double> Tp_coefficients(N);
+
+    std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+    pairs.reserve(N * (N + 1));
+
+    double               residual = 0;
+    unsigned int         it       = 0;
+    SolverControl::State conv     = SolverControl::iterate;
+    while (conv == SolverControl::iterate)
+      {
+        // Monomial basis of the two Krylov spaces
+        *V[0] = *p;
+        *W[0] = *p_hat;
+        for (unsigned int j = 1; j <= s; ++j)
+          {
+            A.vmult(*W[j], *V[j - 1]);
+            preconditioner.vmult(*V[j], *W[j]);
+          }
+        *V[s + 1] = *z;
+        *W[s + 1] = *r;
+        for (unsigned int j = s + 2; j < N; ++j)
+          {
+            A.vmult(*W[j], *V[j - 1]);
+            preconditioner.vmult(*V[j], *W[j]);
+          }
+
+        // The only global reduction of the outer iteration
+        pairs.clear();
+        for (unsigned int i = 0; i < N; ++i)
+          for (unsigned int j = i; j < N; ++j)
+            {
+              pairs.emplace_back(W[i].get(), V[j].get());
+              pairs.emplace_back(W[i].get(), W[j].get());
+            }
+        const auto   d = internal::FusedReductions::dot_products(pairs);
+        unsigned int k = 0;
+        for (unsigned int i = 0; i < N; ++i)
+          for (unsigned int j = i; j < N; ++j)
+            {
+              G(i, j) = G(j, i) = d[k++];
+              H(i, j) = H(j, i) = d[k++];
+            }
+
+        // s iterations of CG on the coefficients
+        x_coefficients        = 0;
+        z_coefficients        = 0;
+        p_coefficients        = 0;
+        z_coefficients[s + 1] = 1;
+        p_coefficients[0]     = 1;
+        for (unsigned int j = 0; j < s; ++j)
+          {
+            residual =
+              std::sqrt(std::abs(H.matrix_norm_square(z_coefficients)));
+            conv = this->iteration_status(it, residual, x);
+            if (conv != SolverControl::iterate)
+              break;
+
+            // Multiplication by T is a shift within each of the two blocks
+            Tp_coefficients = 0;
+            for (unsigned int i = 0; i < s; ++i)
+              Tp_coefficients[i + 1] = p_coefficients[i];
+            for (unsigned int i = s + 1; i + 1 < N; ++i)
+              Tp_coefficients[i + 1] = p_coefficients[i];
+
+            const double delta =
+              G.matrix_scalar_product(p_coefficients, Tp_coefficients);
+            const double gamma = G.matrix_norm_square(z_coefficients);
+            AssertThrow(delta != 0.0,
+                        ExcMessage("Breakdown of the s-step CG method."));
+            const double alpha = gamma / delta;
+
+            x_coefficients.add(alpha, p_coefficients);
+            z_coefficients.add(-alpha, Tp_coefficients);
+
+            const double beta = G.matrix_norm_square(z_coefficients) / gamma;
+            p_coefficients.sadd(beta, 1.0, z_coefficients);
+            ++it;
+          }
+
+        // Recover the full vectors from their coefficients
+        *r     = 0;
+        *z     = 0;
+        *p     = 0;
+        *p_hat = 0;
+        for (unsigned int i = 0; i < N; ++i)
+          {
+            x.add(x_coefficients[i], *V[i]);
+            z->add(z_coefficients[i], *V[i]);
+            r->add(z_coefficients[i], *W[i]);
+            p->add(p_coefficients[i], *V[i]);
+            p_hat->add(p_coefficients[i], *W[i]);
+          }
+      }
+
+    AssertThrow(conv == SolverControl::success,
+                SolverControl::NoConvergence(it, residual));
+  }
+
+
+
+  template <typename VectorType>
+  SolverSingleReductionGMRES<VectorType>::SolverSingleReductionGMRES(
+    dealii::SolverControl            &cn,
+    dealii::VectorMemory<VectorType> &mem,
+    const AdditionalData             &data)
+    : dealii::SolverBase<VectorType>(cn, mem)
+    , additional_data(data)
+  {}
+
+
+
+  template <typename VectorType>
+  SolverSingleReductionGMRES<VectorType>::SolverSingleReductionGMRES(
+    dealii::SolverControl &cn,
+    const AdditionalData  &data)
+    : dealii::SolverBase<VectorType>(cn)
+    , additional_data(data)
+  {}
+
+
+
+  template <typename VectorType>
+  template <typename MatrixType, typename PreconditionerType>
+  void
+  SolverSingleReductionGMRES<VectorType>::solve(
+    const MatrixType         &A,
+    VectorType               &x,
+    const VectorType         &b,
+    const PreconditionerType &preconditioner)
+  {
+    using namespace dealii;
+    using Pointer = typename VectorMemory<VectorType>::Pointer;
+
+    const unsigned int m = additional_data.restart_length;
+    AssertThrow(m > 0, ExcMessage("The restart length must be positive."));
+
+    std::vector<Pointer> V;
+    for (unsigned int i = 0; i <= m; ++i)
+      {
+        V.emplace_back(this->memory);
+        V.back()->reinit(x);
+      }
+    Pointer w(this->memory), tmp(this->memory);
+    w->reinit(x);
+    tmp->reinit(x);
+
+    // Hessenberg matrix, reduced to upper triangular form by Givens rotations
+    FullMatrix<double>     H(m + 1, m);
+    dealii::Vector<double> g(m + 1);
+    dealii::Vector<double> y(m);
+    std::vector<double>    cs(m);
+    std::vector<double>    sn(m);
+
+    std::vector<std::pair<const VectorType *, const VectorType *>> pairs;
+    pairs.reserve(m + 1);
+
+    // Orthogonalize w against the first k+1 basis vectors with a single
+    // reduction. Store the projections in the column k of H, and return the
+    // square of the norm of the orthogonalized vector.
+    const auto orthogonalize = [&](const unsigned int k) {
+      pairs.clear();
+      for (unsigned int i = 0; i <= k; ++i)
+        pairs.emplace_back(V[i].get(), w.get());
+      pairs.emplace_back(w.get(), w.get());
+      const auto d = internal::FusedReductions::dot_products(pairs);
+
+      double norm_square = d[k + 1];
+      for (unsigned int i = 0; i <= k; ++i)
+        {
+          H(i, k) += d[i];
+          w->add(-d[i], *V[i]);
+          norm_square -= d[i] * d[i];
+        }
+      return std::make_pair(norm_square, d[k + 1]);
+    };
+
+    double               residual = 0;
+    unsigned int         it       = 0;
+    SolverControl::State conv     = SolverControl::iterate;
+    while (conv == SolverControl::iterate)
+      {
+        // Initial residual of this cycle
+        A.vmult(*V[0], x);
+        V[0]->sadd(-1.0, 1.0, b);
+        residual = std::sqrt(
+          internal::FusedReductions::dot_products<VectorType>(
+            {{V[0].get(), V[0].get()}})[0]);
+        conv = this->iteration_status(it, residual, x);
+        if (conv != SolverControl::iterate)
+          break;
+
+        *V[0] /= residual;
+        H    = 0;
+        g    = 0;
+        g[0] = residual;
+
+        unsigned int dim = 0;
+        while (dim < m && conv == SolverControl::iterate)
+          {
+            const unsigned int k = dim;
+            preconditioner.vmult(*tmp, *V[k]);
+            A.vmult(*w, *tmp);
+
+            auto norms = orthogonalize(k);
+            // Cancellation in the Pythagorean formula: the orthogonalized
+            // vector is much shorter than the original one.
+            if (norms.first < 1e-4 * norms.second)
+              norms = orthogonalize(k);
+            const double h_next = std::sqrt(std::max(norms.first, 0.0));
+            H(k + 1, k)         = h_next;
+
+            // Apply the previous rotations to the new column, and compute
+            // the new one
+            for (unsigned int i = 0; i < k; ++i)
+              {
+                const double h0 = H(i, k);
+                const double h1 = H(i + 1, k);
+                H(i, k)         = cs[i] * h0 + sn[i] * h1;
+                H(i + 1, k)     = -sn[i] * h0 + cs[i] * h1;
+              }
+            const double rho = std::hypot(H(k, k), H(k + 1, k));
+            AssertThrow(rho != 0.0,
+                        ExcMessage("Breakdown of the GMRES method."));
+            cs[k]       = H(k, k) / rho;
+            sn[k]       = H(k + 1, k) / rho;
+            H(k, k)     = rho;
+            H(k + 1, k) = 0;
+            g[k + 1]    = -sn[k] * g[k];
+            g[k]        = cs[k] * g[k];
+
+            ++dim;
+            ++it;
+            residual = std::abs(g[k + 1]);
+            conv     = this->iteration_status(it, residual, x);
+
+            // The Krylov space is invariant: the solution is exact
+            if (h_next == 0.0)
+              break;
+            *V[k + 1] = *w;
+            *V[k + 1] /= h_next;
+          }
+
+        // Solve the triangular system, and update the solution
+        for (unsigned int i = dim; i-- > 0;)
+          {
+            double sum = g[i];
+            for (unsigned int j = i + 1; j < dim; ++j)
+              sum -= H(i, j) * y[j];
+            y[i] = sum / H(i, i);
+          }
+        *tmp = 0;
+        for (unsigned int i = 0; i < dim; ++i)
+          tmp->add(y[i], *V[i]);
+        preconditioner.vmult(*w, *tmp);
+        x += *w;
+      }
+
+    AssertThrow(conv == SolverControl::success,
+                SolverControl::NoConvergence(it, residual));
+  }
+#endif
+} // namespace ParsedLAC
+
+#endif
@@ -0,0 +1,53 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_rigid_body_modes_h
+#define parsed_lac_rigid_body_modes_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/dofs/dof_handler.h>
+
+#include <deal.II/fe/component_mask.h>
+#include <deal.II/fe/mapping.h>
+
+#include <vector>
+
+namespace ParsedLAC
+{
+  /**
+   * Compute the rigid body modes of a displacement field, to be used as near
+   * null space of algebraic multigrid preconditioners for linear elasticity.
+   *
+   * The @p component_mask must select exactly `spacedim` components of the
+   * finite element of @p dof_handler, which are interpreted as the
+   * components of the displacement. The first `spacedim` modes are the
+   * translations, and the following `spacedim*(spacedim-1)/2` are the
+   * infinitesimal rotations in the coordinate planes, evaluated at the
+   * support points of the degrees of freedom computed with @p mapping.
+   *
+   * The returned vector is indexed as `modes[mode][i]`, where `i` runs over
+   * the locally owned degrees of freedom, in the order of
+   * `dof_handler.locally_owned_dofs()`. Degrees of freedom of components
+   * that are not selected are zero in all modes.
+   */
+  template <int dim, int spacedim>
+  std::vector<std::vector<double>>
+  rigid_body_modes(const dealii::Mapping<dim, spacedim>    &mapping,
+                   const dealii::DoFHandler<dim, spacedim> &dof_handler,
+                   const dealii::ComponentMask             &component_mask);
+} // namespace ParsedLAC
+
+#endif
@@ -0,0 +1,430 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_lac_solver_telemetry_h
+#define parsed_lac_solver_telemetry_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/parameter_acceptor.h>
+#include <deal.II/base/timer.h>
+
+#include <deal.II/lac/solver_control.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ParsedLAC
+{
+  /**
+   * Telemetry of a single linear solve.
+   */
+  struct SolveRecord
+  {
+    /**
+     * Section name of the InverseOperator that performed the solve.
+     */
+    std::string label;
+
+    /**
+     * Name of the solver.
+     */
+    std::string solver_name;
+
+    /**
+     * Number of iterations.
+     */
+    unsigned int n_iterations = 0;
+
+    /**
+     * True if the solver converged.
+     */
+    bool converged = false;
+
+    /**
+     * Residual at every iteration, starting from the initial one.
+     */
+    std::vector<double> residual_history;
+
+    /**
+     * Wall time of the solve, in seconds.
+     */
+    double solve_time = 0;
+
+    /**
+     * Wall time spent building preconditioners since the previous solve.
+     */
+    double preconditioner_setup_time = 0;
+
+    /**
+     * Wall time spent applying the preconditioner during the solve.
+     */
+    double preconditioner_apply_time = 0;
+
+    /**
+     * Number of applications of the preconditioner.
+     */
+    unsigned int n_preconditioner_applications = 0;
+
+    /**
+     * Number of matrix-vector products.
+     */
+    unsigned int n_matvecs = 0;
+
+    /**
+     * Number of global reductions.
+     */
+    unsigned int n_reductions = 0;
+
+    /**
+     * True if n_reductions is a model estimate, rather than a measure.
+     */
+    bool reductions_estimated = false;
+
+    /**
+     * Estimate of the number of bytes read and written by the matrix-vector
+     * products and by the applications of the preconditioner, on this
+     * process.
+     */
+    double bytes_moved = 0;
+  };
+
+
+
+  /**
+   * A lightweight in-memory registry of solver telemetry, and a parsed
+   * writer for its content.
+   *
+   * When the registry is enabled, every solve performed by an
+   * InverseOperator adds a SolveRecord to the registry, and the
+   * preconditioners of this library add the time spent in their
+   * initialization to the record of the next solve. When disabled (the
+   * default), no data is collected, and the solvers run without any
+   * instrumentation.
+   *
+   * The number of global reductions is measured exactly for the solvers of
+   * this library that use fused reductions (`pipecg`, `sstepcg`, `srgmres`,
+   * and `dcg`), and estimated from the number of iterations for the solvers
+   * of deal.II. The bytes moved only account for the vectors, unless the
+   * solver is given an actual matrix.
+   *
+   * The registry is enabled as soon as one object of this class has a
+   * non-empty `Output base name`. Every call to write() dumps the records
+   * collected since the previous call, tagged with a stage number (e.g., a
+   * refinement cycle or a time step), and empties the registry. Only the
+   * root process writes to disk. In `csv` format, one line per solve is
+   * appended to `<Output base name>.csv` (without the residual history); in
+   * `json` format, the file `<Output base name>-<stage>.json` is written.
+   *
+   * The parameter file is expected to have the following structure:
+   * @code{.sh}
+   * set Output base name = solver_telemetry
+   * set Output format    = json
+   * @endcode
+   */
+  class SolverTelemetry : public dealii::ParameterAcceptor
+  {
+  public:
+    /**
+     * Constructor.
+     */
+    SolverTelemetry(const std::string &section_name = "",
+                    const std::string &base_name    = "",
+                    const std::string &format       = "json");
+
+    /**
+     * Write the records collected so far, tagged with the given @p stage, and
+     * clear the registry.
+     */
+    void
+    write(const unsigned int stage,
+          const MPI_Comm    &comm = MPI_COMM_WORLD) const;
+
+    /**
+     * If @p append is true, the csv file is not truncated by the first call
+     * to write(), and new records are appended to the existing ones. This is
+     * used when restarting a simulation from a checkpoint. The header line is
+     * only written if the file is empty.
+     */
+    void
+    set_append(const bool append);
+
+    /**
+     * Write the records in csv format, with a header line if @p header is
+     * true.
+     */
+    static void
+    write_csv(std::ostream                   &out,
+              const unsigned int              stage,
+              const std::vector<SolveRecord> &records,
+              const bool                      header);
+
+    /**
+     * Write the records in json format.
+     */
+    static void
+    write_json(std::ostream                   &out,
+               const unsigned int              stage,
+               const std::vector<SolveRecord> &records);
+
+    /**
+     * Return true if telemetry is collected.
+     */
+    static bool
+    enabled();
+
+    /**
+     * Enable or disable the collection of telemetry.
+     */
+    static void
+    set_enabled(const bool enable);
+
+    /**
+     * Add a record to the registry.
+     */
+    static void
+    add_record(const SolveRecord &record);
+
+    /**
+     * The records collected since the last call to write() or clear().
+     */
+    static const std::vector<SolveRecord> &
+    get_records();
+
+    /**
+     * Clear the registry.
+     */
+    static void
+    clear();
+
+    /**
+     * Count one global reduction.
+     */
+    static void
+    count_reduction();
+
+    /**
+     * Number of global reductions counted so far. When a Probe finishes, the
+     * counter is reset to its value at the construction of the Probe, so
+     * that the reductions of nested solves are only counted by the innermost
+     * one.
+     */
+    static unsigned int
+    n_reductions();
+
+    /**
+     * Add the time spent building a preconditioner, that will be reported
+     * with the next solve.
+     */
+    static void
+    add_preconditioner_setup_time(const double seconds);
+
+    /**
+     * Counters updated during a solve by the wrappers of the matrix and of
+     * the preconditioner.
+     */
+    struct Counters
+    {
+      unsigned int n_matvecs                     = 0;
+      unsigned int n_preconditioner_applications = 0;
+      double       preconditioner_apply_time     = 0;
+    };
+
+    /**
+     * Measure the time spent building a preconditioner, from construction to
+     * destruction of this object.
+     */
+    class SetupTimer
+    {
+    public:
+      /**
+       * Start the timer.
+       */
+      SetupTimer();
+
+      /**
+       * Add the elapsed time to the registry, if enabled.
+       */
+      ~SetupTimer();
+
+    private:
+      dealii::Timer timer;
+    };
+
+    /**
+     * Collect the telemetry of a single solve, from construction to the call
+     * to finish().
+     */
+    class Probe
+    {
+    public:
+      /**
+       * Start collecting data for a solve that uses @p control.
+       * @p restart_length is the restart length of the GMRES solvers, used
+       * to estimate their number of global reductions.
+       */
+      Probe(const std::string     &label,
+            const std::string     &solver_name,
+            dealii::SolverControl &control,
+            const unsigned int     restart_length = 30);
+
+      /**
+       * Build the record of the solve, and add it to the registry.
+       *
+       * @param n_local_dofs Number of locally owned entries of the vectors.
+       * @param matrix_memory Memory used by the matrix, if known.
+       */
+      void
+      finish(const unsigned int n_local_dofs,
+             const std::size_t  matrix_memory = 0);
+
+      /**
+       * The counters of this solve.
+       */
+      const std::shared_ptr<Counters> counters;
+
+    private:
+      const std::string            label;
+      const std::string            solver_name;
+      const dealii::SolverControl &control;
+      const unsigned int           restart_length;
+      const unsigned int           reductions_at_start;
+      dealii::Timer                timer;
+    };
+
+  private:
+    /**
+     * Prefix of the output files. If empty, nothing is written.
+     */
+    std::string base_name;
+
+    /**
+     * One of csv or json.
+     */
+    std::string format;
+
+    /**
+     * True once the header of the csv file has been written.
+     */
+    mutable bool csv_header_written = false;
+
+    /**
+     * Append to an existing csv file instead of truncating it.
+     */
+    bool append = false;
+  };
+
+
+
+  namespace internal
+  {
+    namespace SolverTelemetryImplementation
+    {
+      /**
+       * Count the matrix-vector products of a matrix.
+       */
+      template <typename MatrixType>
+      struct CountingMatrix
+      {
+        template <typename VectorType>
+        void
+        vmult(VectorType &dst, const VectorType &src) const
+        {
+          ++counters->n_matvecs;
+          matrix.vmult(dst, src);
+        }
+
+        template <typename VectorType>
+        void
+        Tvmult(VectorType &dst, const VectorType &src) const
+        {
+          ++counters->n_matvecs;
+          matrix.Tvmult(dst, src);
+        }
+
+        const MatrixType                                 &matrix;
+        const std::shared_ptr<SolverTelemetry::Counters> counters;
+      };
+
+      /**
+       * Count the applications of a preconditioner, and measure their time.
+       */
+      template <typename PreconditionerType>
+      struct TimedPreconditioner
+      {
+        template <typename VectorType>
+        void
+        vmult(VectorType &dst, const VectorType &src) const
+        {
+          dealii::Timer timer;
+          preconditioner.vmult(dst, src);
+          counters->preconditioner_apply_time += timer.wall_time();
+          ++counters->n_preconditioner_applications;
+        }
+
+        template <typename VectorType>
+        void
+        Tvmult(VectorType &dst, const VectorType &src) const
+        {
+          dealii::Timer timer;
+          preconditioner.Tvmult(dst, src);
+          counters->preconditioner_apply_time += timer.wall_time();
+          ++counters->n_preconditioner_applications;
+        }
+
+        const PreconditionerType                         &preconditioner;
+        const std::shared_ptr<SolverTelemetry::Counters> counters;
+      };
+
+      /**
+       * Detect if a matrix type has a memory_consumption() method.
+       */
+      template <typename MatrixType, typename = void>
+      struct has_memory_consumption : std::false_type
+      {};
+
+      template <typename MatrixType>
+      struct has_memory_consumption<
+        MatrixType,
+        std::void_t<
+          decltype(std::declval<const MatrixType &>().memory_consumption())>>
+        : std::true_type
+      {};
+
+      /**
+       * Memory used by a matrix, or zero if unknown.
+       */
+      template <typename MatrixType>
+      std::size_t
+      matrix_memory(const MatrixType &matrix)
+      {
+        if constexpr (has_memory_consumption<MatrixType>::value)
+          return matrix.memory_consumption();
+        else
+          {
+            (void)matrix;
+            return 0;
+          }
+      }
+    } // namespace SolverTelemetryImplementation
+  }   // namespace internal
+} // namespace ParsedLAC
+
+#endif
@@ -43,6 +43,51 @@ namespace ParsedTools
   class Constants : public dealii::ParameterAcceptor
   {
   public:
+    /**
+     * A resolved reference to one of the constants.
+     *
+     * Reading a Handle does not look up the name of the constant, and is as
+     * cheap as reading a double. A Handle always returns the current value of
+     * the constant, also after the parameters have been parsed again, and is
+     * valid as long as the Constants object it was obtained from.
+     *
+     * Handles are meant to be resolved once, outside of assembly loops:
+     * @code
+     * const auto eta = constants.get_handle("eta");
+     * ...
+     * for (const unsigned int q : fe_values.quadrature_point_indices())
+     *   for (const unsigned int i : fe_values.dof_indices())
+     *     for (const unsigned int j : fe_values.dof_indices())
+     *       cell_matrix(i, j) += eta * ...;
+     * @endcode
+     */
+    class Handle
+    {
+    public:
+      /**
+       * Return the value of the constant.
+       */
+      operator const double &() const
+      {
+        return *value;
+      }
+
+    private:
+      /**
+       * Constructor. Only Constants can create a Handle.
+       */
+      explicit Handle(const double &value)
+        : value(&value)
+      {}
+
+      /**
+       * The value of the constant, stored in the map of a Constants object.
+       */
+      const double *value;
+
+      friend class Constants;
+    };
+
     /**
      * Build a ParameterAcceptor based collection of constants.
      *
@@ -125,6 +170,17 @@ namespace ParsedTools
     const double &
     operator[](const std::string &key) const;
 
+    /**
+     * Return a Handle to the constant associated with the given name. Use
+     * this instead of operator[]() when the constant is read many times, e.g.,
+     * inside the loops over quadrature points and degrees of freedom of an
+     * assembly routine.
+     *
+     * @param key The name of the constant.
+     */
+    Handle
+    get_handle(const std::string &key) const;
+
   private:
     /**
      * The actual constants.
@@ -30,13 +30,125 @@
 
 #include <deal.II/numerics/data_out.h>
 
+#include <boost/signals2/connection.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <tuple>
 
 #include "parsed_tools/enum.h"
 
 namespace ParsedTools
 {
+  namespace internal
+  {
+    /**
+     * A self contained copy of the patches built by a dealii::DataOut
+     * object. It can be written to disk after the original DataOut object,
+     * its DoFHandler, and its data vectors have been modified or destroyed.
+     */
+    template <int dim, int spacedim>
+    class Patches : public dealii::DataOutInterface<dim, spacedim>
+    {
+    public:
+      /**
+       * The patches.
+       */
+      std::vector<dealii::DataOutBase::Patch<dim, spacedim>> patches;
+
+      /**
+       * Names of the data sets.
+       */
+      std::vector<std::string> dataset_names;
+
+      /**
+       * Ranges of vector valued data sets.
+       */
+      std::vector<
+        std::tuple<unsigned int,
+                   unsigned int,
+                   std::string,
+                   dealii::DataComponentInterpretation::DataComponentInterpretation>>
+        nonscalar_data_ranges;
+
+    protected:
+      virtual const std::vector<dealii::DataOutBase::Patch<dim, spacedim>> &
+      get_patches() const override
+      {
+        return patches;
+      }
+
+      virtual std::vector<std::string>
+      get_dataset_names() const override
+      {
+        return dataset_names;
+      }
+
+      virtual std::vector<
+        std::tuple<unsigned int,
+                   unsigned int,
+                   std::string,
+                   dealii::DataComponentInterpretation::DataComponentInterpretation>>
+      get_nonscalar_data_ranges() const override
+      {
+        return nonscalar_data_ranges;
+      }
+    };
+
+    /**
+     * A dealii::DataOut object that can hand over the patches it has built to
+     * a Patches object.
+     */
+    template <int dim, int spacedim>
+    class DataOut : public dealii::DataOut<dim, spacedim>
+    {
+    public:
+      /**
+       * Move the patches built by the last call to build_patches() into a new
+       * Patches object, together with the names of the data sets, the given
+       * output format, and the given output flags.
+       */
+      std::unique_ptr<Patches<dim, spacedim>>
+      extract_patches(const dealii::DataOutBase::OutputFormat format,
+                      const dealii::DataOutBase::VtkFlags    &flags)
+      {
+        auto result = std::make_unique<Patches<dim, spacedim>>();
+        result->patches.swap(this->patches);
+        result->dataset_names         = this->get_dataset_names();
+        result->nonscalar_data_ranges = this->get_nonscalar_data_ranges();
+        result->set_default_format(format);
+        result->set_flags(flags);
+        return result;
+      }
+    };
+  } // namespace internal
+
+  /**
+   * Wrapper around the dealii::DataOut class, driven by a parameter file.
+   *
+   * In addition to the formats supported by deal.II, the `Output format` can
+   * be `parallel vtu`. In this case, and with the `hdf5` format, all
+   * processes write collectively a single file per output step, instead of
+   * one file per process. The `hdf5` format also writes an xdmf file that
+   * describes the whole time series. If `Write mesh once` is true, the
+   * `hdf5` format writes the mesh to a separate file only when the
+   * DoFHandler, its Triangulation, or the Mapping change, and every output
+   * step only contains the data arrays.
+   *
+   * Patches are always built by the calling thread. If `Asynchronous output`
+   * is set to true, formatting the patches and writing the files to disk is
+   * done by a background thread, which processes at most `Output queue
+   * size` outputs at the same time. Calling write_data_and_clear() when the
+   * queue is full blocks until the oldest output has been written. If the
+   * background thread fails to write an output, the exception is rethrown
+   * by the next call to write_data_and_clear() or flush().
+   */
   template <int dim, int spacedim = dim>
   class DataOut : public dealii::ParameterAcceptor
   {
@@ -58,6 +170,13 @@ namespace ParsedTools
             const bool         &write_higher_order_cells = true,
             const MPI_Comm     &comm                     = MPI_COMM_WORLD);
 
+    /**
+     * Destructor. Wait for all pending outputs to be written. Since a
+     * destructor cannot throw, an exception thrown by the background thread
+     * that was not rethrown by flush() is printed to std::cerr.
+     */
+    ~DataOut();
+
     /**
      * Prepare to output data on the given file. This will initialize
      * the data_out object and a file with a filename that is the
@@ -111,7 +230,75 @@ namespace ParsedTools
     void
     clear_pvd_record();
 
+    /**
+     * Continue the pvd record of a previous run, e.g., after a restart from a
+     * checkpoint. The first @p n_records data sets of the existing pvd file
+     * are kept, and the next outputs are appended after them. Data sets that
+     * the previous run wrote after its last checkpoint are discarded. In the
+     * hdf5 format, the first @p n_records time steps of the existing xdmf
+     * file are kept in the same way.
+     */
+    void
+    resume_pvd_record(const unsigned int n_records);
+
+    /**
+     * Wait until all pending outputs have been written to disk. Any exception
+     * thrown while writing in the background is rethrown here.
+     */
+    void
+    flush();
+
   private:
+    /**
+     * Execute the given task. If asynchronous output is enabled, the task is
+     * queued and executed by the background thread, otherwise it is executed
+     * immediately. Rethrow the exception thrown by a previous task, if any.
+     */
+    void
+    schedule(std::function<void()> &&task);
+
+    /**
+     * Rethrow, and forget, the first exception thrown by the background
+     * thread. Must be called with `queue_mutex` locked.
+     */
+    void
+    rethrow_writer_exception();
+
+    /**
+     * Main loop of the background thread.
+     */
+    void
+    process_queue();
+
+    /**
+     * True if all processes write to the same file, i.e., if the output
+     * format is `parallel vtu` or `hdf5`.
+     */
+    bool
+    collective_output() const;
+
+    /**
+     * The deal.II output format corresponding to the `Output format`
+     * parameter. The `parallel vtu` format is written as `vtu`.
+     */
+    dealii::DataOutBase::OutputFormat
+    get_output_format() const;
+
+    /**
+     * Write the patches built by the data_out object to a single file per
+     * output step, using collective MPI-IO.
+     */
+    void
+    write_collectively(const dealii::Mapping<dim, spacedim> &mapping);
+
+    /**
+     * If resume_pvd_record() was called, rebuild the pvd record from the
+     * existing pvd file, and read the time steps of the existing xdmf file.
+     * This must be called before the next output.
+     */
+    void
+    restore_pvd_record();
+
     /** Initialization flag.*/
     const std::string component_names;
 
@@ -157,11 +344,23 @@ namespace ParsedTools
     /** Output the material ids of the domain. */
     bool output_material_ids;
 
-    /** Output file. */
-    std::ofstream output_file;
+    /** Write the output files in a background thread. */
+    bool asynchronous_output = false;
+
+    /** Maximum number of outputs waiting to be written. */
+    unsigned int output_queue_size = 2;
+
+    /** Name of the file this process will write. */
+    std::string output_file_name;
+
+    /** The last directory we created. */
+    std::string created_directory;
 
     /** Outputs only the data that refers to this process. */
-    std::unique_ptr<dealii::DataOut<dim, spacedim>> data_out;
+    std::unique_ptr<internal::DataOut<dim, spacedim>> data_out;
+
+    /** Flags used to write vtk and vtu files. */
+    dealii::DataOutBase::VtkFlags vtk_flags;
 
     typename dealii::DataOut<dim, spacedim>::CurvedCellRegion
       curved_cells_region = dealii::DataOut<dim, spacedim>::curved_inner_cells;
@@ -170,6 +369,67 @@ namespace ParsedTools
      * Record of all output files and times.
      */
     std::vector<std::pair<double, std::string>> pvd_record;
+
+    /**
+     * Position of the closing tags in the pvd file. New records overwrite the
+     * closing tags, which are then written again after them. Only accessed
+     * by the tasks that write data to disk.
+     */
+    std::streampos pvd_position = 0;
+
+    /** Number of records to restore from an existing pvd file. */
+    unsigned int n_resumed_records = 0;
+
+    /** In hdf5 format, write the mesh only when it changes. */
+    bool write_mesh_once = true;
+
+    /** True if the mesh changed since the last hdf5 output. */
+    bool mesh_changed = true;
+
+    /** The DoFHandler used in the last output. */
+    const dealii::DoFHandler<dim, spacedim> *last_dof_handler = nullptr;
+
+    /** Number of degrees of freedom of the last output. */
+    dealii::types::global_dof_index last_n_dofs = 0;
+
+    /** The Mapping used in the last output. */
+    const dealii::Mapping<dim, spacedim> *last_mapping = nullptr;
+
+    /** Connection to the signals of the last Triangulation. */
+    boost::signals2::scoped_connection triangulation_connection;
+
+    /** The hdf5 file that contains the current mesh. */
+    std::string mesh_file_name;
+
+    /** Record of all hdf5 files written, used to create the xdmf file. */
+    std::vector<dealii::XDMFEntry> xdmf_entries;
+
+    /**
+     * Time steps of the xdmf file of a previous run, kept by
+     * resume_pvd_record(). They are written before xdmf_entries.
+     */
+    std::vector<std::string> resumed_xdmf_grids;
+
+    /** Background thread that writes to disk. */
+    std::thread writer;
+
+    /** Protects the queue. */
+    std::mutex queue_mutex;
+
+    /** Signals changes in the queue. */
+    std::condition_variable queue_condition;
+
+    /** Tasks waiting to be executed by the background thread. */
+    std::deque<std::function<void()>> queue;
+
+    /** Number of tasks currently being executed by the background thread. */
+    unsigned int n_running_tasks = 0;
+
+    /** Tells the background thread to stop. */
+    bool stop_writer = false;
+
+    /** First exception thrown by the background thread. */
+    std::exception_ptr writer_exception;
   };
 
 
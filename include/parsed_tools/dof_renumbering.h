@@ -0,0 +1,144 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_tools_dof_renumbering_h
+#define parsed_tools_dof_renumbering_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/parameter_acceptor.h>
+#include <deal.II/base/tensor.h>
+
+#include <deal.II/dofs/dof_handler.h>
+
+#include <string>
+#include <vector>
+
+namespace ParsedTools
+{
+  /**
+   * A parsed renumbering of the degrees of freedom.
+   *
+   * The degrees of freedom are always renumbered component wise, so that
+   * each block of the system is a contiguous range of indices. Within each
+   * block, they can be reordered to reduce the bandwidth of the system
+   * matrix, and improve the locality of matrix-vector products and
+   * smoothers. The available orderings are
+   * - `none`: keep the order of the cell traversal;
+   * - `cuthill_mckee`: Cuthill-McKee ordering of the graph of the nodes,
+   *   i.e., of the sets of degrees of freedom of the copies of a base element
+   *   with the same index within the base element (e.g., the components of
+   *   the displacement at a vertex). The degrees of freedom of each node are
+   *   numbered consecutively;
+   * - `hilbert`: sort the cells along a Hilbert space filling curve through
+   *   their centers;
+   * - `morton`: sort the cells along a Morton (Z-order) space filling curve
+   *   through their centers;
+   * - `downstream`: sort the cells along the `Downstream direction`.
+   *
+   * All orderings only permute the locally owned degrees of freedom of each
+   * process, i.e., the ownership of the degrees of freedom does not change.
+   *
+   * If `Log statistics` is true, the largest bandwidth of the diagonal
+   * blocks, and the time of a matrix-vector product with a local matrix
+   * that has the same sparsity of the system matrix, are written to deallog
+   * before and after the renumbering.
+   *
+   * The parameter file is expected to have the following structure:
+   * @code{.sh}
+   * set Downstream direction = 1, 0
+   * set Log statistics       = false
+   * set Type                 = none
+   * @endcode
+   */
+  template <int dim, int spacedim = dim>
+  class DoFRenumbering : public dealii::ParameterAcceptor
+  {
+  public:
+    /**
+     * Constructor.
+     */
+    DoFRenumbering(const std::string &section_name   = "",
+                   const std::string &type           = "none",
+                   const bool         log_statistics = false);
+
+    /**
+     * Renumber the degrees of freedom component wise, grouping the
+     * components according to @p blocks, and then reorder them within each
+     * block according to the selected type.
+     */
+    void
+    renumber(dealii::DoFHandler<dim, spacedim> &dof_handler,
+             const std::vector<unsigned int>   &blocks) const;
+
+    /**
+     * Largest bandwidth of the diagonal blocks of a matrix that couples all
+     * the degrees of freedom of each cell, among all processes.
+     */
+    static dealii::types::global_dof_index
+    bandwidth(const dealii::DoFHandler<dim, spacedim> &dof_handler,
+              const std::vector<unsigned int>         &blocks);
+
+    /**
+     * Return true if the degrees of freedom of each node are numbered
+     * consecutively, in the order of the components, starting from a
+     * multiple of @p block_size, on all processes. A node is a set of degrees
+     * of freedom of the copies of the same base element, with the same index
+     * within the base element, e.g., the @p block_size components of the
+     * displacement at a vertex for `FESystem[FE_Q(1)^block_size]`. All base
+     * elements must have multiplicity @p block_size.
+     *
+     * This is the layout required to store the system matrix with one dense
+     * block of size @p block_size per pair of nodes (see
+     * ParsedLAC::BSRStorage), or to treat it as a system in BoomerAMG (see
+     * ParsedLAC::PETScAMGPreconditioner).
+     */
+    static bool
+    is_node_interleaved(const dealii::DoFHandler<dim, spacedim> &dof_handler,
+                        const unsigned int                       block_size);
+
+    /**
+     * Time, in seconds, of a matrix-vector product with a local matrix that
+     * couples all the degrees of freedom of the locally owned cells, numbered
+     * as the locally relevant degrees of freedom.
+     */
+    static double
+    local_matvec_time(const dealii::DoFHandler<dim, spacedim> &dof_handler);
+
+  private:
+    /**
+     * Apply the selected ordering, without taking care of the blocks.
+     */
+    void
+    reorder(dealii::DoFHandler<dim, spacedim> &dof_handler) const;
+
+    /**
+     * One of none, cuthill_mckee, hilbert, morton, or downstream.
+     */
+    std::string type;
+
+    /**
+     * Direction used by the downstream ordering.
+     */
+    dealii::Tensor<1, spacedim> direction;
+
+    /**
+     * Write bandwidth and matrix-vector product time to deallog.
+     */
+    bool log_statistics;
+  };
+} // namespace ParsedTools
+
+#endif
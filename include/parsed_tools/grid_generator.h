@@ -203,9 +203,14 @@ namespace ParsedTools
      * program twice with input and output grid with the same name, would
      * produce more and more refined grids. If you really want to output the
      * same grid in the refined case, simply call the write() function again.
+     *
+     * If @p apply_initial_refinement is false, the `Initial grid refinement`
+     * is not applied, and only the coarse grid is generated. This is used,
+     * for example, when the refined grid is loaded from a checkpoint.
      */
     void
-    generate(dealii::Triangulation<dim, spacedim> &tria) const;
+    generate(dealii::Triangulation<dim, spacedim> &tria,
+             const bool apply_initial_refinement = true) const;
 
     /**
      * Write the given Triangulation to the output file specified in `Output
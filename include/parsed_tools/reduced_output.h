@@ -0,0 +1,478 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef parsed_tools_reduced_output_h
+#define parsed_tools_reduced_output_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/parameter_acceptor.h>
+#include <deal.II/base/point.h>
+#include <deal.II/base/quadrature.h>
+
+#include <deal.II/dofs/dof_handler.h>
+
+#include <deal.II/fe/fe_values.h>
+#include <deal.II/fe/mapping.h>
+
+#include <deal.II/grid/grid_tools.h>
+#include <deal.II/grid/grid_tools_cache.h>
+#include <deal.II/grid/tria.h>
+
+#include <deal.II/lac/vector.h>
+
+#include <boost/signals2/connection.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "parsed_tools/components.h"
+#include "parsed_tools/function.h"
+
+namespace ParsedTools
+{
+  /**
+   * Reduced, in-situ, output of a finite element solution.
+   *
+   * Instead of writing the full fields to disk, this class evaluates a small
+   * set of derived quantities every time the write() method is called, and
+   * appends them as a new row of a few csv files:
+   * - the values of all components at a list of probe points, in the file
+   *   `<base name>_probes.csv`;
+   * - the values of all components at equally spaced points along a list of
+   *   segments, one file `<base name>_line_<i>.csv` per segment;
+   * - the volume integral and the boundary integrals of each component,
+   *   weighted by a user defined function, in the file
+   *   `<base name>_integrals.csv`.
+   *
+   * The location of the evaluation points is computed only once, and it is
+   * recomputed only when the DoFHandler, the Mapping, or the Triangulation
+   * change. Only the root process writes to disk. The data written on disk
+   * is a few numbers per time step, so this class can be called at every
+   * step of a time dependent simulation, while the full output is produced
+   * much less frequently.
+   *
+   * An example parameter file for a two dimensional problem is
+   * @code{.sh}
+   * subsection Reduced output
+   *   set Base name        = reduced_output
+   *   set Boundary ids     = 0, 1
+   *   set Integral weights = 1
+   *   set Line samples     = 0,0.5 : 1,0.5 : 11
+   *   set Probe points     = 0.5,0.5; 0.25,0.25
+   *   set Volume integrals = true
+   * end
+   * @endcode
+   *
+   * When no probe points, line samples, or integrals are requested, the
+   * write() method does nothing.
+   */
+  template <int dim, int spacedim = dim>
+  class ReducedOutput : public dealii::ParameterAcceptor
+  {
+  public:
+    /**
+     * Constructor.
+     *
+     * @param section_name Name of the section in the parameter file
+     * @param component_names Comma separated names of the components of the
+     * solution, as in ParsedTools::FiniteElement
+     * @param base_name Prefix of the output files
+     * @param comm MPI communicator of the Triangulation
+     */
+    ReducedOutput(const std::string &section_name    = "",
+                  const std::string &component_names = "u",
+                  const std::string &base_name       = "reduced_output",
+                  const MPI_Comm    &comm            = MPI_COMM_WORLD);
+
+    /**
+     * Return true if at least one reduced quantity was requested in the
+     * parameter file.
+     */
+    bool
+    enabled() const;
+
+    /**
+     * If @p append is true, the output files are not truncated when they are
+     * opened, and new rows are appended to the existing ones. This is used
+     * when restarting a simulation from a checkpoint. The header line is only
+     * written to files that are empty.
+     */
+    void
+    set_append(const bool append);
+
+    /**
+     * Compute all reduced quantities of the given solution, and append them
+     * to the output files, associated with the given time.
+     *
+     * The solution vector must contain the locally relevant degrees of
+     * freedom, i.e., it must have ghost entries in parallel.
+     */
+    template <typename VectorType>
+    void
+    write(const double                             time,
+          const dealii::Mapping<dim, spacedim>    &mapping,
+          const dealii::DoFHandler<dim, spacedim> &dof_handler,
+          const VectorType                        &solution);
+
+    /**
+     * Evaluate all components of the solution at the probe points, followed
+     * by the points of each line sample. The values of each point are
+     * stored contiguously. The same vector is returned on all processes.
+     */
+    template <typename VectorType>
+    std::vector<double>
+    point_values(const dealii::Mapping<dim, spacedim>    &mapping,
+                 const dealii::DoFHandler<dim, spacedim> &dof_handler,
+                 const VectorType                        &solution);
+
+    /**
+     * Compute the weighted volume integral of each component (if requested),
+     * followed by the weighted integral of each component on each of the
+     * selected boundary ids. The same vector is returned on all processes.
+     */
+    template <typename VectorType>
+    std::vector<double>
+    integrals(const dealii::Mapping<dim, spacedim>    &mapping,
+              const dealii::DoFHandler<dim, spacedim> &dof_handler,
+              const VectorType                        &solution);
+
+  private:
+    /**
+     * Locate the probe points and the line samples in the triangulation, and
+     * build one FEValues object for each point owned by this process.
+     */
+    void
+    update_cache(const dealii::Mapping<dim, spacedim>    &mapping,
+                 const dealii::DoFHandler<dim, spacedim> &dof_handler);
+
+    /**
+     * Open the output files, and write their header line. Only called on the
+     * root process.
+     */
+    void
+    open_files();
+
+    /**
+     * Names of the solution components.
+     */
+    const std::vector<std::string> component_names;
+
+    /**
+     * Number of components of the solution.
+     */
+    const unsigned int n_components;
+
+    /**
+     * MPI communicator.
+     */
+    const MPI_Comm comm;
+
+    /**
+     * Prefix of the output files.
+     */
+    std::string base_name;
+
+    /**
+     * Points where the solution is evaluated.
+     */
+    std::vector<dealii::Point<spacedim>> probe_points;
+
+    /**
+     * Segments where the solution is sampled: start point, end point, and
+     * number of equally spaced samples.
+     */
+    std::vector<std::tuple<dealii::Point<spacedim>,
+                           dealii::Point<spacedim>,
+                           unsigned int>>
+      line_samples;
+
+    /**
+     * Boundary ids where the solution is integrated.
+     */
+    std::vector<dealii::types::boundary_id> boundary_ids;
+
+    /**
+     * Integrate the solution on the whole domain.
+     */
+    bool volume_integrals = false;
+
+    /**
+     * Weights of each component in the integrals.
+     */
+    ParsedTools::Function<spacedim> integral_weights;
+
+    /**
+     * Information about a sample point owned by this process.
+     */
+    struct CachedPoint
+    {
+      /**
+       * Index of the point in the list of all sample points.
+       */
+      unsigned int index;
+
+      /**
+       * The cell containing the point.
+       */
+      typename dealii::DoFHandler<dim, spacedim>::active_cell_iterator cell;
+
+      /**
+       * FEValues object with a single quadrature point, located at the
+       * reference coordinates of the sample point.
+       */
+      std::unique_ptr<dealii::FEValues<dim, spacedim>> fe_values;
+    };
+
+    /**
+     * Probe points, followed by the points of all line samples.
+     */
+    std::vector<dealii::Point<spacedim>> sample_points;
+
+    /**
+     * Sample points owned by this process.
+     */
+    std::vector<CachedPoint> cached_points;
+
+    /**
+     * Number of processes owning each sample point. Points on the boundary
+     * between processors are averaged.
+     */
+    std::vector<double> n_owners;
+
+    /**
+     * True if cached_points is up to date.
+     */
+    bool cache_is_valid = false;
+
+    /**
+     * DoFHandler used to build the cache.
+     */
+    const dealii::DoFHandler<dim, spacedim> *cached_dof_handler = nullptr;
+
+    /**
+     * Number of degrees of freedom when the cache was built.
+     */
+    dealii::types::global_dof_index cached_n_dofs = 0;
+
+    /**
+     * Mapping used to build the cache.
+     */
+    const dealii::Mapping<dim, spacedim> *cached_mapping = nullptr;
+
+    /**
+     * Invalidate the cache whenever the triangulation changes.
+     */
+    boost::signals2::scoped_connection triangulation_connection;
+
+    /**
+     * Output file of the probe points.
+     */
+    std::ofstream probes_file;
+
+    /**
+     * Output files of the line samples.
+     */
+    std::vector<std::unique_ptr<std::ofstream>> line_files;
+
+    /**
+     * Output file of the integrals.
+     */
+    std::ofstream integrals_file;
+
+    /**
+     * True if the output files have been opened.
+     */
+    bool files_are_open = false;
+
+    /**
+     * Append to existing output files instead of truncating them.
+     */
+    bool append = false;
+  };
+
+  // ================================================================
+  // Template implementation
+  // ================================================================
+#ifndef DOXYGEN
+
+  template <int dim, int spacedim>
+  template <typename VectorType>
+  void
+  ReducedOutput<dim, spacedim>::write(
+    const double                             time,
+    const dealii::Mapping<dim, spacedim>    &mapping,
+    const dealii::DoFHandler<dim, spacedim> &dof_handler,
+    const VectorType                        &solution)
+  {
+    if (!enabled())
+      return;
+
+    integral_weights.set_time(time);
+    const auto values = point_values(mapping, dof_handler, solution);
+    const auto totals = integrals(mapping, dof_handler, solution);
+
+    if (dealii::Utilities::MPI::this_mpi_process(comm) != 0)
+      return;
+
+    if (!files_are_open)
+      open_files();
+
+    const auto write_row = [&](std::ofstream     &out,
+                               const unsigned int first,
+                               const unsigned int size,
+                               const auto        &data) {
+      out << time;
+      for (unsigned int i = first; i < first + size; ++i)
+        out << ", " << data[i];
+      out << std::endl;
+    };
+
+    if (!probe_points.empty())
+      write_row(probes_file,
+                0,
+                probe_points.size() * n_components,
+                values);
+
+    unsigned int first = probe_points.size() * n_components;
+    for (unsigned int l = 0; l < line_samples.size(); ++l)
+      {
+        const unsigned int size = std::get<2>(line_samples[l]) * n_components;
+        write_row(*line_files[l], first, size, values);
+        first += size;
+      }
+
+    if (!totals.empty())
+      write_row(integrals_file, 0, totals.size(), totals);
+  }
+
+
+
+  template <int dim, int spacedim>
+  template <typename VectorType>
+  std::vector<double>
+  ReducedOutput<dim, spacedim>::point_values(
+    const dealii::Mapping<dim, spacedim>    &mapping,
+    const dealii::DoFHandler<dim, spacedim> &dof_handler,
+    const VectorType                        &solution)
+  {
+    if (!cache_is_valid || cached_dof_handler != &dof_handler ||
+        cached_mapping != &mapping || cached_n_dofs != dof_handler.n_dofs())
+      update_cache(mapping, dof_handler);
+
+    std::vector<double> values(sample_points.size() * n_components, 0.0);
+    std::vector<dealii::Vector<double>> local_values(
+      1, dealii::Vector<double>(n_components));
+
+    for (const auto &point : cached_points)
+      {
+        point.fe_values->reinit(point.cell);
+        point.fe_values->get_function_values(solution, local_values);
+        for (unsigned int c = 0; c < n_components; ++c)
+          values[point.index * n_components + c] +=
+            local_values[0][c] / n_owners[point.index];
+      }
+    dealii::Utilities::MPI::sum(values, comm, values);
+    return values;
+  }
+
+
+
+  template <int dim, int spacedim>
+  template <typename VectorType>
+  std::vector<double>
+  ReducedOutput<dim, spacedim>::integrals(
+    const dealii::Mapping<dim, spacedim>    &mapping,
+    const dealii::DoFHandler<dim, spacedim> &dof_handler,
+    const VectorType                        &solution)
+  {
+    const unsigned int n_integrals =
+      (volume_integrals ? 1 : 0) + boundary_ids.size();
+    std::vector<double> result(n_integrals * n_components, 0.0);
+    if (n_integrals == 0)
+      return result;
+
+    const auto &fe     = dof_handler.get_fe();
+    const auto &tria   = dof_handler.get_triangulation();
+    const auto  degree = fe.tensor_degree() + 1;
+
+    dealii::FEValues<dim, spacedim> fe_values(
+      mapping,
+      fe,
+      Components::get_cell_quadrature(tria, degree),
+      dealii::update_values | dealii::update_quadrature_points |
+        dealii::update_JxW_values);
+
+    dealii::FEFaceValues<dim, spacedim> fe_face_values(
+      mapping,
+      fe,
+      Components::get_face_quadrature(tria, degree),
+      dealii::update_values | dealii::update_quadrature_points |
+        dealii::update_JxW_values);
+
+    std::vector<dealii::Vector<double>> values;
+    dealii::Vector<double>              weights(n_components);
+
+    const auto accumulate = [&](const auto &fev, const unsigned int offset) {
+      values.resize(fev.n_quadrature_points,
+                    dealii::Vector<double>(n_components));
+      fev.get_function_values(solution, values);
+      for (const auto q : fev.quadrature_point_indices())
+        {
+          integral_weights.vector_value(fev.quadrature_point(q), weights);
+          for (unsigned int c = 0; c < n_components; ++c)
+            result[offset + c] += weights[c] * values[q][c] * fev.JxW(q);
+        }
+    };
+
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        {
+          if (volume_integrals)
+            {
+              fe_values.reinit(cell);
+              accumulate(fe_values, 0);
+            }
+          if (!boundary_ids.empty() && cell->at_boundary())
+            for (const auto f : cell->face_indices())
+              if (cell->face(f)->at_boundary())
+                {
+                  const auto it = std::find(boundary_ids.begin(),
+                                            boundary_ids.end(),
+                                            cell->face(f)->boundary_id());
+                  if (it != boundary_ids.end())
+                    {
+                      fe_face_values.reinit(cell, f);
+                      accumulate(fe_face_values,
+                                 ((volume_integrals ? 1 : 0) +
+                                  (it - boundary_ids.begin())) *
+                                   n_components);
+                    }
+                }
+        }
+    dealii::Utilities::MPI::sum(result, comm, result);
+    return result;
+  }
+
+#endif
+
+} // namespace ParsedTools
+
+#endif
@@ -168,6 +168,20 @@ namespace PDEs
     using VectorType =
       typename LinearProblem<dim, spacedim, LacType>::VectorType;
 
+    using BlockVectorType =
+      typename LinearProblem<dim, spacedim, LacType>::BlockVectorType;
+
+    /**
+     * Solve the current system for all the right hand sides of a batch with
+     * the block CG method, preconditioned by the AMG preconditioner with the
+     * rigid body modes. When the direct solver, the block storage, or the
+     * single precision preconditioner are enabled, fall back to one solve per
+     * right hand side.
+     */
+    virtual void
+    solve_batch(const std::vector<BlockVectorType> &rhs_batch,
+                std::vector<BlockVectorType>       &solutions) override;
+
     /**
      * Compute integrals normal stress on Dirichlet faces, and average
      * displacement on Neumann faces.
@@ -62,18 +62,25 @@
 
 #include <fstream>
 #include <iostream>
+#include <tuple>
 
 #include "lac.h"
 #include "parsed_lac/amg.h"
+#include "parsed_lac/bsr_matrix.h"
+#include "parsed_lac/direct_solver.h"
 #include "parsed_lac/inverse_operator.h"
+#include "parsed_lac/mixed_precision.h"
+#include "parsed_lac/solver_telemetry.h"
 #include "parsed_tools/boundary_conditions.h"
 #include "parsed_tools/constants.h"
 #include "parsed_tools/convergence_table.h"
 #include "parsed_tools/data_out.h"
+#include "parsed_tools/dof_renumbering.h"
 #include "parsed_tools/finite_element.h"
 #include "parsed_tools/function.h"
 #include "parsed_tools/grid_generator.h"
 #include "parsed_tools/grid_refinement.h"
+#include "parsed_tools/reduced_output.h"
 
 namespace PDEs
 {
@@ -84,9 +91,11 @@ namespace PDEs
    */
   enum class EvolutionType
   {
-    steady_state = 1 << 0, //< Steady state problem
-    quasi_static = 1 << 1, //< Quasi static problem
-    transient    = 1 << 2, //< Transient problem
+    steady_state     = 1 << 0, //< Steady state problem
+    quasi_static     = 1 << 1, //< Quasi static problem
+    transient        = 1 << 2, //< Transient problem
+    nested_iteration = 1 << 3, //< Steady state problem, with nested iteration
+    ensemble         = 1 << 4, //< Many steady state problems on the same grid
   };
 
   /**
@@ -116,7 +125,8 @@ namespace PDEs
      * Main entry point of the problem.
      *
      * The role of this function is simply to call one of run_steady_state(),
-     * run_quasi_static() or run_transient().
+     * run_quasi_static(), run_transient(), run_nested_iteration(), or
+     * run_ensemble().
      */
     virtual void
     run();
@@ -127,6 +137,52 @@ namespace PDEs
     void
     run_steady_state();
 
+    /**
+     * Solve a steady state problem using nested iteration.
+     *
+     * The refinement cycles are the same of run_steady_state(), but the
+     * solution computed on each cycle is interpolated on the refined grid,
+     * and the linear system of the next cycle is only solved up to a fraction
+     * (the `Accuracy ratio`) of the error estimated on the previous cycle,
+     * i.e., up to the expected discretization error. The loop stops as soon
+     * as the estimated error drops below the `Target error`, if this is
+     * positive.
+     */
+    void
+    run_nested_iteration();
+
+    /**
+     * Solve an ensemble of steady state problems, that differ only in the
+     * values of some parameters, e.g., constants, forcing terms, or boundary
+     * values.
+     *
+     * The members of the ensemble are read from the `Sweep file`. Each member
+     * is a fragment of parameter file, and members are separated by lines
+     * containing only `---`, for example:
+     * @code{.sh}
+     * subsection Functions
+     *   set Forcing term = 1
+     * end
+     * ---
+     * subsection Functions
+     *   set Forcing term = 2
+     * end
+     * @endcode
+     * Each member is applied on top of the parameters of the main parameter
+     * file.
+     *
+     * The grid, the degrees of freedom, and the sparsity pattern are computed
+     * only once, and shared by all members. Only the constraints, the matrix,
+     * and the right hand side are recomputed for each member. If `Share
+     * preconditioner` is true, and the system matrix of a member is equal to
+     * the one of the previous member, the preconditioner is not rebuilt.
+     *
+     * Members cannot change the grid, the finite element space, or the type
+     * of the boundary conditions.
+     */
+    void
+    run_ensemble();
+
     /**
      * Solve a quasi static problem.
      */
@@ -144,6 +200,38 @@ namespace PDEs
      */
     using ARKode = typename SUNDIALS::ARKode<typename LacType::BlockVector>;
 
+    /**
+     * Save the current state of the simulation to disk, using
+     * `Checkpoint/Base name` as a prefix for all file names.
+     *
+     * The triangulation, the solution, and all the vectors added by the
+     * add_checkpoint_vectors signal are saved using the parallel distributed
+     * Triangulation::save() method, while the time information is written by
+     * the first process to the file `<Base name>.time`.
+     *
+     * @param step_number The current time step number.
+     * @param time The current time.
+     * @param output_cycle The number of the next output cycle.
+     */
+    virtual void
+    save_checkpoint(const unsigned int step_number,
+                    const double       time,
+                    const unsigned int output_cycle);
+
+    /**
+     * Restore the state saved by save_checkpoint().
+     *
+     * The triangulation must only contain the coarse grid when this function
+     * is called. On exit, the system has been setup on the restored grid, and
+     * the solution and all the vectors added by the add_checkpoint_vectors
+     * signal contain the saved values.
+     *
+     * @return A tuple containing the time step number, the time, and the
+     * output cycle that were stored in the checkpoint.
+     */
+    virtual std::tuple<unsigned int, double, unsigned int>
+    load_checkpoint();
+
     /**
      * Setup the transient problem.
      */
@@ -261,6 +349,58 @@ namespace PDEs
     virtual void
     setup_system();
 
+    /**
+     * Compute hanging node constraints and essential boundary conditions.
+     * Called by setup_system().
+     */
+    void
+    setup_constraints();
+
+    /**
+     * Return the coupling between the components of the problem, used by
+     * setup_system() to build the sparsity pattern of the system matrix.
+     *
+     * The default implementation uses the `Block coupling` parameter: a table
+     * with one row per block, separated by semicolons, with one entry per
+     * block, separated by commas. Each entry is one of
+     * - `always`: all components of the two blocks are coupled;
+     * - `nonzero`: as above, but only where the shape functions are nonzero;
+     * - `diagonal`: the k-th component of the first block is only coupled
+     *   with the k-th component of the second block (e.g., for vector
+     *   Laplacians);
+     * - `none`: the two blocks are not coupled.
+     *
+     * For example, for a vector Laplacian with components `u,u`, use `set
+     * Block coupling = diagonal`, and for two fields `u,v` that are solved
+     * together but do not interact use `set Block coupling = always, none;
+     * none, always`. The diagonal blocks cannot be `none`. Notice that the
+     * Stokes problem needs `always, always; always, always` (the default),
+     * since it assembles a pressure mass matrix in the pressure block. If the
+     * parameter is empty, all components are coupled.
+     *
+     * Derived classes can override this function to declare the coupling of
+     * their weak form.
+     */
+    virtual Table<2, DoFTools::Coupling>
+    get_coupling() const;
+
+    /**
+     * Use the rigid body modes of the components selected by @p
+     * component_mask as near null space of the AMG preconditioner of the
+     * system (see ParsedLAC::rigid_body_modes()). This is only meaningful
+     * for problems with a single block, whose components are the
+     * displacements of an elastic body.
+     *
+     * Nothing is done if the AMG preconditioner of LacType is a direct solver,
+     * i.e., for LAC::LAdealii when deal.II is compiled without Trilinos. With
+     * LAC::LAPETSc, the modes are only used by hypre if all the components
+     * are selected, and the degrees of freedom of each node are numbered
+     * consecutively (see ParsedLAC::PETScAMGPreconditioner and
+     * ParsedTools::DoFRenumbering::is_node_interleaved()).
+     */
+    void
+    set_rigid_body_modes(const ComponentMask &component_mask);
+
     /**
      * Overload this function to use a custom error estimator in the mesh
      * refinement process. In order to trigger this estimator, you have to
@@ -295,6 +435,61 @@ namespace PDEs
      */
     boost::signals2::signal<void()> assemble_system_call_back;
 
+    /**
+     * Assemble a batch of right hand sides, one for each of the given forcing
+     * terms, in a single loop over the cells.
+     *
+     * This function must be called after assemble_system(). The right hand
+     * side number `k` is obtained by replacing the forcing term of the
+     * problem with `forcing_terms[k]` in the current right hand side, i.e.,
+     * boundary conditions and all other terms are shared by the whole batch.
+     * The default implementation assumes that the forcing term enters the
+     * right hand side as \f$(f, v)\f$, evaluated at the quadrature points
+     * given by the mapping of the problem. Derived classes that assemble the
+     * forcing term differently must override this function.
+     *
+     * @param forcing_terms The forcing terms, with n_components components
+     * @param rhs_batch On output, one right hand side per forcing term
+     */
+    virtual void
+    assemble_rhs_batch(
+      const std::vector<const Function<spacedim> *> &forcing_terms,
+      std::vector<BlockVectorType>                  &rhs_batch);
+
+    /**
+     * Solve the current system for all the right hand sides of a batch.
+     *
+     * The default implementation calls solve() once per right hand side. The
+     * preconditioner is built at most once, by the first call to solve(),
+     * and it is shared by all the right hand sides of the batch. The
+     * solution of each right hand side is used as the initial guess for the
+     * next one. Problems with a symmetric positive definite system override
+     * this function, and use solve_batch_block_cg() instead.
+     *
+     * @param rhs_batch The right hand sides, e.g., from assemble_rhs_batch()
+     * @param solutions On output, one solution per right hand side
+     */
+    virtual void
+    solve_batch(const std::vector<BlockVectorType> &rhs_batch,
+                std::vector<BlockVectorType>       &solutions);
+
+    /**
+     * Solve the current system for all the right hand sides of a batch
+     * together, with the block CG method (see ParsedLAC::SolverBlockCG and
+     * ParsedLAC::InverseOperator::solve_block()), preconditioned by
+     * `preconditioner`. The matrix and the preconditioner are applied to all
+     * right hand sides at every iteration, and all the inner products of an
+     * iteration are computed with two global reductions.
+     *
+     * This is only valid for problems with a single block, and a symmetric
+     * positive definite system matrix. The preconditioner is initialized
+     * unless `reuse_preconditioner` is true, and the current solution is
+     * used as the initial guess for all the right hand sides.
+     */
+    void
+    solve_batch_block_cg(const std::vector<BlockVectorType> &rhs_batch,
+                         std::vector<BlockVectorType>       &solutions);
+
     /**
      * Output the solution and the grid in a format that can be read by
      * Paraview or Visit.
@@ -325,6 +520,16 @@ namespace PDEs
                                  const unsigned int &time_step_number)>
       advance_time_call_back;
 
+    /**
+     * Connect to this signal to add vectors to the checkpoint. Every entry is
+     * a pair of pointers to vectors with the same layout of the
+     * locally_relevant_solution (used to save the data) and of the solution
+     * (filled when restarting). After a restart, the ghosted vector is
+     * updated with the content of the restored one.
+     */
+    boost::signals2::signal<void(
+      std::vector<std::pair<BlockVectorType *, BlockVectorType *>> &)>
+      add_checkpoint_vectors;
 
     /**
      * Comma seperated names of components.
@@ -492,6 +697,19 @@ namespace PDEs
      */
     DoFHandler<dim, spacedim> dof_handler;
 
+    /**
+     * Renumbering of the degrees of freedom. The degrees of freedom are
+     * always grouped by blocks, and can be reordered within each block to
+     * improve the locality of the system matrix:
+     * @code{.sh}
+     * subsection DoF renumbering
+     *   set Log statistics = true
+     *   set Type           = hilbert
+     * end
+     * @endcode
+     */
+    ParsedTools::DoFRenumbering<dim, spacedim> dof_renumbering;
+
     /**
      * Hanging nodes and essential boundary conditions.
      */
@@ -562,6 +780,27 @@ namespace PDEs
      */
     typename LacType::AMG preconditioner;
 
+    /**
+     * Direct solver for the system matrix, used instead of inverse_operator
+     * and preconditioner when enabled in the parameter file. The
+     * factorization is reused as long as the matrix does not change.
+     */
+    ParsedLAC::DirectSolver direct_solver;
+
+    /**
+     * Single precision preconditioner for the system matrix, used instead of
+     * preconditioner when enabled in the parameter file. Only available for
+     * LAC::LAdealii.
+     */
+    ParsedLAC::MixedPrecisionPreconditioner single_precision_preconditioner;
+
+    /**
+     * Block compressed sparse row copy of the system matrix, with one block
+     * per node, and its point block smoother. Used by vector valued problems
+     * when enabled in the parameter file. Only available for LAC::LAdealii.
+     */
+    ParsedLAC::BSRStorage block_storage;
+
     /**
      * Inverse operator for the mass matrix.
      */
@@ -749,6 +988,109 @@ namespace PDEs
      */
     mutable ParsedTools::DataOut<dim, spacedim> data_out;
 
+    /**
+     * Reduced output of the solution: values at probe points and along
+     * lines, and integrals of the solution components. This is written at
+     * every step of quasi-static and steady state simulations, and at every
+     * output step of transient simulations, independently of the full output
+     * frequency:
+     * @code{.sh}
+     * subsection Reduced output
+     *   set Probe points     = 0.5,0.5
+     *   set Volume integrals = true
+     * end
+     * @endcode
+     */
+    ParsedTools::ReducedOutput<dim, spacedim> reduced_output;
+
+    /**
+     * Telemetry of the linear solves. When an output base name is given,
+     * the iterations, residual history, timings, and operation counts of
+     * every solve are written at the same stages of the reduced output:
+     * @code{.sh}
+     * subsection Solver telemetry
+     *   set Output base name = solver_telemetry
+     *   set Output format    = json
+     * end
+     * @endcode
+     */
+    ParsedLAC::SolverTelemetry telemetry;
+
+    /**
+     * Absolute tolerance that derived classes should pass to the
+     * inverse_operator in their solve() method. A value of zero means that
+     * the tolerance specified in the parameter file is used. This is only
+     * changed by run_nested_iteration().
+     */
+    double solver_tolerance = 0.0;
+
+    /**
+     * Ratio between the tolerance used by the linear solver and the error
+     * estimated on the previous refinement cycle. Only used in nested
+     * iteration.
+     */
+    double accuracy_ratio = 0.1;
+
+    /**
+     * Stop the nested iteration as soon as the estimated error is below this
+     * value. If zero, all refinement cycles are performed.
+     */
+    double target_error = 0.0;
+
+    /**
+     * File containing the members of the ensemble. Only used by
+     * run_ensemble().
+     */
+    std::string sweep_file = "";
+
+    /**
+     * Reuse the preconditioner across members of the ensemble that share the
+     * same system matrix.
+     */
+    bool share_preconditioner = true;
+
+    /**
+     * Coupling between the blocks of the problem. See get_coupling().
+     */
+    std::vector<std::vector<std::string>> block_coupling;
+
+    /**
+     * If true, derived classes should not rebuild their preconditioners in
+     * their solve() method, since the system matrix did not change since the
+     * last call. This is only set by run_ensemble().
+     */
+    bool reuse_preconditioner = false;
+
+    /**
+     * Restart the simulation from the last checkpoint. This can also be set
+     * with the `--restart` command line option of the Runner.
+     */
+    bool restart = false;
+
+    /**
+     * Save a checkpoint every this many time steps (or output steps, for
+     * transient simulations). If zero, no checkpoint is written.
+     */
+    unsigned int checkpoint_frequency = 0;
+
+    /**
+     * Prefix of all the files written by save_checkpoint().
+     */
+    std::string checkpoint_base_name = "checkpoint";
+
+    /**
+     * Number of the time step of the first ARKode output step. This is
+     * nonzero after restarting a transient simulation.
+     */
+    unsigned int transient_step_offset = 0;
+
+    /**
+     * Number of the next output cycle of a transient simulation. The solution
+     * is written every `output frequency` ARKode output steps. This is
+     * nonzero after restarting a transient simulation.
+     */
+    unsigned int transient_output_cycle = 0;
+
     /**
      * Initial time for transient and quasi stati simulations.
      */
@@ -15,6 +15,9 @@
 #ifndef pdes_linear_visco_elasticity_h
 #define pdes_linear_visco_elasticity_h
 
+#include <array>
+#include <fstream>
+
 #include "parsed_tools/constants.h"
 #include "parsed_tools/mapping_eulerian.h"
 #include "pdes/linear_problem.h"
@@ -63,6 +66,45 @@ namespace PDEs
     using VectorType =
       typename LinearProblem<dim, spacedim, LacType>::VectorType;
 
+    using BlockVectorType =
+      typename LinearProblem<dim, spacedim, LacType>::BlockVectorType;
+
+    /**
+     * Not available for this class: the forcing term is evaluated at the
+     * points of the deformed (Eulerian) configuration, which the default
+     * implementation of the base class does not know about.
+     */
+    virtual void
+    assemble_rhs_batch(
+      const std::vector<const Function<spacedim> *> &forcing_terms,
+      std::vector<BlockVectorType>                  &rhs_batch) override;
+
+    /**
+     * Not available for this class: every call to solve() advances the
+     * displacement by one time step, so that the default implementation of
+     * the base class would advance it once per right hand side.
+     */
+    virtual void
+    solve_batch(const std::vector<BlockVectorType> &rhs_batch,
+                std::vector<BlockVectorType>       &solutions) override;
+
+    /**
+     * Scratch data for the reference and for the deformed configurations,
+     * used by the threaded cell loops.
+     */
+    struct ScratchDataPair
+    {
+      /**
+       * Scratch data in the reference (Lagrangian) configuration.
+       */
+      ScratchData lagrangian;
+
+      /**
+       * Scratch data in the deformed (Eulerian) configuration.
+       */
+      ScratchData eulerian;
+    };
+
     /**
      * Compute energy integrals.
      */
@@ -102,6 +144,30 @@ namespace PDEs
      */
     ParsedTools::Constants constants_1;
 
+    /**
+     * Handles to the constants of a material, resolved once, so that the
+     * assembly loops do not look up constants by name.
+     */
+    struct Material
+    {
+      Material(const ParsedTools::Constants &constants)
+        : mu(constants.get_handle("mu"))
+        , lambda(constants.get_handle("lambda"))
+        , eta(constants.get_handle("eta"))
+        , kappa(constants.get_handle("kappa"))
+      {}
+
+      const ParsedTools::Constants::Handle mu;
+      const ParsedTools::Constants::Handle lambda;
+      const ParsedTools::Constants::Handle eta;
+      const ParsedTools::Constants::Handle kappa;
+    };
+
+    /**
+     * Constants of the two materials, indexed by region.
+     */
+    const std::array<Material, 2> materials;
+
     /**
      * Material ids of the first material.
      */
@@ -134,6 +200,11 @@ namespace PDEs
 
     typename LacType::BlockVector current_displacement;
     typename LacType::BlockVector current_displacement_locally_relevant;
+
+    /**
+     * File where the energies are written. Only used on the first process.
+     */
+    std::ofstream energy_file;
   };
 
   namespace MPI
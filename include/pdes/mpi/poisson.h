@@ -56,6 +56,17 @@ namespace PDEs
       using VectorType =
         typename LinearProblem<dim, spacedim, LAC::LATrilinos>::VectorType;
 
+      using BlockVectorType =
+        typename LinearProblem<dim, spacedim, LAC::LATrilinos>::BlockVectorType;
+
+      /**
+       * Solve the current system for all the right hand sides of a batch with
+       * the block CG method, unless the direct solver is enabled.
+       */
+      virtual void
+      solve_batch(const std::vector<BlockVectorType> &rhs_batch,
+                  std::vector<BlockVectorType>       &solutions) override;
+
     protected:
       /**
        * Explicitly assemble the Poisson problem on a single cell.
@@ -48,6 +48,7 @@
 
 #include "parsed_lac/amg.h"
 #include "parsed_lac/inverse_operator.h"
+#include "parsed_lac/mixed_precision.h"
 #include "parsed_tools/boundary_conditions.h"
 #include "parsed_tools/constants.h"
 #include "parsed_tools/convergence_table.h"
@@ -560,13 +561,14 @@ namespace PDEs
        * \name Linear algebra classes
        * @{
        */
-      AffineConstraints<double>    constraints;
-      SparsityPattern              sparsity_pattern;
-      SparseMatrix<double>         system_matrix;
-      Vector<double>               solution;
-      Vector<double>               system_rhs;
-      ParsedLAC::InverseOperator   inverse_operator;
-      ParsedLAC::AMGPreconditioner preconditioner;
+      AffineConstraints<double>               constraints;
+      SparsityPattern                         sparsity_pattern;
+      SparseMatrix<double>                    system_matrix;
+      Vector<double>                          solution;
+      Vector<double>                          system_rhs;
+      ParsedLAC::InverseOperator              inverse_operator;
+      ParsedLAC::AMGPreconditioner            preconditioner;
+      ParsedLAC::MixedPrecisionPreconditioner single_precision_preconditioner;
       /** @} */
 
       /**
@@ -776,15 +778,21 @@ namespace PDEs
       /**
        * Level of log verbosity.
        *
-       * This is the only "native" parameter of this class. All other parameters
-       * are set through the constructors of the classes that inherit from
-       * ParameterAcceptor.
+       * This and the number of threads are the only "native" parameters of
+       * this class. All other parameters are set through the constructors of
+       * the classes that inherit from ParameterAcceptor.
        *
        * The console_level is used to setup the dealii::LogStream class, and
        * allows dealii clases to print messages to the console at different
        * level of detail and verbosity.
        */
       unsigned int console_level = 1;
+
+      /**
+       * Maximum number of threads used by the assembly loop. A non-positive
+       * value means that all available cores are used.
+       */
+      int number_of_threads = -1;
       /** @} */
     };
   } // namespace Serial
@@ -288,6 +288,12 @@ namespace PDEs
        */
       unsigned int console_level = 1;
 
+      /**
+       * Maximum number of threads used by the assembly loop. A non-positive
+       * value means that all available cores are used.
+       */
+      int number_of_threads = -1;
+
 
 
       /**
@@ -29,11 +29,18 @@
 #include <deal.II/grid/tria.h>
 
 #include <deal.II/lac/affine_constraints.h>
-#include <deal.II/lac/sparse_direct.h>
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/linear_operator.h>
 #include <deal.II/lac/sparse_matrix.h>
 #include <deal.II/lac/vector.h>
 
+#include <boost/signals2/connection.hpp>
+
+#include <cstdint>
+#include <functional>
+
 #include "parsed_lac/amg.h"
+#include "parsed_lac/direct_solver.h"
 #include "parsed_lac/inverse_operator.h"
 #include "parsed_tools/boundary_conditions.h"
 #include "parsed_tools/constants.h"
@@ -62,8 +69,45 @@ namespace PDEs
       generate_grids_and_fes();
       void
       adjust_grid_refinements(const bool apply_delta_refinement = true);
+      /**
+       * Compute the basis functions of the reduced Lagrange multiplier space,
+       * according to the selected BasisType. The basis is cached, and only
+       * recomputed when the embedded grid changes.
+       */
       void
       update_basis_functions();
+
+      /**
+       * Interpolate several functions at once on the embedded space, with a
+       * single pass over the embedded cells. The function @p f receives a
+       * point and fills a vector with the values of all functions at that
+       * point.
+       */
+      void
+      interpolate_on_embedded_space(
+        const std::function<void(const Point<spacedim> &, Vector<double> &)>
+                                    &f,
+        std::vector<Vector<double>> &vectors);
+
+      /**
+       * Harmonic polynomials $r^k \cos(k\theta)$ and $r^k \sin(k\theta)$.
+       */
+      void
+      compute_harmonic_basis();
+
+      /**
+       * Proper orthogonal decomposition of the snapshots of the snapshot
+       * function, in the $L^2$ scalar product of the embedded space.
+       */
+      void
+      compute_pod_basis();
+
+      /**
+       * The first eigenfunctions of the Laplace operator on the embedded
+       * space.
+       */
+      void
+      compute_eigenfunction_basis();
       void
       setup_dofs();
       void
@@ -72,6 +116,61 @@ namespace PDEs
       assemble_system();
       void
       solve();
+
+      /**
+       * Offline stage of the reduced order model. Compute the dense reduced
+       * Schur complement $C A^{-1} C^T$, its inverse, the inverse of the Gram
+       * matrix of the basis functions, and the affine components of the
+       * reduced right hand side. This requires n_basis+1 solves with A_inv,
+       * and is done once per cycle.
+       */
+      void
+      compute_reduced_operators(const LinearOperator<Vector<double>> &A_inv);
+
+      /**
+       * Online stage of the reduced order model. Project the current
+       * embedded data on the basis, and compute the reduced solution using
+       * only the precomputed reduced operators, at a cost of
+       * O(n_basis^2) plus one linear combination of the precomputed
+       * responses. No solve with the stiffness matrix is performed.
+       */
+      void
+      solve_online();
+
+      /**
+       * Write the reduced operators to the given file.
+       */
+      void
+      save_reduced_operators(const std::string &filename) const;
+
+      /**
+       * Read the reduced operators from the given file, and check that they
+       * were computed with the current number and type of basis functions,
+       * on the current space and embedded discretizations, and with the same
+       * parameters (see reduced_operators_parameters_hash()).
+       */
+      void
+      load_reduced_operators(const std::string &filename);
+
+      /**
+       * A hash of all the parameters the reduced operators depend on, e.g.,
+       * the grids, the finite element spaces, the forcing term, the boundary
+       * conditions, the coupling, and the basis functions. Only the online
+       * data (`Embedded value`), the output, the file names, and the solvers
+       * of the full order system, and the refinement between cycles are left
+       * out.
+       */
+      std::uint64_t
+      reduced_operators_parameters_hash() const;
+
+      /**
+       * Return true if the reduced operators of the current cycle are read
+       * from file. This only happens on the first cycle: the following
+       * cycles refine the grids, and compute the reduced operators again.
+       */
+      bool
+      loads_reduced_operators() const;
+
       void
       output_results(const unsigned int cycle);
 
@@ -81,8 +180,21 @@ namespace PDEs
       unsigned int coupling_quadrature_order = 3;
       unsigned int delta_refinement          = 0;
       unsigned int console_level             = 1;
-      bool         use_direct_solver         = true;
       unsigned int n_basis                   = 1;
+      bool         solve_full_order          = true;
+
+      std::string save_reduced_operators_file = "";
+      std::string load_reduced_operators_file = "";
+
+      enum class BasisType
+      {
+        harmonic,
+        pod,
+        eigenfunctions
+      };
+      BasisType           basis_type          = BasisType::harmonic;
+      std::string         snapshot_function   = "1";
+      std::vector<double> snapshot_parameters = {};
 
       Triangulation<spacedim>                  space_grid;
       std::unique_ptr<FiniteElement<spacedim>> space_fe;
@@ -142,6 +254,27 @@ namespace PDEs
 
       std::vector<Vector<double>> basis_functions;
 
+      /**
+       * Set to false whenever the embedded grid changes.
+       */
+      bool                               basis_is_valid = false;
+      boost::signals2::scoped_connection embedded_grid_connection;
+
+      /**
+       * Set to true once the reduced operators have been read from file.
+       */
+      bool reduced_operators_loaded = false;
+
+      /**
+       * Reduced operators, computed in the offline stage.
+       */
+      FullMatrix<double>          reduced_schur_complement;
+      FullMatrix<double>          reduced_schur_complement_inverse;
+      FullMatrix<double>          reduced_mass_matrix_inverse;
+      Vector<double>              reduced_rhs;
+      Vector<double>              full_order_offset;
+      std::vector<Vector<double>> reduced_responses;
+
       TimerOutput monitor;
 
       // Parameter members
@@ -164,6 +297,7 @@ namespace PDEs
 
       ParsedLAC::InverseOperator   stiffness_inverse_operator;
       ParsedLAC::AMGPreconditioner stiffness_preconditioner;
+      ParsedLAC::DirectSolver      stiffness_direct_solver;
       ParsedLAC::AMGPreconditioner mass_preconditioner;
 
       ParsedLAC::InverseOperator schur_inverse_operator;
@@ -139,6 +139,9 @@ namespace PDEs
       // Console level
       unsigned int console_level = 1;
 
+      // Maximum number of threads. Use all cores if non-positive.
+      int number_of_threads = -1;
+
       // Extractor for vector components
       const FEValuesExtractors::Vector velocity;
       const FEValuesExtractors::Scalar pressure;
@@ -0,0 +1,244 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#ifndef pdes_shape_cache_h
+#define pdes_shape_cache_h
+
+#include <deal.II/base/config.h>
+
+#include <deal.II/base/symmetric_tensor.h>
+#include <deal.II/base/table.h>
+#include <deal.II/base/tensor.h>
+
+#include <deal.II/fe/fe_values.h>
+#include <deal.II/fe/fe_values_extractors.h>
+
+#include <deal.II/lac/full_matrix.h>
+
+#include <deal.II/meshworker/scratch_data.h>
+
+#include <vector>
+
+namespace PDEs
+{
+  /**
+   * The values, symmetric gradients, and divergences of the shape functions
+   * of a vector field, at all quadrature points of a cell.
+   *
+   * Only the shape functions that are nonzero in at least one of the
+   * components of the field are stored. They are numbered from zero to
+   * n_dofs(), and get_dofs() returns their index in the cell.
+   *
+   * Evaluating `fe_values[extractor].symmetric_gradient(j, q)` inside the
+   * loops over the test and trial functions costs O(n_dofs^2) evaluations per
+   * quadrature point. Filling this cache once per cell costs O(n_dofs), and
+   * the assembly loops only read precomputed tensors. Use
+   * reinit_shape_cache() to store one cache per field in the
+   * MeshWorker::ScratchData object used for the assembly.
+   *
+   * Only the quantities allowed by the update flags of the FEValues object
+   * are computed: values require dealii::update_values, and symmetric
+   * gradients and divergences require dealii::update_gradients.
+   */
+  template <int dim, int spacedim = dim>
+  class VectorShapeCache
+  {
+  public:
+    /**
+     * Compute the shape function data of the field @p extractor on the cell
+     * @p fe_values was last reinitialized on.
+     */
+    void
+    reinit(const dealii::FEValuesBase<dim, spacedim> &fe_values,
+           const dealii::FEValuesExtractors::Vector  &extractor);
+
+    /**
+     * Number of shape functions that are nonzero in the field.
+     */
+    unsigned int
+    n_dofs() const
+    {
+      return dofs.size();
+    }
+
+    /**
+     * Index in the cell of the shape functions that are nonzero in the
+     * field, in increasing order.
+     */
+    const std::vector<unsigned int> &
+    get_dofs() const
+    {
+      return dofs;
+    }
+
+    /**
+     * Value of the @p k-th stored shape function at the quadrature point
+     * @p q.
+     */
+    const dealii::Tensor<1, spacedim> &
+    value(const unsigned int k, const unsigned int q) const
+    {
+      return values(q, k);
+    }
+
+    /**
+     * Symmetric gradient of the @p k-th stored shape function at the
+     * quadrature point @p q.
+     */
+    const dealii::SymmetricTensor<2, spacedim> &
+    symmetric_gradient(const unsigned int k, const unsigned int q) const
+    {
+      return symmetric_gradients(q, k);
+    }
+
+    /**
+     * Divergence of the @p k-th stored shape function at the quadrature point
+     * @p q.
+     */
+    double
+    divergence(const unsigned int k, const unsigned int q) const
+    {
+      return divergences(q, k);
+    }
+
+  private:
+    /**
+     * Index in the cell of the stored shape functions.
+     */
+    std::vector<unsigned int> dofs;
+
+    /**
+     * Values, indexed by quadrature point and stored shape function.
+     */
+    dealii::Table<2, dealii::Tensor<1, spacedim>> values;
+
+    /**
+     * Symmetric gradients, indexed by quadrature point and stored shape
+     * function.
+     */
+    dealii::Table<2, dealii::SymmetricTensor<2, spacedim>> symmetric_gradients;
+
+    /**
+     * Divergences, indexed by quadrature point and stored shape function.
+     */
+    dealii::Table<2, double> divergences;
+  };
+
+
+
+  /**
+   * The values and gradients of the shape functions of a scalar field, at all
+   * quadrature points of a cell. See VectorShapeCache.
+   */
+  template <int dim, int spacedim = dim>
+  class ScalarShapeCache
+  {
+  public:
+    /**
+     * Compute the shape function data of the field @p extractor on the cell
+     * @p fe_values was last reinitialized on.
+     */
+    void
+    reinit(const dealii::FEValuesBase<dim, spacedim> &fe_values,
+           const dealii::FEValuesExtractors::Scalar  &extractor);
+
+    /**
+     * Number of shape functions that are nonzero in the field.
+     */
+    unsigned int
+    n_dofs() const
+    {
+      return dofs.size();
+    }
+
+    /**
+     * Index in the cell of the shape functions that are nonzero in the
+     * field, in increasing order.
+     */
+    const std::vector<unsigned int> &
+    get_dofs() const
+    {
+      return dofs;
+    }
+
+    /**
+     * Value of the @p k-th stored shape function at the quadrature point
+     * @p q.
+     */
+    double
+    value(const unsigned int k, const unsigned int q) const
+    {
+      return values(q, k);
+    }
+
+    /**
+     * Gradient of the @p k-th stored shape function at the quadrature point
+     * @p q.
+     */
+    const dealii::Tensor<1, spacedim> &
+    gradient(const unsigned int k, const unsigned int q) const
+    {
+      return gradients(q, k);
+    }
+
+  private:
+    /**
+     * Index in the cell of the stored shape functions.
+     */
+    std::vector<unsigned int> dofs;
+
+    /**
+     * Values, indexed by quadrature point and stored shape function.
+     */
+    dealii::Table<2, double> values;
+
+    /**
+     * Gradients, indexed by quadrature point and stored shape function.
+     */
+    dealii::Table<2, dealii::Tensor<1, spacedim>> gradients;
+  };
+
+
+
+  /**
+   * Return the VectorShapeCache of the field @p extractor stored in
+   * @p scratch, after reinitializing it on the current cell of @p scratch.
+   * This must be called after `scratch.reinit(cell)`.
+   */
+  template <int dim, int spacedim>
+  const VectorShapeCache<dim, spacedim> &
+  reinit_shape_cache(dealii::MeshWorker::ScratchData<dim, spacedim> &scratch,
+                     const dealii::FEValuesExtractors::Vector &extractor);
+
+  /**
+   * Return the ScalarShapeCache of the field @p extractor stored in
+   * @p scratch, after reinitializing it on the current cell of @p scratch.
+   * This must be called after `scratch.reinit(cell)`.
+   */
+  template <int dim, int spacedim>
+  const ScalarShapeCache<dim, spacedim> &
+  reinit_shape_cache(dealii::MeshWorker::ScratchData<dim, spacedim> &scratch,
+                     const dealii::FEValuesExtractors::Scalar &extractor);
+
+  /**
+   * Copy the strictly lower triangular part of @p matrix to its upper
+   * triangular part. Local matrices of symmetric bilinear forms can be
+   * assembled on the lower triangle only, and completed with this function.
+   */
+  void
+  mirror_lower_triangle(dealii::FullMatrix<double> &matrix);
+} // namespace PDEs
+
+#endif
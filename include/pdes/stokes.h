@@ -69,6 +69,11 @@ namespace PDEs
     typename LacType::AMG      schur_preconditioner;
     ParsedLAC::InverseOperator schur_solver;
 
+    /**
+     * Handle to the viscosity in constants, read during the assembly.
+     */
+    const ParsedTools::Constants::Handle viscosity;
+
 
     const FEValuesExtractors::Vector velocity;
     const FEValuesExtractors::Scalar pressure;
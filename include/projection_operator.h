@@ -18,11 +18,77 @@
 
 #include <deal.II/base/config.h>
 
+#include <deal.II/base/array_view.h>
+#include <deal.II/base/index_set.h>
+#include <deal.II/base/mpi.h>
+
+#include <deal.II/lac/lapack_full_matrix.h>
 #include <deal.II/lac/linear_operator_tools.h>
 #include <deal.II/lac/sparse_matrix.h>
 #include <deal.II/lac/vector.h>
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
 namespace dealii
 {
+  namespace internal
+  {
+    namespace ProjectionOperatorImplementation
+    {
+      /**
+       * Detect if a vector type has a get_mpi_communicator() method.
+       */
+      template <typename VectorType, typename = void>
+      struct has_mpi_communicator : std::false_type
+      {};
+
+      template <typename VectorType>
+      struct has_mpi_communicator<
+        VectorType,
+        std::void_t<
+          decltype(std::declval<const VectorType &>().get_mpi_communicator())>>
+        : std::true_type
+      {};
+
+      /**
+       * Return the communicator of a (possibly distributed) vector, or
+       * MPI_COMM_SELF for serial vectors.
+       */
+      template <typename VectorType>
+      MPI_Comm
+      get_mpi_communicator(const VectorType &vector)
+      {
+        if constexpr (has_mpi_communicator<VectorType>::value)
+          return vector.get_mpi_communicator();
+        else
+          {
+            (void)vector;
+            return MPI_COMM_SELF;
+          }
+      }
+
+      /**
+       * Data shared by all the lambdas of a projection operator: the locally
+       * owned entries of the basis vectors, stored contiguously in a column
+       * major matrix with one column per basis vector, and the index in the
+       * range space of each column.
+       */
+      template <typename Number>
+      struct ProjectionData
+      {
+        IndexSet                             range_indices;
+        std::vector<types::global_dof_index> basis_indices;
+        std::vector<types::global_dof_index> domain_indices;
+        LAPACKFullMatrix<Number>             basis;
+        bool                                 full_basis;
+        MPI_Comm                             domain_communicator;
+        MPI_Comm                             range_communicator;
+      };
+    } // namespace ProjectionOperatorImplementation
+  }   // namespace internal
+
   /**
    * Construct a LinearOperator object that projects a vector onto a basis.
    *
@@ -60,13 +126,26 @@ namespace dealii
    * @param range_exemplar An exmeplar vector of the range space. We'll make a
    * few copies of this vector to allow the operator to be used with
    * intermediate storage.
-   * @param local_basis A vector of references to the locally owned basis
-   * vectors. These vectors must be ordered according to the IndexSet
-   * Range::locally_owned_elements() of the range space.
+   * @param local_basis A vector of references to the basis vectors. These
+   * vectors must either be ordered according to the IndexSet
+   * Range::locally_owned_elements() of the range space, or contain all the
+   * `range_exemplar.size()` basis vectors. The second form is required when
+   * the Domain vectors are distributed, since every process then owns only a
+   * part of each basis vector.
    * @param domain_exemplar If used in parallel, it may happen that some
    * processes do not own any index of the Range space. In this case, you need
    * to provide a pointer to a Domain vector to be used as an exemplar vector.
    *
+   * The locally owned entries of the basis vectors are copied, at
+   * construction time, into a contiguous column major matrix. The projection
+   * is then computed with a single matrix-vector product on the local data,
+   * followed by a single reduction of the local contributions to all basis
+   * vectors, of which each process keeps the entries it owns in the range
+   * space. The transpose is computed with a single matrix-vector product,
+   * after gathering the coefficients of the basis vectors with a single
+   * reduction when needed. Changes to the basis vectors after the
+   * construction of the operator are not seen by the operator.
+   *
    * @return LinearOperator<Range, Domain, Payload>
    */
   template <
@@ -80,43 +159,159 @@ namespace dealii
     const Domain  *domain_exemplar = nullptr,
     const Payload &payload         = Payload())
   {
+    using Number = typename Domain::value_type;
+    using Data =
+      internal::ProjectionOperatorImplementation::ProjectionData<Number>;
+
+    Assert(domain_exemplar != nullptr || local_basis.size() > 0,
+           ExcMessage("If domain_exemplar is not provided, "
+                      "local_basis must contain at least one element."));
+    const Domain &domain = domain_exemplar != nullptr ?
+                             *domain_exemplar :
+                             local_basis[0].get();
+
+    auto data           = std::make_shared<Data>();
+    data->range_indices = range_exemplar.locally_owned_elements();
+    data->domain_communicator =
+      internal::ProjectionOperatorImplementation::get_mpi_communicator(domain);
+    data->range_communicator =
+      internal::ProjectionOperatorImplementation::get_mpi_communicator(
+        range_exemplar);
+
+    // All processes must agree on the form of the basis, since it decides
+    // which reductions are performed.
+    data->full_basis =
+      Utilities::MPI::min(static_cast<unsigned int>(local_basis.size() ==
+                                                    range_exemplar.size()),
+                          data->range_communicator) > 0;
+
+    if (data->full_basis)
+      {
+        data->basis_indices.resize(range_exemplar.size());
+        for (unsigned int b = 0; b < range_exemplar.size(); ++b)
+          data->basis_indices[b] = b;
+      }
+    else
+      {
+        AssertDimension(local_basis.size(), data->range_indices.n_elements());
+        for (const auto j : data->range_indices)
+          data->basis_indices.push_back(j);
+      }
+
+    const auto domain_owned = domain.locally_owned_elements();
+    data->domain_indices.resize(domain_owned.n_elements());
+    unsigned int k = 0;
+    for (const auto i : domain_owned)
+      data->domain_indices[k++] = i;
+
+    // If the domain is distributed, the contributions of all processes to
+    // each basis vector are needed.
+    const bool distributed_domain =
+      Utilities::MPI::max(static_cast<unsigned int>(domain_owned.n_elements() !=
+                                                    domain.size()),
+                          data->domain_communicator) > 0;
+    AssertThrow(data->full_basis || !distributed_domain,
+                ExcMessage("When the domain space is distributed, all the "
+                           "basis vectors must be provided on every "
+                           "process."));
+
+    // Copy the locally owned part of each basis vector in a column of a
+    // contiguous column major matrix.
+    const unsigned int n_local = data->domain_indices.size();
+    const unsigned int n_basis = local_basis.size();
+    data->basis.reinit(n_local, n_basis);
+    {
+      std::vector<Number> column(n_local);
+      for (unsigned int b = 0; b < n_basis; ++b)
+        {
+          local_basis[b].get().extract_subvector_to(
+            data->domain_indices.begin(),
+            data->domain_indices.end(),
+            column.begin());
+          for (unsigned int i = 0; i < n_local; ++i)
+            data->basis(i, b) = column[i];
+        }
+    }
+
+    // Compute the local contributions to all the dot products with a single
+    // GEMV on the local data, and sum them with a single reduction. Each
+    // process returns the entries it owns in the range space.
+    const auto project = [data, n_range = range_exemplar.size()](
+                           const Domain &src) {
+      const unsigned int n_local = data->domain_indices.size();
+      const unsigned int n_basis = data->basis.n();
+      Vector<Number>     local_src(n_local);
+      Vector<Number>     local_values(n_basis);
+      src.extract_subvector_to(data->domain_indices.begin(),
+                               data->domain_indices.end(),
+                               local_src.begin());
+      if (n_local > 0)
+        data->basis.Tvmult(local_values, local_src);
+
+      Vector<Number> all_values(n_range);
+      for (unsigned int b = 0; b < n_basis; ++b)
+        all_values[data->basis_indices[b]] = local_values[b];
+      Utilities::MPI::sum(ArrayView<const Number>(all_values.begin(), n_range),
+                          data->domain_communicator,
+                          ArrayView<Number>(all_values.begin(), n_range));
+
+      Vector<Number> values(data->range_indices.n_elements());
+      unsigned int   i = 0;
+      for (const auto j : data->range_indices)
+        values[i++] = all_values[j];
+      return values;
+    };
+
+    // Compute the local part of the linear combination of the basis vectors
+    // with a single GEMV. If all the basis vectors are stored, the
+    // coefficients owned by the other processes are gathered first.
+    const auto combine = [data, n_range = range_exemplar.size()](
+                           const Range &src) {
+      const unsigned int n_basis = data->basis.n();
+      Vector<Number>     all_coefficients(n_range);
+      for (const auto j : data->range_indices)
+        all_coefficients[j] = src[j];
+      if (data->full_basis)
+        Utilities::MPI::sum(
+          ArrayView<const Number>(all_coefficients.begin(), n_range),
+          data->range_communicator,
+          ArrayView<Number>(all_coefficients.begin(), n_range));
+
+      Vector<Number> coefficients(n_basis);
+      for (unsigned int b = 0; b < n_basis; ++b)
+        coefficients[b] = all_coefficients[data->basis_indices[b]];
+
+      Vector<Number> values(data->domain_indices.size());
+      if (values.size() > 0)
+        data->basis.vmult(values, coefficients);
+      return values;
+    };
+
     LinearOperator<Range, Domain, Payload> linear_operator(payload);
-    linear_operator.vmult = [range_exemplar, local_basis](Range        &dst,
-                                                          const Domain &src) {
-      static const auto id = range_exemplar.locally_owned_elements();
-      AssertDimension(local_basis.size(), id.n_elements());
-      unsigned int i = 0;
-      for (const auto j : id)
-        dst[j] = local_basis[i++].get() * src;
+    linear_operator.vmult = [data, project](Range &dst, const Domain &src) {
+      const auto   values = project(src);
+      unsigned int i      = 0;
+      for (const auto j : data->range_indices)
+        dst[j] = values[i++];
     };
 
-    linear_operator.vmult_add = [range_exemplar,
-                                 local_basis](Range &dst, const Domain &src) {
-      static const auto id = range_exemplar.locally_owned_elements();
-      AssertDimension(local_basis.size(), id.n_elements());
-      unsigned int i = 0;
-      for (const auto j : id)
-        dst[j] += local_basis[i++].get() * src;
+    linear_operator.vmult_add = [data, project](Range        &dst,
+                                                const Domain &src) {
+      const auto   values = project(src);
+      unsigned int i      = 0;
+      for (const auto j : data->range_indices)
+        dst[j] += values[i++];
     };
 
-    linear_operator.Tvmult = [range_exemplar, local_basis](Domain      &dst,
-                                                           const Range &src) {
-      static const auto id = range_exemplar.locally_owned_elements();
-      AssertDimension(local_basis.size(), id.n_elements());
-      dst            = 0;
-      unsigned int i = 0;
-      for (const auto j : id)
-        dst.sadd(1.0, src[j], local_basis[i++]);
+    linear_operator.Tvmult = [data, combine](Domain &dst, const Range &src) {
+      dst = 0;
+      dst.add(data->domain_indices, combine(src));
       dst.compress(VectorOperation::add);
     };
 
-    linear_operator.Tvmult_add = [range_exemplar,
-                                  local_basis](Domain &dst, const Range &src) {
-      static const auto id = range_exemplar.locally_owned_elements();
-      AssertDimension(local_basis.size(), id.n_elements());
-      unsigned int i = 0;
-      for (const auto j : id)
-        dst.sadd(1.0, src[j], local_basis[i++]);
+    linear_operator.Tvmult_add = [data, combine](Domain      &dst,
+                                                 const Range &src) {
+      dst.add(data->domain_indices, combine(src));
       dst.compress(VectorOperation::add);
     };
 
@@ -131,15 +326,10 @@ namespace dealii
         dst.reinit(*domain_exemplar, fast);
       };
     else
-      {
-        Assert(local_basis.size() > 0,
-               ExcMessage("If domain_exemplar is not provided, "
-                          "local_basis must contain at least one element."));
-        linear_operator.reinit_domain_vector = [local_basis](Domain &dst,
-                                                             bool    fast) {
-          dst.reinit(local_basis[0].get(), fast);
-        };
-      }
+      linear_operator.reinit_domain_vector = [local_basis](Domain &dst,
+                                                           bool    fast) {
+        dst.reinit(local_basis[0].get(), fast);
+      };
     return linear_operator;
   }
 } // namespace dealii
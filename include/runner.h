@@ -18,6 +18,9 @@
 
 #include <deal.II/base/utilities.h>
 
+#include <type_traits>
+#include <utility>
+
 /**
  * Gather some functions and classes typically used in the `main()` of the
  * FSI-suite applications.
@@ -166,6 +169,8 @@ namespace Runner
    *                                   be run. Defaults to 2.
    * -s, --spacedim <value>            Space dimension at which this program
    *                                   should run. Defaults to 2.
+   * -r, --restart                     Restart the simulation from the last
+   *                                   saved checkpoint.
    * -"Section/option name"=<value>    Any of the options that you can specify
    *                                   in the parameter file. The format here
    *                                   is the following: -"Section/Subsection/
@@ -206,9 +211,40 @@ namespace Runner
                             const std::string &input_parameter_file,
                             const std::string &output_parameter_file);
 
+  /**
+   * Return true if the option `-r` or `--restart` was given on the command
+   * line.
+   *
+   * @param argv Arguments of the command line.
+   */
+  bool
+  restart_requested(char **argv);
+
+  namespace internal
+  {
+    /**
+     * Type trait that is true if the class has a member `restart` that can be
+     * set to true.
+     */
+    template <typename Class, typename = void>
+    struct supports_restart : std::false_type
+    {};
+
+    template <typename Class>
+    struct supports_restart<
+      Class,
+      std::void_t<decltype(std::declval<Class &>().restart = true)>>
+      : std::true_type
+    {};
+  } // namespace internal
+
   /**
    * Setup parameters from the command line, and call the Class::run() method.
    *
+   * If the option `--restart` is given on the command line, the member
+   * `restart` of the class is set to true before calling Class::run().
+   * An exception is thrown if the class does not support restarting.
+   *
    * @tparam Class Type of the class to instantiate and run.
    * @param argv Arguments of the command line.
    * @param input_parameter_file Input parameter file.
@@ -225,6 +261,17 @@ namespace Runner
                                   input_parameter_file,
                                   output_parameter_file) == -1)
       return;
+    if constexpr (internal::supports_restart<Class>::value)
+      {
+        if (restart_requested(argv))
+          class_name.restart = true;
+      }
+    else
+      {
+        AssertThrow(restart_requested(argv) == false,
+                    dealii::ExcMessage(
+                      "This program does not support restarting."));
+      }
     class_name.run();
   }
 } // namespace Runner
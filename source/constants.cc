@@ -87,6 +87,18 @@ namespace ParsedTools
 
 
 
+  Constants::Handle
+  Constants::get_handle(const std::string &key) const
+  {
+    AssertThrow(constants.find(key) != constants.end(),
+                ExcMessage("The constant <" + key + "> is not defined."));
+    // Elements of a std::map are never moved, and parsing the parameters
+    // updates their values in place: the address of a value is stable.
+    return Handle(constants.at(key));
+  }
+
+
+
 #ifdef DEAL_II_WITH_SYMENGINE
   /**
    * Return the constants defined in this class as a
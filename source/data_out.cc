@@ -31,7 +31,9 @@
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -58,12 +60,101 @@ namespace
       rel = rel.substr(0, rel.find_last_of('/'));
     else
       rel = "./";
-    // Check if it exists, if not, create it
-    AssertThrow(std::system(
-                  ("test -d " + rel + " || mkdir -p " + rel).c_str()) == 0,
-                ExcMessage("Could not create directory " + rel));
     return rel;
   }
+
+  // Append a data set to the pvd file, overwriting the closing tags written
+  // by the previous call. If position is zero, a new file is created. Returns
+  // the position of the new closing tags. The format is the same used by
+  // DataOutBase::write_pvd_record().
+  std::streampos
+  append_pvd_record(const std::string   &filename,
+                    const std::streampos position,
+                    const double         time,
+                    const std::string   &data_set)
+  {
+    std::fstream pvd;
+    if (position == std::streampos(0))
+      {
+        pvd.open(filename, std::ios::out | std::ios::trunc);
+        AssertThrow(pvd, ExcFileNotOpen(filename));
+        pvd << "<?xml version=\"1.0\"?>\n"
+            << "<VTKFile type=\"Collection\" version=\"0.1\" "
+            << "ByteOrder=\"LittleEndian\">\n"
+            << "  <Collection>\n";
+      }
+    else
+      {
+        pvd.open(filename, std::ios::in | std::ios::out);
+        AssertThrow(pvd, ExcFileNotOpen(filename));
+        pvd.seekp(position);
+      }
+    pvd << std::setprecision(16) << "    <DataSet timestep=\"" << time
+        << "\" group=\"\" part=\"0\" file=\"" << data_set << "\"/>\n";
+    const auto new_position = pvd.tellp();
+    pvd << "  </Collection>\n"
+        << "</VTKFile>\n";
+    return new_position;
+  }
+
+  // Return the first n_grids time steps of an xdmf file written by
+  // DataOutBase::write_xdmf_file(), i.e., the text of the grids contained in
+  // the temporal collection.
+  std::vector<std::string>
+  read_xdmf_grids(const std::string &filename, const unsigned int n_grids)
+  {
+    std::vector<std::string> grids;
+    std::ifstream            in(filename);
+    std::string              line;
+    unsigned int             depth = 0;
+    while (std::getline(in, line))
+      {
+        if (grids.size() == n_grids && depth < 2)
+          break;
+        const bool opens  = line.find("<Grid") != std::string::npos &&
+                           line.find("/>") == std::string::npos;
+        const bool closes = line.find("</Grid>") != std::string::npos;
+        if (opens && depth == 1)
+          grids.emplace_back();
+        if (depth >= 2 || (opens && depth == 1))
+          grids.back() += line + "\n";
+        if (opens)
+          ++depth;
+        if (closes && depth > 0)
+          --depth;
+      }
+    // Drop an incomplete last grid
+    if (depth >= 2 && !grids.empty())
+      grids.pop_back();
+    return grids;
+  }
+
+  // Insert the given grids at the beginning of the temporal collection of
+  // an xdmf file written by DataOutBase::write_xdmf_file().
+  void
+  prepend_xdmf_grids(const std::string              &filename,
+                     const std::vector<std::string> &grids)
+  {
+    std::string content;
+    {
+      std::ifstream in(filename);
+      AssertThrow(in, ExcFileNotOpen(filename));
+      content.assign(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+    }
+    const auto collection = content.find("CollectionType=\"Temporal\"");
+    AssertThrow(collection != std::string::npos,
+                ExcMessage("No temporal collection in " + filename));
+    auto position = content.find('\n', collection) + 1;
+    for (const auto &grid : grids)
+      {
+        content.insert(position, grid);
+        position += grid.size();
+      }
+    std::ofstream out(filename);
+    AssertThrow(out, ExcFileNotOpen(filename));
+    out << content;
+  }
 } // namespace
 
 namespace ParsedTools
@@ -90,17 +181,70 @@ namespace ParsedTools
 
     add_parameter("Output material ids", this->output_material_ids);
 
-    add_parameter("Output format",
-                  this->output_format,
-                  "",
-                  this->prm,
-                  Patterns::Selection(DataOutBase::get_output_format_names()));
+    add_parameter(
+      "Output format",
+      this->output_format,
+      "Format of the output files. With `parallel vtu', all processes write "
+      "collectively a single vtu file per output step. With `hdf5', all "
+      "processes write collectively a single hdf5 file per output step, "
+      "and an xdmf file describes the whole time series.",
+      this->prm,
+      Patterns::Selection(DataOutBase::get_output_format_names() +
+                          "|parallel vtu"));
 
     add_parameter("Subdivisions", this->subdivisions);
 
     add_parameter("Write high order cells", this->write_higher_order_cells);
 
     add_parameter("Curved cells region", this->curved_cells_region);
+
+    add_parameter("Write mesh once",
+                  this->write_mesh_once,
+                  "In hdf5 format, write the mesh to its own file only when "
+                  "it changes, and only write the data at every output step. "
+                  "Set it to false if the mapping moves the mesh without "
+                  "changing the triangulation.");
+
+    add_parameter("Asynchronous output",
+                  this->asynchronous_output,
+                  "Write output files in a background thread.");
+
+    add_parameter("Output queue size",
+                  this->output_queue_size,
+                  "Maximum number of outputs waiting to be written by the "
+                  "background thread.",
+                  this->prm,
+                  Patterns::Integer(1));
+  }
+
+
+
+  template <int dim, int spacedim>
+  DataOut<dim, spacedim>::~DataOut()
+  {
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      stop_writer = true;
+    }
+    queue_condition.notify_all();
+    if (writer.joinable())
+      writer.join();
+
+    if (writer_exception)
+      try
+        {
+          std::rethrow_exception(writer_exception);
+        }
+      catch (const std::exception &exc)
+        {
+          std::cerr << "Error while writing output in the background: "
+                    << exc.what() << std::endl;
+        }
+      catch (...)
+        {
+          std::cerr << "Unknown error while writing output in the background."
+                    << std::endl;
+        }
   }
 
 
@@ -109,7 +253,166 @@ namespace ParsedTools
   void
   DataOut<dim, spacedim>::clear_pvd_record()
   {
+    flush();
     pvd_record.clear();
+    xdmf_entries.clear();
+    resumed_xdmf_grids.clear();
+    pvd_position = 0;
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DataOut<dim, spacedim>::resume_pvd_record(const unsigned int n_records)
+  {
+    clear_pvd_record();
+    n_resumed_records = n_records;
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DataOut<dim, spacedim>::restore_pvd_record()
+  {
+    if (n_resumed_records == 0)
+      return;
+
+    // All processes keep the same number of records, since the time of each
+    // record is its index. Only the first process writes the pvd file.
+    pvd_record.resize(n_resumed_records);
+    for (unsigned int i = 0; i < n_resumed_records; ++i)
+      pvd_record[i].first = i;
+
+    if (this_mpi_process == 0 && output_format == "hdf5")
+      resumed_xdmf_grids = read_xdmf_grids(current_directory + "/" +
+                                             master_name + ".xdmf",
+                                           n_resumed_records);
+    else if (this_mpi_process == 0)
+      {
+        const std::string pvd_file =
+          current_directory + "/" + master_name + ".pvd";
+        std::vector<std::string> data_sets;
+        {
+          std::ifstream in(pvd_file);
+          std::string   line;
+          while (data_sets.size() < n_resumed_records && std::getline(in, line))
+            {
+              const auto pos = line.find("file=\"");
+              if (line.find("<DataSet") != std::string::npos &&
+                  pos != std::string::npos)
+                {
+                  const auto begin = pos + 6;
+                  data_sets.push_back(
+                    line.substr(begin, line.find('"', begin) - begin));
+                }
+            }
+        }
+        for (unsigned int i = 0; i < data_sets.size(); ++i)
+          {
+            pvd_record[i].second = data_sets[i];
+            pvd_position =
+              append_pvd_record(pvd_file, pvd_position, i, data_sets[i]);
+          }
+      }
+    n_resumed_records = 0;
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DataOut<dim, spacedim>::flush()
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    queue_condition.wait(lock, [&]() {
+      return queue.empty() && n_running_tasks == 0;
+    });
+    rethrow_writer_exception();
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DataOut<dim, spacedim>::rethrow_writer_exception()
+  {
+    if (writer_exception)
+      {
+        auto exc         = writer_exception;
+        writer_exception = nullptr;
+        std::rethrow_exception(exc);
+      }
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DataOut<dim, spacedim>::schedule(std::function<void()> &&task)
+  {
+    if (asynchronous_output == false)
+      {
+        // Make sure that tasks queued before switching off asynchronous
+        // output are executed first.
+        flush();
+        task();
+        return;
+      }
+
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    // Report the failure of a previous output before queuing a new one
+    rethrow_writer_exception();
+    if (writer.joinable() == false)
+      writer = std::thread([&]() { process_queue(); });
+
+    // Block while the queue is full
+    queue_condition.wait(lock,
+                         [&]() { return queue.size() < output_queue_size; });
+    queue.emplace_back(std::move(task));
+    lock.unlock();
+    queue_condition.notify_all();
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DataOut<dim, spacedim>::process_queue()
+  {
+    while (true)
+      {
+        std::function<void()> task;
+        {
+          std::unique_lock<std::mutex> lock(queue_mutex);
+          queue_condition.wait(lock,
+                               [&]() { return stop_writer || !queue.empty(); });
+          if (queue.empty())
+            return;
+          task = std::move(queue.front());
+          queue.pop_front();
+          ++n_running_tasks;
+        }
+        queue_condition.notify_all();
+
+        try
+          {
+            task();
+          }
+        catch (...)
+          {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (!writer_exception)
+              writer_exception = std::current_exception();
+          }
+
+        {
+          std::lock_guard<std::mutex> lock(queue_mutex);
+          --n_running_tasks;
+        }
+        queue_condition.notify_all();
+      }
   }
 
 
@@ -120,9 +423,8 @@ namespace ParsedTools
     const DoFHandler<dim, spacedim> &dh,
     const std::string               &suffix)
   {
-    data_out = std::make_unique<dealii::DataOut<dim, spacedim>>();
-    data_out->set_default_format(
-      DataOutBase::parse_output_format(output_format));
+    data_out = std::make_unique<internal::DataOut<dim, spacedim>>();
+    data_out->set_default_format(get_output_format());
 
 
     master_name       = relative(base_name);
@@ -130,29 +432,53 @@ namespace ParsedTools
     current_filename  = relative(fname);
     current_directory = dirname(fname);
 
+    // Only create the output directory the first time we see it
+    if (current_directory != created_directory)
+      {
+        std::error_code ec;
+        std::filesystem::create_directories(current_directory, ec);
+        AssertThrow(std::filesystem::is_directory(current_directory),
+                    ExcMessage("Could not create directory " +
+                               current_directory));
+        created_directory = current_directory;
+      }
+
+    // Keep track of changes in the mesh. Refinement and coarsening of the
+    // triangulation trigger the any_change signal.
+    if (&dh != last_dof_handler || dh.n_dofs() != last_n_dofs)
+      {
+        mesh_changed     = true;
+        last_dof_handler = &dh;
+        last_n_dofs      = dh.n_dofs();
+        triangulation_connection =
+          dh.get_triangulation().signals.any_change.connect(
+            [&]() { mesh_changed = true; });
+      }
+
     if (subdivisions == 0)
       subdivisions = dh.get_fe().degree;
 
+    vtk_flags = DataOutBase::VtkFlags();
     if (write_higher_order_cells && dim > 1)
       {
-        DataOutBase::VtkFlags flags;
-        flags.write_higher_order_cells = true;
-        data_out->set_flags(flags);
+        vtk_flags.write_higher_order_cells = true;
+        data_out->set_flags(vtk_flags);
       }
 
     if (data_out->default_suffix() != "")
       {
         // If the output is needed and we have many processes, just output
-        // the one we need *in intermediate format*.
-        if (n_mpi_processes > 1)
+        // the one we need *in intermediate format*, unless all processes
+        // write to the same file.
+        if (n_mpi_processes > 1 && !collective_output())
           fname += ("." + Utilities::int_to_string(this_mpi_process, 2) + "." +
                     Utilities::int_to_string(n_mpi_processes, 2) +
                     data_out->default_suffix());
         else
           fname += data_out->default_suffix();
 
-        output_file.open(fname);
-        AssertThrow(output_file, ExcIO());
+        // The file is opened when the data is actually written
+        output_file_name = fname;
         data_out->attach_dof_handler(dh);
 
         if (n_mpi_processes > 1)
@@ -197,30 +523,37 @@ namespace ParsedTools
     if (output_format == "none")
       return;
 
-    AssertThrow(output_file, ExcIO());
     if (data_out->default_suffix() != "")
       {
+        // Patches are built by the calling thread, since they need access to
+        // the DoFHandler and to the data vectors, which may change as soon as
+        // we return from this function.
         data_out->build_patches(mapping,
                                 this->subdivisions,
                                 this->curved_cells_region);
-        data_out->write(output_file);
+        restore_pvd_record();
+
+        if (collective_output())
+          {
+            write_collectively(mapping);
+            data_out = nullptr;
+            return;
+          }
+
+        std::shared_ptr<internal::Patches<dim, spacedim>> patches =
+          data_out->extract_patches(get_output_format(), vtk_flags);
 
         std::string master_file = current_filename;
 
+        std::vector<std::string> filenames;
         if (this_mpi_process == 0 && n_mpi_processes > 1 &&
             data_out->default_suffix() == ".vtu")
           {
-            std::vector<std::string> filenames;
             for (unsigned int i = 0; i < n_mpi_processes; ++i)
               filenames.push_back(relative(current_filename) + "." +
                                   Utilities::int_to_string(i, 2) + "." +
                                   Utilities::int_to_string(n_mpi_processes, 2) +
                                   data_out->default_suffix());
-
-            std::ofstream master_output(
-              (current_directory + "/" + current_filename + ".pvtu").c_str());
-            data_out->write_pvtu_record(master_output, filenames);
-
             master_file += ".pvtu";
           }
         else
@@ -228,20 +561,137 @@ namespace ParsedTools
             master_file += data_out->default_suffix();
           }
 
-        pvd_record.push_back(
-          std::make_pair(pvd_record.size(), relative(master_file)));
+        const double time = pvd_record.size();
+        pvd_record.push_back(std::make_pair(time, relative(master_file)));
+
+        const std::string pvtu_file =
+          current_directory + "/" + current_filename + ".pvtu";
+        const std::string pvd_file =
+          current_directory + "/" + master_name + ".pvd";
+        const std::string data_set = relative(master_file);
+
+        // Everything that follows only uses copies of the data, and can be
+        // executed in a background thread.
+        schedule([this,
+                  patches,
+                  filenames,
+                  pvtu_file,
+                  pvd_file,
+                  data_set,
+                  time,
+                  file_name = output_file_name]() {
+          std::ofstream output(file_name);
+          AssertThrow(output, ExcFileNotOpen(file_name));
+          patches->write(output);
+
+          if (this_mpi_process == 0)
+            {
+              if (!filenames.empty())
+                {
+                  std::ofstream master_output(pvtu_file);
+                  patches->write_pvtu_record(master_output, filenames);
+                }
+              pvd_position =
+                append_pvd_record(pvd_file, pvd_position, time, data_set);
+            }
+        });
+      }
+    data_out = nullptr;
+  }
 
+  template <int dim, int spacedim>
+  bool
+  DataOut<dim, spacedim>::collective_output() const
+  {
+    return output_format == "parallel vtu" || output_format == "hdf5";
+  }
+
+
+
+  template <int dim, int spacedim>
+  DataOutBase::OutputFormat
+  DataOut<dim, spacedim>::get_output_format() const
+  {
+    return DataOutBase::parse_output_format(
+      output_format == "parallel vtu" ? "vtu" : output_format);
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DataOut<dim, spacedim>::write_collectively(
+    const Mapping<dim, spacedim> &mapping)
+  {
+    // Collective MPI-IO cannot be executed in the background thread. Make
+    // sure the previous outputs are on disk before writing this one.
+    flush();
+
+    const double time = pvd_record.size();
+    if (output_format == "parallel vtu")
+      {
+        const std::string data_set = current_filename + ".vtu";
+        data_out->write_vtu_in_parallel(current_directory + "/" + data_set,
+                                        comm);
+
+        pvd_record.push_back(std::make_pair(time, data_set));
         if (this_mpi_process == 0)
+          pvd_position =
+            append_pvd_record(current_directory + "/" + master_name + ".pvd",
+                              pvd_position,
+                              time,
+                              data_set);
+      }
+    else
+      {
+        DataOutBase::DataOutFilter filter(
+          DataOutBase::DataOutFilterFlags(true, true));
+        data_out->write_filtered_data(filter);
+
+        if (&mapping != last_mapping)
           {
-            std::ofstream pvd_output(
-              (current_directory + "/" + master_name + ".pvd"));
-            DataOutBase::write_pvd_record(pvd_output, pvd_record);
+            mesh_changed = true;
+            last_mapping = &mapping;
           }
+
+        const std::string h5_file = current_filename + ".h5";
+        if (write_mesh_once == false)
+          {
+            // Mesh and data in the same file
+            data_out->write_hdf5_parallel(filter,
+                                          current_directory + "/" + h5_file,
+                                          comm);
+            xdmf_entries.push_back(
+              data_out->create_xdmf_entry(filter, h5_file, time, comm));
+          }
+        else
+          {
+            const bool write_mesh = mesh_changed || mesh_file_name.empty();
+            if (write_mesh)
+              mesh_file_name = current_filename + "_mesh.h5";
+            data_out->write_hdf5_parallel(filter,
+                                          write_mesh,
+                                          current_directory + "/" +
+                                            mesh_file_name,
+                                          current_directory + "/" + h5_file,
+                                          comm);
+            xdmf_entries.push_back(data_out->create_xdmf_entry(
+              filter, mesh_file_name, h5_file, time, comm));
+            mesh_changed = false;
+          }
+        data_out->write_xdmf_file(xdmf_entries,
+                                  current_directory + "/" + master_name +
+                                    ".xdmf",
+                                  comm);
+        if (this_mpi_process == 0 && !resumed_xdmf_grids.empty())
+          prepend_xdmf_grids(current_directory + "/" + master_name + ".xdmf",
+                             resumed_xdmf_grids);
+        pvd_record.push_back(std::make_pair(time, h5_file));
       }
-    data_out = 0;
-    output_file.close();
   }
 
+
+
   template class DataOut<1, 1>;
   template class DataOut<1, 2>;
   template class DataOut<1, 3>;
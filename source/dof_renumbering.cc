@@ -0,0 +1,492 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_tools/dof_renumbering.h"
+
+#include <deal.II/base/logstream.h>
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/timer.h>
+#include <deal.II/base/utilities.h>
+
+#include <deal.II/dofs/dof_renumbering.h>
+#include <deal.II/dofs/dof_tools.h>
+
+#include <deal.II/fe/fe.h>
+
+#include <deal.II/lac/dynamic_sparsity_pattern.h>
+#include <deal.II/lac/sparse_matrix.h>
+#include <deal.II/lac/sparsity_pattern.h>
+#include <deal.II/lac/sparsity_tools.h>
+#include <deal.II/lac/vector.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <utility>
+
+using namespace dealii;
+
+namespace ParsedTools
+{
+  namespace
+  {
+    /**
+     * Number the locally owned degrees of freedom in the order in which they
+     * are first found on the given cells, and renumber the DoFHandler
+     * accordingly. Degrees of freedom that do not belong to any of the cells
+     * are numbered last, in their original order.
+     */
+    template <int dim, int spacedim, typename KeyType>
+    void
+    renumber_by_cell_keys(
+      DoFHandler<dim, spacedim> &dof_handler,
+      std::vector<
+        std::pair<KeyType,
+                  typename DoFHandler<dim, spacedim>::active_cell_iterator>>
+        &keys)
+    {
+      std::stable_sort(keys.begin(),
+                       keys.end(),
+                       [](const auto &a, const auto &b) {
+                         return a.first < b.first;
+                       });
+
+      const IndexSet &owned = dof_handler.locally_owned_dofs();
+
+      std::vector<types::global_dof_index> new_numbers(
+        owned.n_elements(), numbers::invalid_dof_index);
+      std::vector<types::global_dof_index> dof_indices;
+      types::global_dof_index              next = 0;
+      for (const auto &key_and_cell : keys)
+        {
+          const auto &cell = key_and_cell.second;
+          dof_indices.resize(cell->get_fe().n_dofs_per_cell());
+          cell->get_dof_indices(dof_indices);
+          for (const auto i : dof_indices)
+            if (owned.is_element(i))
+              {
+                auto &n = new_numbers[owned.index_within_set(i)];
+                if (n == numbers::invalid_dof_index)
+                  n = owned.nth_index_in_set(next++);
+              }
+        }
+      for (auto &n : new_numbers)
+        if (n == numbers::invalid_dof_index)
+          n = owned.nth_index_in_set(next++);
+
+      dof_handler.renumber_dofs(new_numbers);
+    }
+
+    /**
+     * For each degree of freedom of @p fe, the index of the degree of freedom
+     * of the first copy of the same base element that has the same index
+     * within the base element, i.e., of the first component of its node.
+     */
+    template <int dim, int spacedim>
+    std::vector<unsigned int>
+    node_leaders(const FiniteElement<dim, spacedim> &fe)
+    {
+      std::map<std::pair<unsigned int, unsigned int>, unsigned int> first_copy;
+      for (unsigned int i = 0; i < fe.n_dofs_per_cell(); ++i)
+        {
+          const auto base = fe.system_to_base_index(i);
+          if (base.first.second == 0)
+            first_copy[{base.first.first, base.second}] = i;
+        }
+
+      std::vector<unsigned int> leaders(fe.n_dofs_per_cell());
+      for (unsigned int i = 0; i < fe.n_dofs_per_cell(); ++i)
+        {
+          const auto base = fe.system_to_base_index(i);
+          leaders[i]      = first_copy.at({base.first.first, base.second});
+        }
+      return leaders;
+    }
+
+
+
+    /**
+     * Cuthill-McKee renumbering of the nodes of the locally owned degrees of
+     * freedom (see node_leaders()). The graph of the nodes couples all the
+     * nodes of each cell, and the degrees of freedom of each node are
+     * numbered consecutively, in their original order. This keeps the
+     * components of a vector valued element at a node together, unlike
+     * dealii::DoFRenumbering::Cuthill_McKee(), which renumbers the graph of
+     * all the degrees of freedom.
+     */
+    template <int dim, int spacedim>
+    void
+    renumber_nodes_Cuthill_McKee(DoFHandler<dim, spacedim> &dof_handler)
+    {
+      const IndexSet &owned = dof_handler.locally_owned_dofs();
+
+      // The first component of the node of each locally owned dof, as an
+      // index within the locally owned dofs. The components of a node are
+      // owned by the same process.
+      std::vector<types::global_dof_index> leader_of(
+        owned.n_elements(), numbers::invalid_dof_index);
+      std::vector<types::global_dof_index> dof_indices;
+      for (const auto &cell : dof_handler.active_cell_iterators())
+        if (!cell->is_artificial())
+          {
+            const auto leaders = node_leaders(cell->get_fe());
+            dof_indices.resize(cell->get_fe().n_dofs_per_cell());
+            cell->get_dof_indices(dof_indices);
+            for (unsigned int i = 0; i < dof_indices.size(); ++i)
+              if (owned.is_element(dof_indices[i]))
+                leader_of[owned.index_within_set(dof_indices[i])] =
+                  owned.index_within_set(dof_indices[leaders[i]]);
+          }
+
+      // Number the nodes in the order of their first component
+      std::vector<types::global_dof_index> node_of(owned.n_elements());
+      types::global_dof_index              n_nodes = 0;
+      for (types::global_dof_index i = 0; i < owned.n_elements(); ++i)
+        {
+          if (leader_of[i] == numbers::invalid_dof_index)
+            leader_of[i] = i;
+          if (leader_of[i] == i)
+            node_of[i] = n_nodes++;
+        }
+      std::vector<std::vector<types::global_dof_index>> node_dofs(n_nodes);
+      for (types::global_dof_index i = 0; i < owned.n_elements(); ++i)
+        {
+          node_of[i] = node_of[leader_of[i]];
+          node_dofs[node_of[i]].push_back(i);
+        }
+
+      // Nodes that are not on locally owned cells are only coupled to
+      // themselves
+      DynamicSparsityPattern dsp(n_nodes);
+      for (types::global_dof_index n = 0; n < n_nodes; ++n)
+        dsp.add(n, n);
+      std::vector<types::global_dof_index> cell_nodes;
+      for (const auto &cell : dof_handler.active_cell_iterators())
+        if (cell->is_locally_owned())
+          {
+            dof_indices.resize(cell->get_fe().n_dofs_per_cell());
+            cell->get_dof_indices(dof_indices);
+            cell_nodes.clear();
+            for (const auto i : dof_indices)
+              if (owned.is_element(i))
+                cell_nodes.push_back(node_of[owned.index_within_set(i)]);
+            std::sort(cell_nodes.begin(), cell_nodes.end());
+            cell_nodes.erase(std::unique(cell_nodes.begin(), cell_nodes.end()),
+                             cell_nodes.end());
+            for (const auto n : cell_nodes)
+              dsp.add_entries(n, cell_nodes.begin(), cell_nodes.end());
+          }
+
+      std::vector<DynamicSparsityPattern::size_type> new_node_numbers(
+        node_dofs.size());
+      SparsityTools::reorder_Cuthill_McKee(dsp, new_node_numbers);
+
+      std::vector<types::global_dof_index> nodes_in_new_order(
+        node_dofs.size());
+      for (types::global_dof_index n = 0; n < node_dofs.size(); ++n)
+        nodes_in_new_order[new_node_numbers[n]] = n;
+
+      std::vector<types::global_dof_index> new_numbers(owned.n_elements());
+      types::global_dof_index              next = 0;
+      for (const auto n : nodes_in_new_order)
+        for (const auto i : node_dofs[n])
+          new_numbers[i] = owned.nth_index_in_set(next++);
+
+      dof_handler.renumber_dofs(new_numbers);
+    }
+
+
+
+    /**
+     * Interleave the bits of the given integer coordinates, from the most
+     * significant to the least significant one.
+     */
+    template <int dim>
+    std::uint64_t
+    morton_index(const std::array<std::uint64_t, dim> &coordinates,
+                 const unsigned int                   bits_per_dim)
+    {
+      std::uint64_t index = 0;
+      for (int b = bits_per_dim - 1; b >= 0; --b)
+        for (unsigned int d = 0; d < dim; ++d)
+          index = (index << 1) | ((coordinates[d] >> b) & 1);
+      return index;
+    }
+  } // namespace
+
+
+
+  template <int dim, int spacedim>
+  DoFRenumbering<dim, spacedim>::DoFRenumbering(
+    const std::string &section_name,
+    const std::string &type,
+    const bool         log_statistics)
+    : ParameterAcceptor(section_name)
+    , type(type)
+    , log_statistics(log_statistics)
+  {
+    direction[0] = 1.0;
+    add_parameter("Type",
+                  this->type,
+                  "Ordering of the degrees of freedom within each block.",
+                  this->prm,
+                  Patterns::Selection(
+                    "none|cuthill_mckee|hilbert|morton|downstream"));
+    add_parameter("Downstream direction",
+                  direction,
+                  "Direction used by the downstream ordering.");
+    add_parameter("Log statistics",
+                  this->log_statistics,
+                  "Write the bandwidth of the system matrix, and the time of "
+                  "a local matrix-vector product, before and after the "
+                  "renumbering.");
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DoFRenumbering<dim, spacedim>::renumber(
+    DoFHandler<dim, spacedim>       &dof_handler,
+    const std::vector<unsigned int> &blocks) const
+  {
+    dealii::DoFRenumbering::component_wise(dof_handler, blocks);
+    if (type == "none")
+      return;
+
+    types::global_dof_index bandwidth_before = 0;
+    double                  time_before      = 0;
+    if (log_statistics)
+      {
+        bandwidth_before = bandwidth(dof_handler, blocks);
+        time_before      = local_matvec_time(dof_handler);
+      }
+
+    // The orderings mix the blocks: renumber component wise again, which
+    // keeps the new relative order of the degrees of freedom of each block.
+    reorder(dof_handler);
+    dealii::DoFRenumbering::component_wise(dof_handler, blocks);
+
+    if (log_statistics)
+      deallog << "DoF renumbering (" << type << "): bandwidth "
+              << bandwidth_before << " -> " << bandwidth(dof_handler, blocks)
+              << ", local matvec time " << time_before << "s -> "
+              << local_matvec_time(dof_handler) << "s" << std::endl;
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  DoFRenumbering<dim, spacedim>::reorder(
+    DoFHandler<dim, spacedim> &dof_handler) const
+  {
+    using CellIterator =
+      typename DoFHandler<dim, spacedim>::active_cell_iterator;
+
+    if (type == "cuthill_mckee")
+      {
+        renumber_nodes_Cuthill_McKee(dof_handler);
+        return;
+      }
+
+    std::vector<CellIterator>    cells;
+    std::vector<Point<spacedim>> centers;
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        {
+          cells.push_back(cell);
+          centers.push_back(cell->center());
+        }
+
+    if (type == "downstream")
+      {
+        std::vector<std::pair<double, CellIterator>> keys;
+        for (unsigned int i = 0; i < cells.size(); ++i)
+          keys.emplace_back(direction * centers[i], cells[i]);
+        renumber_by_cell_keys(dof_handler, keys);
+        return;
+      }
+
+    // Both space filling curves use the same number of bits per coordinate,
+    // so that the index of a cell fits in a single 64 bits integer.
+    const unsigned int bits_per_dim = std::min(64 / spacedim, 32);
+
+    std::vector<std::pair<std::uint64_t, CellIterator>> keys;
+    if (type == "hilbert")
+      {
+        const auto coordinates =
+          Utilities::inverse_Hilbert_space_filling_curve(centers,
+                                                         bits_per_dim);
+        for (unsigned int i = 0; i < cells.size(); ++i)
+          keys.emplace_back(
+            Utilities::pack_integers<spacedim>(coordinates[i], bits_per_dim),
+            cells[i]);
+      }
+    else if (type == "morton")
+      {
+        // Scale the centers to the bounding box of the locally owned cells
+        Point<spacedim> lower, upper;
+        if (centers.size() > 0)
+          lower = upper = centers[0];
+        for (const auto &p : centers)
+          for (unsigned int d = 0; d < spacedim; ++d)
+            {
+              lower[d] = std::min(lower[d], p[d]);
+              upper[d] = std::max(upper[d], p[d]);
+            }
+        const double max_coordinate =
+          static_cast<double>((std::uint64_t(1) << bits_per_dim) - 1);
+        for (unsigned int i = 0; i < cells.size(); ++i)
+          {
+            std::array<std::uint64_t, spacedim> coordinates;
+            for (unsigned int d = 0; d < spacedim; ++d)
+              {
+                const double length = upper[d] - lower[d];
+                coordinates[d]      = 0;
+                if (length > 0)
+                  coordinates[d] = static_cast<std::uint64_t>(
+                    (centers[i][d] - lower[d]) / length * max_coordinate);
+              }
+            keys.emplace_back(morton_index<spacedim>(coordinates,
+                                                     bits_per_dim),
+                              cells[i]);
+          }
+      }
+    else
+      AssertThrow(false, ExcMessage("Unknown renumbering type <" + type + ">"));
+    renumber_by_cell_keys(dof_handler, keys);
+  }
+
+
+
+  template <int dim, int spacedim>
+  types::global_dof_index
+  DoFRenumbering<dim, spacedim>::bandwidth(
+    const DoFHandler<dim, spacedim> &dof_handler,
+    const std::vector<unsigned int> &blocks)
+  {
+    types::global_dof_index              result = 0;
+    std::vector<types::global_dof_index> dof_indices;
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        {
+          const auto &fe = cell->get_fe();
+          dof_indices.resize(fe.n_dofs_per_cell());
+          cell->get_dof_indices(dof_indices);
+          for (unsigned int i = 0; i < dof_indices.size(); ++i)
+            for (unsigned int j = 0; j < i; ++j)
+              {
+                const auto block_i =
+                  blocks[fe.get_nonzero_components(i)
+                           .first_selected_component()];
+                const auto block_j =
+                  blocks[fe.get_nonzero_components(j)
+                           .first_selected_component()];
+                if (block_i == block_j)
+                  result = std::max(result,
+                                    dof_indices[i] > dof_indices[j] ?
+                                      dof_indices[i] - dof_indices[j] :
+                                      dof_indices[j] - dof_indices[i]);
+              }
+        }
+    return Utilities::MPI::max(
+      result, dof_handler.get_triangulation().get_communicator());
+  }
+
+
+
+  template <int dim, int spacedim>
+  bool
+  DoFRenumbering<dim, spacedim>::is_node_interleaved(
+    const DoFHandler<dim, spacedim> &dof_handler,
+    const unsigned int               block_size)
+  {
+    bool                                 result = true;
+    std::vector<types::global_dof_index> dof_indices;
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (result && cell->is_locally_owned())
+        {
+          const auto &fe = cell->get_fe();
+          for (unsigned int b = 0; b < fe.n_base_elements(); ++b)
+            result = result && (fe.element_multiplicity(b) == block_size);
+
+          const auto leaders = node_leaders(fe);
+          dof_indices.resize(fe.n_dofs_per_cell());
+          cell->get_dof_indices(dof_indices);
+          for (unsigned int i = 0; i < dof_indices.size(); ++i)
+            {
+              const auto first = dof_indices[leaders[i]];
+              result = result && (first % block_size == 0) &&
+                       (dof_indices[i] ==
+                        first + fe.system_to_base_index(i).first.second);
+            }
+        }
+    return Utilities::MPI::min(
+             static_cast<unsigned int>(result),
+             dof_handler.get_triangulation().get_communicator()) == 1;
+  }
+
+
+
+  template <int dim, int spacedim>
+  double
+  DoFRenumbering<dim, spacedim>::local_matvec_time(
+    const DoFHandler<dim, spacedim> &dof_handler)
+  {
+    IndexSet relevant;
+    DoFTools::extract_locally_relevant_dofs(dof_handler, relevant);
+
+    DynamicSparsityPattern               dsp(relevant.n_elements());
+    std::vector<types::global_dof_index> dof_indices;
+    for (const auto &cell : dof_handler.active_cell_iterators())
+      if (cell->is_locally_owned())
+        {
+          dof_indices.resize(cell->get_fe().n_dofs_per_cell());
+          cell->get_dof_indices(dof_indices);
+          for (auto &i : dof_indices)
+            i = relevant.index_within_set(i);
+          for (const auto i : dof_indices)
+            dsp.add_entries(i, dof_indices.begin(), dof_indices.end());
+        }
+    SparsityPattern sparsity;
+    sparsity.copy_from(dsp);
+
+    SparseMatrix<double> matrix(sparsity);
+    for (auto &entry : matrix)
+      entry.value() = 1.0;
+
+    Vector<double> src(relevant.n_elements()), dst(relevant.n_elements());
+    src = 1.0;
+
+    // Warm up the caches, and then average over a few products
+    const unsigned int n_products = 10;
+    matrix.vmult(dst, src);
+    Timer timer;
+    for (unsigned int i = 0; i < n_products; ++i)
+      matrix.vmult(dst, src);
+    return timer.wall_time() / n_products;
+  }
+
+
+
+  template class DoFRenumbering<1, 1>;
+  template class DoFRenumbering<1, 2>;
+  template class DoFRenumbering<1, 3>;
+  template class DoFRenumbering<2, 2>;
+  template class DoFRenumbering<2, 3>;
+  template class DoFRenumbering<3, 3>;
+} // namespace ParsedTools
@@ -62,7 +62,8 @@ namespace ParsedTools
   template <int dim, int spacedim>
   void
   GridGenerator<dim, spacedim>::generate(
-    dealii::Triangulation<dim, spacedim> &tria) const
+    dealii::Triangulation<dim, spacedim> &tria,
+    const bool                            apply_initial_refinement) const
   {
     // TimerOutput::Scope timer_section(timer, "GridGenerator::generate");
     const auto ext =
@@ -213,7 +214,8 @@ namespace ParsedTools
 
     // Write the grid before refining it.
     write(tria);
-    tria.refine_global(initial_grid_refinement);
+    if (apply_initial_refinement)
+      tria.refine_global(initial_grid_refinement);
   }
 
 
@@ -21,6 +21,8 @@
 
 #  include <deal.II/lac/sparse_matrix.h>
 
+#  include "parsed_lac/solver_telemetry.h"
+
 using namespace dealii;
 
 namespace ParsedLAC
@@ -159,10 +161,20 @@ namespace ParsedLAC
 
 
 
+  void
+  AMGPreconditioner::set_rigid_body_modes(
+    const std::vector<std::vector<double>> &modes)
+  {
+    this->rigid_body_modes = modes;
+  }
+
+
+
   template <typename Matrix>
   void
   AMGPreconditioner::initialize(const Matrix &matrix)
   {
+    SolverTelemetry::SetupTimer timer;
     TrilinosWrappers::PreconditionAMG::AdditionalData data;
 
     data.elliptic              = elliptic;
@@ -170,12 +182,15 @@ namespace ParsedLAC
     data.n_cycles              = n_cycles;
     data.w_cycle               = w_cycle;
     data.aggregation_threshold = aggregation_threshold;
-    data.constant_modes        = constant_modes;
     data.smoother_sweeps       = smoother_sweeps;
     data.smoother_overlap      = smoother_overlap;
     data.output_details        = output_details;
     data.smoother_type         = smoother_type.c_str();
     data.coarse_type           = coarse_type.c_str();
+    if (rigid_body_modes.empty())
+      data.constant_modes = constant_modes;
+    else
+      data.constant_modes_values = rigid_body_modes;
     this->TrilinosWrappers::PreconditionAMG::initialize(matrix, data);
   }
 } // namespace ParsedLAC
@@ -14,6 +14,7 @@
 // ---------------------------------------------------------------------
 
 #include <parsed_lac/amg_muelu.h>
+#include <parsed_lac/solver_telemetry.h>
 
 #if defined(DEAL_II_WITH_TRILINOS) && defined(DEAL_II_TRILINOS_WITH_MUELU)
 
@@ -21,6 +22,8 @@
 
 #  include <deal.II/lac/sparse_matrix.h>
 
+#  include <algorithm>
+
 using namespace dealii;
 
 namespace ParsedLAC
@@ -141,17 +144,34 @@ namespace ParsedLAC
         "|IFPACK-Block Chebyshev"));
   }
 
+
+
+  void
+  AMGMueLuPreconditioner::set_rigid_body_modes(
+    const std::vector<std::vector<double>> &modes)
+  {
+    constant_modes.clear();
+    for (const auto &mode : modes)
+      if (std::all_of(mode.begin(), mode.end(), [](const double v) {
+            return v == 0.0 || v == 1.0;
+          }))
+        constant_modes.emplace_back(mode.begin(), mode.end());
+  }
+
+
+
   template <typename Matrix>
   void
   AMGMueLuPreconditioner::initialize_preconditioner(const Matrix &matrix)
   {
+    SolverTelemetry::SetupTimer timer;
     TrilinosWrappers::PreconditionAMGMueLu::AdditionalData data;
 
     data.elliptic              = elliptic;
     data.n_cycles              = n_cycles;
     data.w_cycle               = w_cycle;
     data.aggregation_threshold = aggregation_threshold;
-    data.constant_modes        = std::vector<std::vector<bool>>(0);
+    data.constant_modes        = constant_modes;
     data.smoother_sweeps       = smoother_sweeps;
     data.smoother_overlap      = smoother_overlap;
     data.output_details        = output_details;
@@ -20,9 +20,18 @@
 
 #  include <deal.II/dofs/dof_tools.h>
 
+#  include <deal.II/lac/exceptions.h>
+#  include <deal.II/lac/petsc_vector.h>
 #  include <deal.II/lac/sparse_matrix.h>
 
+#  include <petscmat.h>
+#  include <petscsys.h>
+
+#  include <string>
+#  include <utility>
+
 #  include "parsed_lac/amg_petsc.h"
+#  include "parsed_lac/solver_telemetry.h"
 
 
 using namespace dealii;
@@ -118,6 +127,7 @@ namespace ParsedLAC
   PETScAMGPreconditioner::initialize(
     const dealii::PETScWrappers::MatrixBase &matrix)
   {
+    SolverTelemetry::SetupTimer timer;
     dealii::PETScWrappers::PreconditionBoomerAMG::AdditionalData data;
 
     data.symmetric_operator               = symmetric_operator;
@@ -133,7 +143,80 @@ namespace ParsedLAC
     data.max_iter                         = max_iter;
     data.w_cycle                          = w_cycle;
 
+    if (!rigid_body_modes.empty())
+      {
+        // The deal.II interface to BoomerAMG has no near null space: attach
+        // it to the matrix, where PETSc preconditioners look for it. PETSc
+        // requires the vectors to be orthonormal.
+        const IndexSet owned = matrix.locally_owned_range_indices();
+        std::vector<PETScWrappers::MPI::Vector> modes(
+          rigid_body_modes.size(),
+          PETScWrappers::MPI::Vector(owned, matrix.get_mpi_communicator()));
+        std::vector<Vec> vectors;
+        for (unsigned int m = 0; m < modes.size(); ++m)
+          {
+            AssertDimension(rigid_body_modes[m].size(), owned.n_elements());
+            for (unsigned int i = 0; i < owned.n_elements(); ++i)
+              modes[m](owned.nth_index_in_set(i)) = rigid_body_modes[m][i];
+            modes[m].compress(VectorOperation::insert);
+            for (unsigned int n = 0; n < m; ++n)
+              modes[m].add(-(modes[m] * modes[n]), modes[n]);
+            modes[m] /= modes[m].l2_norm();
+            vectors.push_back(modes[m]);
+          }
+
+        MatNullSpace   near_null_space;
+        PetscErrorCode ierr = MatNullSpaceCreate(matrix.get_mpi_communicator(),
+                                                 PETSC_FALSE,
+                                                 vectors.size(),
+                                                 vectors.data(),
+                                                 &near_null_space);
+        AssertThrow(ierr == 0, ExcPETScError(ierr));
+        ierr = MatSetNearNullSpace(matrix, near_null_space);
+        AssertThrow(ierr == 0, ExcPETScError(ierr));
+        ierr = MatNullSpaceDestroy(&near_null_space);
+        AssertThrow(ierr == 0, ExcPETScError(ierr));
+      }
+
+    // BoomerAMG only reads the near null space for the vector interpolation
+    // of systems, with as many functions as the block size of the matrix.
+    // The options are removed after the setup, so that they do not leak into
+    // other hypre preconditioners.
+    const std::vector<std::pair<std::string, std::string>> system_options = {
+      {"-pc_hypre_boomeramg_nodal_coarsen", "4"},
+      {"-pc_hypre_boomeramg_vec_interp_variant", "2"}};
+    const bool use_system_amg = !rigid_body_modes.empty() && n_components > 1;
+    if (use_system_amg)
+      {
+        PetscErrorCode ierr = MatSetBlockSize(matrix, n_components);
+        AssertThrow(ierr == 0, ExcPETScError(ierr));
+        for (const auto &[option, value] : system_options)
+          {
+            ierr = PetscOptionsSetValue(nullptr, option.c_str(), value.c_str());
+            AssertThrow(ierr == 0, ExcPETScError(ierr));
+          }
+      }
+
     this->PETScWrappers::PreconditionBoomerAMG::initialize(matrix, data);
+
+    if (use_system_amg)
+      for (const auto &option : system_options)
+        {
+          const PetscErrorCode ierr =
+            PetscOptionsClearValue(nullptr, option.first.c_str());
+          AssertThrow(ierr == 0, ExcPETScError(ierr));
+        }
+  }
+
+
+
+  void
+  PETScAMGPreconditioner::set_rigid_body_modes(
+    const std::vector<std::vector<double>> &modes,
+    const unsigned int                      n_components)
+  {
+    this->rigid_body_modes = modes;
+    this->n_components     = n_components;
   }
 } // namespace ParsedLAC
 
@@ -0,0 +1,563 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/bsr_matrix.h"
+
+#include <deal.II/base/logstream.h>
+#include <deal.II/base/memory_consumption.h>
+#include <deal.II/base/parallel.h>
+
+#include <deal.II/lac/full_matrix.h>
+
+#include <algorithm>
+
+#include "parsed_lac/solver_telemetry.h"
+
+using namespace dealii;
+
+namespace ParsedLAC
+{
+  namespace
+  {
+    /**
+     * Minimum number of rows of blocks processed by a single task.
+     */
+    constexpr unsigned int grain_size = 64;
+
+    /**
+     * Multiply the rows of blocks in [begin, end) by src, with blocks of
+     * compile time size, so that the loops over the entries of each block can
+     * be unrolled and vectorized.
+     */
+    template <int size>
+    void
+    vmult_block_rows(const unsigned int               begin,
+                     const unsigned int               end,
+                     const std::vector<std::size_t>  &row_start,
+                     const std::vector<unsigned int> &columns,
+                     const std::vector<double>       &values,
+                     const double                    *src,
+                     double                          *dst,
+                     const bool                       add)
+    {
+      for (unsigned int I = begin; I < end; ++I)
+        {
+          double y[size];
+          for (unsigned int i = 0; i < size; ++i)
+            y[i] = add ? dst[I * size + i] : 0.0;
+          for (std::size_t k = row_start[I]; k < row_start[I + 1]; ++k)
+            {
+              const double *block = values.data() + k * size * size;
+              const double *x     = src + columns[k] * size;
+              for (unsigned int i = 0; i < size; ++i)
+                {
+                  double sum = 0;
+                  DEAL_II_OPENMP_SIMD_PRAGMA
+                  for (unsigned int j = 0; j < size; ++j)
+                    sum += block[i * size + j] * x[j];
+                  y[i] += sum;
+                }
+            }
+          for (unsigned int i = 0; i < size; ++i)
+            dst[I * size + i] = y[i];
+        }
+    }
+
+    /**
+     * Same as above, for blocks of any size. Blocks of size two and three are
+     * dispatched to the fixed size version.
+     */
+    void
+    vmult_block_rows(const unsigned int               begin,
+                     const unsigned int               end,
+                     const unsigned int               b,
+                     const std::vector<std::size_t>  &row_start,
+                     const std::vector<unsigned int> &columns,
+                     const std::vector<double>       &values,
+                     const double                    *src,
+                     double                          *dst,
+                     const bool                       add)
+    {
+      if (b == 2)
+        return vmult_block_rows<2>(
+          begin, end, row_start, columns, values, src, dst, add);
+      if (b == 3)
+        return vmult_block_rows<3>(
+          begin, end, row_start, columns, values, src, dst, add);
+
+      for (unsigned int I = begin; I < end; ++I)
+        {
+          double *y = dst + I * b;
+          if (!add)
+            std::fill(y, y + b, 0.0);
+          for (std::size_t k = row_start[I]; k < row_start[I + 1]; ++k)
+            {
+              const double *block = values.data() + k * b * b;
+              const double *x     = src + columns[k] * b;
+              for (unsigned int i = 0; i < b; ++i)
+                for (unsigned int j = 0; j < b; ++j)
+                  y[i] += block[i * b + j] * x[j];
+            }
+        }
+    }
+
+    /**
+     * Multiply the dense block @p block of size @p b by @p x, and add the
+     * result, multiplied by @p factor, to @p y.
+     */
+    void
+    add_block_vmult(const unsigned int b,
+                    const double      *block,
+                    const double      *x,
+                    const double       factor,
+                    double            *y)
+    {
+      for (unsigned int i = 0; i < b; ++i)
+        {
+          double sum = 0;
+          for (unsigned int j = 0; j < b; ++j)
+            sum += block[i * b + j] * x[j];
+          y[i] += factor * sum;
+        }
+    }
+  } // namespace
+
+
+
+  void
+  BSRMatrix::initialize(const SparseMatrix<double> &matrix,
+                        const unsigned int          block_size)
+  {
+    AssertThrow(block_size > 0, ExcMessage("The block size must be positive."));
+    AssertThrow(matrix.m() % block_size == 0 && matrix.n() % block_size == 0,
+                ExcMessage("The size of the matrix must be a multiple of the "
+                           "block size."));
+
+    this->block_size = block_size;
+    n_rows           = matrix.m();
+    n_cols           = matrix.n();
+
+    const unsigned int b                = block_size;
+    const unsigned int n_rows_of_blocks = n_rows / b;
+
+    // First pass: the sorted block columns of each row of blocks
+    row_start.assign(n_rows_of_blocks + 1, 0);
+    columns.clear();
+    std::vector<unsigned int> row_columns;
+    for (unsigned int I = 0; I < n_rows_of_blocks; ++I)
+      {
+        row_columns.clear();
+        for (unsigned int i = 0; i < b; ++i)
+          for (auto entry = matrix.begin(I * b + i);
+               entry != matrix.end(I * b + i);
+               ++entry)
+            row_columns.push_back(entry->column() / b);
+        std::sort(row_columns.begin(), row_columns.end());
+        row_columns.erase(std::unique(row_columns.begin(), row_columns.end()),
+                          row_columns.end());
+        columns.insert(columns.end(), row_columns.begin(), row_columns.end());
+        row_start[I + 1] = columns.size();
+      }
+
+    // Second pass: the values
+    values.assign(columns.size() * b * b, 0.0);
+    for (unsigned int I = 0; I < n_rows_of_blocks; ++I)
+      {
+        const auto first = columns.begin() + row_start[I];
+        const auto last  = columns.begin() + row_start[I + 1];
+        for (unsigned int i = 0; i < b; ++i)
+          for (auto entry = matrix.begin(I * b + i);
+               entry != matrix.end(I * b + i);
+               ++entry)
+            {
+              const auto k =
+                std::lower_bound(first, last, entry->column() / b) -
+                columns.begin();
+              values[k * b * b + i * b + entry->column() % b] =
+                entry->value();
+            }
+      }
+  }
+
+
+
+  types::global_dof_index
+  BSRMatrix::m() const
+  {
+    return n_rows;
+  }
+
+
+
+  types::global_dof_index
+  BSRMatrix::n() const
+  {
+    return n_cols;
+  }
+
+
+
+  unsigned int
+  BSRMatrix::get_block_size() const
+  {
+    return block_size;
+  }
+
+
+
+  unsigned int
+  BSRMatrix::n_block_rows() const
+  {
+    return row_start.size() > 0 ? row_start.size() - 1 : 0;
+  }
+
+
+
+  std::size_t
+  BSRMatrix::n_blocks() const
+  {
+    return columns.size();
+  }
+
+
+
+  void
+  BSRMatrix::vmult(Vector<double> &dst, const Vector<double> &src) const
+  {
+    AssertDimension(dst.size(), m());
+    AssertDimension(src.size(), n());
+    Assert(&dst != &src, ExcMessage("Source and destination must differ."));
+
+    const auto work = [&](const unsigned int begin, const unsigned int end) {
+      vmult_block_rows(begin,
+                       end,
+                       block_size,
+                       row_start,
+                       columns,
+                       values,
+                       src.data(),
+                       dst.data(),
+                       false);
+    };
+    parallel::apply_to_subranges(0u, n_block_rows(), work, grain_size);
+  }
+
+
+
+  void
+  BSRMatrix::vmult_add(Vector<double> &dst, const Vector<double> &src) const
+  {
+    AssertDimension(dst.size(), m());
+    AssertDimension(src.size(), n());
+    Assert(&dst != &src, ExcMessage("Source and destination must differ."));
+
+    const auto work = [&](const unsigned int begin, const unsigned int end) {
+      vmult_block_rows(begin,
+                       end,
+                       block_size,
+                       row_start,
+                       columns,
+                       values,
+                       src.data(),
+                       dst.data(),
+                       true);
+    };
+    parallel::apply_to_subranges(0u, n_block_rows(), work, grain_size);
+  }
+
+
+
+  void
+  BSRMatrix::Tvmult(Vector<double> &dst, const Vector<double> &src) const
+  {
+    dst = 0;
+    Tvmult_add(dst, src);
+  }
+
+
+
+  void
+  BSRMatrix::Tvmult_add(Vector<double> &dst, const Vector<double> &src) const
+  {
+    AssertDimension(dst.size(), n());
+    AssertDimension(src.size(), m());
+    Assert(&dst != &src, ExcMessage("Source and destination must differ."));
+
+    // Different rows of blocks write to the same entries of dst: this loop
+    // is serial.
+    const unsigned int b = block_size;
+    for (unsigned int I = 0; I < n_block_rows(); ++I)
+      for (std::size_t k = row_start[I]; k < row_start[I + 1]; ++k)
+        {
+          const double *block = values.data() + k * b * b;
+          for (unsigned int i = 0; i < b; ++i)
+            for (unsigned int j = 0; j < b; ++j)
+              dst[columns[k] * b + j] += block[i * b + j] * src[I * b + i];
+        }
+  }
+
+
+
+  std::size_t
+  BSRMatrix::memory_consumption() const
+  {
+    return sizeof(*this) + MemoryConsumption::memory_consumption(row_start) +
+           MemoryConsumption::memory_consumption(columns) +
+           MemoryConsumption::memory_consumption(values);
+  }
+
+
+
+  const std::vector<std::size_t> &
+  BSRMatrix::get_row_start() const
+  {
+    return row_start;
+  }
+
+
+
+  const std::vector<unsigned int> &
+  BSRMatrix::get_columns() const
+  {
+    return columns;
+  }
+
+
+
+  const std::vector<double> &
+  BSRMatrix::get_values() const
+  {
+    return values;
+  }
+
+
+
+  void
+  BSRSmoother::initialize(const BSRMatrix &matrix,
+                          const Type       type,
+                          const double     relaxation)
+  {
+    this->matrix     = &matrix;
+    this->type       = type;
+    this->relaxation = relaxation;
+
+    const unsigned int b         = matrix.get_block_size();
+    const auto        &row_start = matrix.get_row_start();
+    const auto        &columns   = matrix.get_columns();
+    const auto        &values    = matrix.get_values();
+
+    diagonal.resize(matrix.n_block_rows());
+    inverse_diagonal.resize(matrix.n_block_rows() * b * b);
+    FullMatrix<double> block(b, b);
+    for (unsigned int I = 0; I < matrix.n_block_rows(); ++I)
+      {
+        const auto first = columns.begin() + row_start[I];
+        const auto last  = columns.begin() + row_start[I + 1];
+        const auto it    = std::lower_bound(first, last, I);
+        AssertThrow(it != last && *it == I,
+                    ExcMessage("The matrix has no diagonal block in row " +
+                               std::to_string(I) + "."));
+        diagonal[I] = it - columns.begin();
+
+        const double *d = values.data() + diagonal[I] * b * b;
+        for (unsigned int i = 0; i < b; ++i)
+          for (unsigned int j = 0; j < b; ++j)
+            block(i, j) = d[i * b + j];
+        block.gauss_jordan();
+        for (unsigned int i = 0; i < b; ++i)
+          for (unsigned int j = 0; j < b; ++j)
+            inverse_diagonal[I * b * b + i * b + j] = block(i, j);
+      }
+  }
+
+
+
+  void
+  BSRSmoother::sweep(Vector<double>       &dst,
+                     const Vector<double> &src,
+                     const bool            forward) const
+  {
+    const unsigned int b            = matrix->get_block_size();
+    const unsigned int n_block_rows = matrix->n_block_rows();
+    const auto        &row_start    = matrix->get_row_start();
+    const auto        &columns      = matrix->get_columns();
+    const auto        &values       = matrix->get_values();
+
+    std::vector<double> residual(b);
+    for (unsigned int n = 0; n < n_block_rows; ++n)
+      {
+        const unsigned int I = forward ? n : n_block_rows - 1 - n;
+        for (unsigned int i = 0; i < b; ++i)
+          residual[i] = src[I * b + i];
+        for (std::size_t k = row_start[I]; k < row_start[I + 1]; ++k)
+          if (forward ? columns[k] < I : columns[k] > I)
+            add_block_vmult(b,
+                            values.data() + k * b * b,
+                            dst.data() + columns[k] * b,
+                            -1.0,
+                            residual.data());
+        std::fill(dst.data() + I * b, dst.data() + (I + 1) * b, 0.0);
+        add_block_vmult(b,
+                        inverse_diagonal.data() + I * b * b,
+                        residual.data(),
+                        relaxation,
+                        dst.data() + I * b);
+      }
+  }
+
+
+
+  void
+  BSRSmoother::vmult(Vector<double> &dst, const Vector<double> &src) const
+  {
+    Assert(matrix, ExcNotInitialized());
+    const unsigned int b = matrix->get_block_size();
+
+    if (type == Type::jacobi)
+      {
+        dst = 0;
+        for (unsigned int I = 0; I < matrix->n_block_rows(); ++I)
+          add_block_vmult(b,
+                          inverse_diagonal.data() + I * b * b,
+                          src.data() + I * b,
+                          relaxation,
+                          dst.data() + I * b);
+      }
+    else if (type == Type::gauss_seidel)
+      sweep(dst, src, true);
+    else
+      {
+        // Forward sweep, multiplication by the scaled diagonal blocks, and
+        // backward sweep
+        Vector<double> tmp(src.size());
+        sweep(tmp, src, true);
+        Vector<double> scaled(src.size());
+        const auto    &values = matrix->get_values();
+        for (unsigned int I = 0; I < matrix->n_block_rows(); ++I)
+          add_block_vmult(b,
+                          values.data() + diagonal[I] * b * b,
+                          tmp.data() + I * b,
+                          1.0 / relaxation,
+                          scaled.data() + I * b);
+        sweep(dst, scaled, false);
+      }
+  }
+
+
+
+  void
+  BSRSmoother::Tvmult(Vector<double> &dst, const Vector<double> &src) const
+  {
+    Assert(matrix, ExcNotInitialized());
+    AssertThrow(type == Type::jacobi, ExcNotImplemented());
+    const unsigned int b = matrix->get_block_size();
+
+    dst = 0;
+    for (unsigned int I = 0; I < matrix->n_block_rows(); ++I)
+      {
+        const double *block = inverse_diagonal.data() + I * b * b;
+        for (unsigned int i = 0; i < b; ++i)
+          for (unsigned int j = 0; j < b; ++j)
+            dst[I * b + j] += relaxation * block[i * b + j] * src[I * b + i];
+      }
+  }
+
+
+
+  BSRStorage::BSRStorage(const std::string &section_name,
+                         const bool         use_block_storage,
+                         const std::string &smoother,
+                         const double       relaxation)
+    : ParameterAcceptor(section_name)
+    , use_block_storage(use_block_storage)
+    , smoother_type(smoother)
+    , relaxation(relaxation)
+  {
+    add_parameter("Use block storage",
+                  this->use_block_storage,
+                  "Store a copy of the system matrix in block compressed "
+                  "sparse row format, with one block per node, and use it "
+                  "in the Krylov solver. Only available for the deal.II "
+                  "linear algebra.");
+    add_parameter("Smoother",
+                  this->smoother_type,
+                  "Point block smoother used as preconditioner. If none, the "
+                  "preconditioner of the system is used.",
+                  this->prm,
+                  Patterns::Selection(
+                    "none|jacobi|gauss_seidel|symmetric_gauss_seidel"));
+    add_parameter("Relaxation parameter",
+                  this->relaxation,
+                  "Relaxation parameter of the smoother.");
+  }
+
+
+
+  bool
+  BSRStorage::enabled() const
+  {
+    return use_block_storage;
+  }
+
+
+
+  bool
+  BSRStorage::has_smoother() const
+  {
+    return smoother_type != "none";
+  }
+
+
+
+  void
+  BSRStorage::initialize(const SparseMatrix<double> &sparse_matrix,
+                         const unsigned int          block_size)
+  {
+    SolverTelemetry::SetupTimer timer;
+    matrix.initialize(sparse_matrix, block_size);
+
+    const std::size_t stored = matrix.n_blocks() * block_size * block_size;
+    deallog << "BSR storage: " << matrix.n_blocks() << " blocks of size "
+            << block_size << ", " << sparse_matrix.n_nonzero_elements()
+            << " nonzeros in " << stored << " stored entries, memory "
+            << sparse_matrix.memory_consumption() << " -> "
+            << matrix.memory_consumption() << " bytes" << std::endl;
+
+    if (smoother_type == "jacobi")
+      smoother.initialize(matrix, BSRSmoother::Type::jacobi, relaxation);
+    else if (smoother_type == "gauss_seidel")
+      smoother.initialize(matrix, BSRSmoother::Type::gauss_seidel, relaxation);
+    else if (smoother_type == "symmetric_gauss_seidel")
+      smoother.initialize(matrix,
+                          BSRSmoother::Type::symmetric_gauss_seidel,
+                          relaxation);
+  }
+
+
+
+  const BSRMatrix &
+  BSRStorage::get_matrix() const
+  {
+    return matrix;
+  }
+
+
+
+  const BSRSmoother &
+  BSRStorage::get_smoother() const
+  {
+    return smoother;
+  }
+} // namespace ParsedLAC
@@ -0,0 +1,395 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/direct_solver.h"
+
+#include <deal.II/base/logstream.h>
+#include <deal.II/base/mpi.h>
+
+#include <boost/functional/hash.hpp>
+
+using namespace dealii;
+
+namespace ParsedLAC
+{
+  namespace
+  {
+    /**
+     * Range of locally owned rows of a serial matrix.
+     */
+    std::pair<types::global_dof_index, types::global_dof_index>
+    local_rows(const SparseMatrix<double> &matrix)
+    {
+      return {0, matrix.m()};
+    }
+
+    /**
+     * Range of locally owned rows of a distributed matrix.
+     */
+    template <typename MatrixType>
+    std::pair<types::global_dof_index, types::global_dof_index>
+    local_rows(const MatrixType &matrix)
+    {
+      return matrix.local_range();
+    }
+
+    MPI_Comm
+    get_mpi_communicator(const SparseMatrix<double> &)
+    {
+      return MPI_COMM_SELF;
+    }
+
+    template <typename MatrixType>
+    MPI_Comm
+    get_mpi_communicator(const MatrixType &matrix)
+    {
+      return matrix.get_mpi_communicator();
+    }
+
+
+
+    /**
+     * Add the sparsity pattern and the values of the locally owned rows of
+     * @p matrix to the checksums.
+     */
+    template <typename MatrixType>
+    void
+    hash_matrix(const MatrixType &matrix,
+                std::size_t      &pattern,
+                std::size_t      &values)
+    {
+      boost::hash_combine(pattern, matrix.m());
+      boost::hash_combine(pattern, matrix.n());
+
+      const auto rows = local_rows(matrix);
+      for (auto row = rows.first; row < rows.second; ++row)
+        {
+          boost::hash_combine(pattern, row);
+          for (auto entry = matrix.begin(row); entry != matrix.end(row);
+               ++entry)
+            {
+              boost::hash_combine(pattern, entry->column());
+              boost::hash_combine(values, entry->value());
+            }
+        }
+    }
+
+    /**
+     * Same as above, block by block.
+     */
+    template <typename BlockMatrixType>
+    void
+    hash_blocks(const BlockMatrixType &matrix,
+                std::size_t           &pattern,
+                std::size_t           &values)
+    {
+      for (unsigned int i = 0; i < matrix.n_block_rows(); ++i)
+        for (unsigned int j = 0; j < matrix.n_block_cols(); ++j)
+          hash_matrix(matrix.block(i, j), pattern, values);
+    }
+
+    void
+    hash_matrix(const BlockSparseMatrix<double> &matrix,
+                std::size_t                     &pattern,
+                std::size_t                     &values)
+    {
+      hash_blocks(matrix, pattern, values);
+    }
+
+    MPI_Comm
+    get_mpi_communicator(const BlockSparseMatrix<double> &)
+    {
+      return MPI_COMM_SELF;
+    }
+
+#ifdef DEAL_II_WITH_TRILINOS
+    void
+    hash_matrix(const TrilinosWrappers::BlockSparseMatrix &matrix,
+                std::size_t                               &pattern,
+                std::size_t                               &values)
+    {
+      hash_blocks(matrix, pattern, values);
+    }
+
+    MPI_Comm
+    get_mpi_communicator(const TrilinosWrappers::BlockSparseMatrix &matrix)
+    {
+      return matrix.block(0, 0).get_mpi_communicator();
+    }
+#endif
+
+#ifdef DEAL_II_WITH_PETSC
+    void
+    hash_matrix(const PETScWrappers::MPI::BlockSparseMatrix &matrix,
+                std::size_t                                 &pattern,
+                std::size_t                                 &values)
+    {
+      hash_blocks(matrix, pattern, values);
+    }
+
+    MPI_Comm
+    get_mpi_communicator(const PETScWrappers::MPI::BlockSparseMatrix &matrix)
+    {
+      return matrix.block(0, 0).get_mpi_communicator();
+    }
+#endif
+  } // namespace
+
+
+
+  DirectSolver::DirectSolver(const std::string &section_name,
+                             const bool         use_direct_solver,
+                             const bool         reuse_factorization)
+    : ParameterAcceptor(section_name)
+    , use_direct_solver(use_direct_solver)
+    , reuse_factorization(reuse_factorization)
+  {
+    add_parameter("Use direct solver",
+                  this->use_direct_solver,
+                  "Use a sparse direct solver instead of an iterative one.");
+    add_parameter("Reuse factorization",
+                  this->reuse_factorization,
+                  "Keep the factorization if the matrix did not change since "
+                  "the last call.");
+  }
+
+
+
+  bool
+  DirectSolver::enabled() const
+  {
+    return use_direct_solver;
+  }
+
+
+
+  template <typename MatrixType>
+  bool
+  MatrixChecksum::update(const MatrixType &matrix, bool &pattern_changed)
+  {
+    std::size_t pattern = 0;
+    std::size_t values  = 0;
+    hash_matrix(matrix, pattern, values);
+
+    // The decision must be the same on all processes
+    const bool local_pattern_changed =
+      !initialized || pattern != pattern_checksum;
+    const bool local_values_changed =
+      local_pattern_changed || values != values_checksum;
+
+    const auto comm = get_mpi_communicator(matrix);
+    pattern_changed =
+      Utilities::MPI::max(local_pattern_changed ? 1u : 0u, comm) == 1u;
+    const bool values_changed =
+      Utilities::MPI::max(local_values_changed ? 1u : 0u, comm) == 1u;
+
+    pattern_checksum = pattern;
+    values_checksum  = values;
+    initialized      = true;
+    return pattern_changed || values_changed;
+  }
+
+
+
+  template <typename MatrixType>
+  bool
+  MatrixChecksum::update(const MatrixType &matrix)
+  {
+    bool pattern_changed = false;
+    return update(matrix, pattern_changed);
+  }
+
+
+
+  void
+  MatrixChecksum::clear()
+  {
+    initialized = false;
+  }
+
+
+
+  template <typename MatrixType>
+  bool
+  DirectSolver::needs_factorization(const MatrixType &matrix,
+                                    bool             &pattern_changed)
+  {
+    const bool changed = checksum.update(matrix, pattern_changed);
+    pattern_changed    = pattern_changed || !is_factorized;
+    return changed || pattern_changed || !reuse_factorization;
+  }
+
+
+
+  void
+  DirectSolver::initialize(const SparseMatrix<double> &matrix)
+  {
+    bool pattern_changed = false;
+    if (needs_factorization(matrix, pattern_changed))
+      {
+        if (pattern_changed || !umfpack)
+          umfpack = std::make_unique<SparseDirectUMFPACK>();
+        umfpack->initialize(matrix);
+        is_factorized = true;
+        ++factorization_counter;
+      }
+    else
+      deallog << "Reusing direct solver factorization" << std::endl;
+  }
+
+
+
+  void
+  DirectSolver::vmult(Vector<double> &dst, const Vector<double> &src) const
+  {
+    Assert(umfpack, ExcNotInitialized());
+    umfpack->vmult(dst, src);
+  }
+
+
+
+  void
+  DirectSolver::Tvmult(Vector<double> &dst, const Vector<double> &src) const
+  {
+    Assert(umfpack, ExcNotInitialized());
+    umfpack->Tvmult(dst, src);
+  }
+
+
+
+#ifdef DEAL_II_WITH_TRILINOS
+  void
+  DirectSolver::initialize(const TrilinosWrappers::SparseMatrix &matrix)
+  {
+    bool pattern_changed = false;
+    if (needs_factorization(matrix, pattern_changed))
+      {
+        if (pattern_changed || !amesos)
+          amesos = std::make_unique<TrilinosWrappers::SolverDirect>(control);
+        amesos->initialize(matrix);
+        is_factorized = true;
+        ++factorization_counter;
+      }
+    else
+      deallog << "Reusing direct solver factorization" << std::endl;
+  }
+
+
+
+  void
+  DirectSolver::vmult(TrilinosWrappers::MPI::Vector       &dst,
+                      const TrilinosWrappers::MPI::Vector &src) const
+  {
+    Assert(amesos, ExcNotInitialized());
+    amesos->solve(dst, src);
+  }
+
+
+
+  void
+  DirectSolver::Tvmult(TrilinosWrappers::MPI::Vector &,
+                       const TrilinosWrappers::MPI::Vector &) const
+  {
+    AssertThrow(false, ExcNotImplemented());
+  }
+#endif
+
+
+
+#ifdef DEAL_II_WITH_PETSC
+  void
+  DirectSolver::initialize(const PETScWrappers::MPI::SparseMatrix &matrix)
+  {
+    bool pattern_changed = false;
+    if (needs_factorization(matrix, pattern_changed))
+      {
+        // PETSc keeps the symbolic factorization as long as the same solver
+        // object is used, and redoes the numeric one when the matrix changes.
+        if (pattern_changed || !mumps || petsc_matrix != &matrix)
+          mumps = std::make_unique<PETScWrappers::SparseDirectMUMPS>(
+            control, matrix.get_mpi_communicator());
+        is_factorized = true;
+        ++factorization_counter;
+      }
+    else
+      deallog << "Reusing direct solver factorization" << std::endl;
+    petsc_matrix = &matrix;
+  }
+
+
+
+  void
+  DirectSolver::vmult(PETScWrappers::MPI::Vector       &dst,
+                      const PETScWrappers::MPI::Vector &src) const
+  {
+    Assert(mumps && petsc_matrix, ExcNotInitialized());
+    mumps->solve(*petsc_matrix, dst, src);
+  }
+
+
+
+  void
+  DirectSolver::Tvmult(PETScWrappers::MPI::Vector &,
+                       const PETScWrappers::MPI::Vector &) const
+  {
+    AssertThrow(false, ExcNotImplemented());
+  }
+#endif
+
+
+
+  void
+  DirectSolver::clear()
+  {
+    umfpack.reset();
+#ifdef DEAL_II_WITH_TRILINOS
+    amesos.reset();
+#endif
+#ifdef DEAL_II_WITH_PETSC
+    mumps.reset();
+    petsc_matrix = nullptr;
+#endif
+    is_factorized = false;
+  }
+
+
+
+  unsigned int
+  DirectSolver::n_factorizations() const
+  {
+    return factorization_counter;
+  }
+
+
+
+  template bool
+  MatrixChecksum::update(const SparseMatrix<double> &);
+  template bool
+  MatrixChecksum::update(const BlockSparseMatrix<double> &);
+
+#ifdef DEAL_II_WITH_TRILINOS
+  template bool
+  MatrixChecksum::update(const TrilinosWrappers::SparseMatrix &);
+  template bool
+  MatrixChecksum::update(const TrilinosWrappers::BlockSparseMatrix &);
+#endif
+
+#ifdef DEAL_II_WITH_PETSC
+  template bool
+  MatrixChecksum::update(const PETScWrappers::MPI::SparseMatrix &);
+  template bool
+  MatrixChecksum::update(const PETScWrappers::MPI::BlockSparseMatrix &);
+#endif
+} // namespace ParsedLAC
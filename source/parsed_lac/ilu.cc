@@ -16,6 +16,7 @@
 
 
 #include <parsed_lac/ilu.h>
+#include <parsed_lac/solver_telemetry.h>
 
 #ifdef DEAL_II_WITH_TRILINOS
 
@@ -56,6 +57,7 @@ namespace ParsedLAC
   void
   ILUPreconditioner::initialize_preconditioner(const Matrix &matrix)
   {
+    SolverTelemetry::SetupTimer timer;
     TrilinosWrappers::PreconditionILU::AdditionalData data;
 
     data.ilu_fill = ilu_fill;
@@ -44,10 +44,11 @@ namespace ParsedLAC
     add_parameter("Solver name",
                   this->solver_name,
                   "Name of the solver to use. One of cg,bicgstab,gmres,fgmres,"
-                  "minres,qmrs, or richardson.",
+                  "minres,qmrs,richardson,pipecg,sstepcg,srgmres, or dcg.",
                   dealii::ParameterAcceptor::prm,
                   dealii::Patterns::Selection("cg|bicgstab|gmres|fgmres|"
-                                              "minres|qmrs|richardson"));
+                                              "minres|qmrs|richardson|"
+                                              "pipecg|sstepcg|srgmres|dcg"));
     add_parameter("Solver control type", this->control_type);
     add_parameter("Maximum iterations", this->max_iterations);
     add_parameter("Consecutive iterations", this->consecutive_iterations);
@@ -55,6 +56,36 @@ namespace ParsedLAC
     add_parameter("Relative tolerance", this->reduction);
     add_parameter("Log history", this->log_history);
     add_parameter("Log result", this->log_result);
+    add_parameter("S-step size",
+                  this->s_step_size,
+                  "Number of iterations per global reduction of the sstepcg "
+                  "solver.",
+                  dealii::ParameterAcceptor::prm,
+                  dealii::Patterns::Integer(1));
+    add_parameter("Restart length",
+                  this->restart_length,
+                  "Maximum dimension of the Krylov space of the gmres, "
+                  "fgmres, and srgmres solvers. With deal.II older than "
+                  "9.6, the gmres solver uses two of these vectors as "
+                  "auxiliary vectors.",
+                  dealii::ParameterAcceptor::prm,
+                  dealii::Patterns::Integer(1));
+    add_parameter("Deflation dimension",
+                  this->deflation_dimension,
+                  "Maximum number of vectors of the deflation space recycled "
+                  "by the dcg solver.");
+    add_parameter("Deflation refresh",
+                  this->deflation_refresh,
+                  "Number of solves between two updates of the deflation "
+                  "space of the dcg solver. If zero, the space is computed "
+                  "only once.");
+    add_parameter("Deflation constant operator",
+                  this->deflation_constant_operator,
+                  "Set to true if the dcg solver is always used with the "
+                  "same operator. Otherwise, every solve multiplies all the "
+                  "deflation vectors by the operator, which is expensive if "
+                  "each product is itself an inner solve, e.g., for a Schur "
+                  "complement.");
   }
 
   std::string
@@ -15,6 +15,8 @@
 
 #include "parsed_lac/jacobi.h"
 
+#include "parsed_lac/solver_telemetry.h"
+
 #ifdef DEAL_II_WITH_TRILINOS
 
 using namespace dealii;
@@ -60,6 +62,7 @@ namespace ParsedLAC
   void
   JacobiPreconditioner::initialize_preconditioner(const Matrix &matrix)
   {
+    SolverTelemetry::SetupTimer timer;
     TrilinosWrappers::PreconditionJacobi::AdditionalData data;
 
     data.omega        = omega;
@@ -0,0 +1,194 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/mixed_precision.h"
+
+#include "parsed_lac/solver_telemetry.h"
+
+using namespace dealii;
+
+namespace ParsedLAC
+{
+  MixedPrecisionPreconditioner::MixedPrecisionPreconditioner(
+    const std::string &section_name,
+    const bool         use_single_precision,
+    const std::string &type,
+    const double       relaxation)
+    : ParameterAcceptor(section_name)
+    , use_single_precision(use_single_precision)
+    , type(type)
+    , relaxation(relaxation)
+  {
+    add_parameter("Use single precision",
+                  this->use_single_precision,
+                  "Build and apply the preconditioner in single precision. "
+                  "Only available for the serial deal.II linear algebra.");
+    add_parameter("Type",
+                  this->type,
+                  "Type of single precision preconditioner.",
+                  this->prm,
+                  Patterns::Selection("jacobi|ssor|ilu"));
+    add_parameter("Relaxation parameter",
+                  this->relaxation,
+                  "Relaxation parameter of the jacobi and ssor "
+                  "preconditioners.");
+    add_parameter("Strengthen diagonal",
+                  strengthen_diagonal,
+                  "Strengthen the diagonal of the ILU decomposition.");
+    add_parameter("Extra off diagonals",
+                  extra_off_diagonals,
+                  "Extra off diagonals of the ILU decomposition.");
+  }
+
+
+
+  bool
+  MixedPrecisionPreconditioner::enabled() const
+  {
+    return use_single_precision;
+  }
+
+
+
+  void
+  MixedPrecisionPreconditioner::initialize(
+    const SparseMatrix<double> &double_matrix)
+  {
+    SolverTelemetry::SetupTimer timer;
+    // Clear the preconditioners before changing the matrix they refer to
+    jacobi.clear();
+    ssor.clear();
+    ilu.clear();
+
+    matrix.reinit(double_matrix.get_sparsity_pattern());
+    matrix.add(1.0f, double_matrix);
+
+    if (type == "jacobi")
+      jacobi.initialize(
+        matrix,
+        PreconditionJacobi<SparseMatrix<float>>::AdditionalData(relaxation));
+    else if (type == "ssor")
+      ssor.initialize(
+        matrix,
+        PreconditionSSOR<SparseMatrix<float>>::AdditionalData(relaxation));
+    else if (type == "ilu")
+      ilu.initialize(matrix,
+                     SparseILU<float>::AdditionalData(strengthen_diagonal,
+                                                      extra_off_diagonals));
+    else
+      Assert(false, ExcInternalError());
+
+    src_float.reinit(matrix.n());
+    dst_float.reinit(matrix.m());
+  }
+
+
+
+  void
+  MixedPrecisionPreconditioner::vmult(Vector<double>       &dst,
+                                      const Vector<double> &src) const
+  {
+    src_float = src;
+    if (type == "jacobi")
+      jacobi.vmult(dst_float, src_float);
+    else if (type == "ssor")
+      ssor.vmult(dst_float, src_float);
+    else
+      ilu.vmult(dst_float, src_float);
+    dst = dst_float;
+  }
+
+
+
+  void
+  MixedPrecisionPreconditioner::Tvmult(Vector<double>       &dst,
+                                       const Vector<double> &src) const
+  {
+    src_float = src;
+    if (type == "jacobi")
+      jacobi.Tvmult(dst_float, src_float);
+    else if (type == "ssor")
+      ssor.Tvmult(dst_float, src_float);
+    else
+      ilu.Tvmult(dst_float, src_float);
+    dst = dst_float;
+  }
+
+
+
+#ifdef DEAL_II_WITH_TRILINOS
+  void
+  MixedPrecisionPreconditioner::initialize(
+    const TrilinosWrappers::SparseMatrix &)
+  {
+    AssertThrow(false,
+                ExcMessage("Single precision preconditioners are only "
+                           "available for the deal.II linear algebra."));
+  }
+
+
+
+  void
+  MixedPrecisionPreconditioner::vmult(
+    TrilinosWrappers::MPI::Vector &,
+    const TrilinosWrappers::MPI::Vector &) const
+  {
+    AssertThrow(false, ExcNotImplemented());
+  }
+
+
+
+  void
+  MixedPrecisionPreconditioner::Tvmult(
+    TrilinosWrappers::MPI::Vector &,
+    const TrilinosWrappers::MPI::Vector &) const
+  {
+    AssertThrow(false, ExcNotImplemented());
+  }
+#endif
+
+
+
+#ifdef DEAL_II_WITH_PETSC
+  void
+  MixedPrecisionPreconditioner::initialize(
+    const PETScWrappers::MPI::SparseMatrix &)
+  {
+    AssertThrow(false,
+                ExcMessage("Single precision preconditioners are only "
+                           "available for the deal.II linear algebra."));
+  }
+
+
+
+  void
+  MixedPrecisionPreconditioner::vmult(
+    PETScWrappers::MPI::Vector &,
+    const PETScWrappers::MPI::Vector &) const
+  {
+    AssertThrow(false, ExcNotImplemented());
+  }
+
+
+
+  void
+  MixedPrecisionPreconditioner::Tvmult(
+    PETScWrappers::MPI::Vector &,
+    const PETScWrappers::MPI::Vector &) const
+  {
+    AssertThrow(false, ExcNotImplemented());
+  }
+#endif
+} // namespace ParsedLAC
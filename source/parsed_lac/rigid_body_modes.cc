@@ -0,0 +1,113 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/rigid_body_modes.h"
+
+#include <deal.II/base/index_set.h>
+#include <deal.II/base/point.h>
+
+#include <deal.II/dofs/dof_tools.h>
+
+#include <map>
+
+using namespace dealii;
+
+namespace ParsedLAC
+{
+  template <int dim, int spacedim>
+  std::vector<std::vector<double>>
+  rigid_body_modes(const Mapping<dim, spacedim>    &mapping,
+                   const DoFHandler<dim, spacedim> &dof_handler,
+                   const ComponentMask             &component_mask)
+  {
+    const unsigned int n_components = dof_handler.get_fe().n_components();
+    AssertThrow(component_mask.n_selected_components(n_components) ==
+                  spacedim,
+                ExcMessage("The component mask must select exactly spacedim "
+                           "components."));
+
+    std::vector<unsigned int> components;
+    for (unsigned int c = 0; c < n_components; ++c)
+      if (component_mask[c])
+        components.push_back(c);
+
+    std::map<types::global_dof_index, Point<spacedim>> support_points;
+    DoFTools::map_dofs_to_support_points(mapping,
+                                         dof_handler,
+                                         support_points,
+                                         component_mask);
+
+    const IndexSet    &owned   = dof_handler.locally_owned_dofs();
+    const unsigned int n_modes = spacedim + spacedim * (spacedim - 1) / 2;
+
+    std::vector<std::vector<double>> modes(
+      n_modes, std::vector<double>(owned.n_elements(), 0.0));
+
+    for (unsigned int d = 0; d < spacedim; ++d)
+      {
+        ComponentMask mask(n_components, false);
+        mask.set(components[d], true);
+        for (const auto i : DoFTools::extract_dofs(dof_handler, mask))
+          {
+            const auto  local = owned.index_within_set(i);
+            const auto &p     = support_points.at(i);
+
+            modes[d][local] = 1.0;
+            // The rotation in the plane (a, b) moves component a by -x_b,
+            // and component b by x_a
+            unsigned int mode = spacedim;
+            for (unsigned int a = 0; a < spacedim; ++a)
+              for (unsigned int b = a + 1; b < spacedim; ++b, ++mode)
+                if (d == a)
+                  modes[mode][local] = -p[b];
+                else if (d == b)
+                  modes[mode][local] = p[a];
+          }
+      }
+    return modes;
+  }
+
+
+
+  template std::vector<std::vector<double>>
+  rigid_body_modes(const Mapping<1, 1> &,
+                   const DoFHandler<1, 1> &,
+                   const ComponentMask &);
+
+  template std::vector<std::vector<double>>
+  rigid_body_modes(const Mapping<1, 2> &,
+                   const DoFHandler<1, 2> &,
+                   const ComponentMask &);
+
+  template std::vector<std::vector<double>>
+  rigid_body_modes(const Mapping<1, 3> &,
+                   const DoFHandler<1, 3> &,
+                   const ComponentMask &);
+
+  template std::vector<std::vector<double>>
+  rigid_body_modes(const Mapping<2, 2> &,
+                   const DoFHandler<2, 2> &,
+                   const ComponentMask &);
+
+  template std::vector<std::vector<double>>
+  rigid_body_modes(const Mapping<2, 3> &,
+                   const DoFHandler<2, 3> &,
+                   const ComponentMask &);
+
+  template std::vector<std::vector<double>>
+  rigid_body_modes(const Mapping<3, 3> &,
+                   const DoFHandler<3, 3> &,
+                   const ComponentMask &);
+} // namespace ParsedLAC
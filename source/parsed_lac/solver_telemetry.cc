@@ -0,0 +1,421 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_lac/solver_telemetry.h"
+
+#include <deal.II/base/utilities.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+using namespace dealii;
+
+namespace ParsedLAC
+{
+  namespace
+  {
+    /**
+     * The global state of the registry.
+     */
+    struct Registry
+    {
+      bool                     enabled = false;
+      std::vector<SolveRecord> records;
+      unsigned int             n_reductions       = 0;
+      double                   pending_setup_time = 0;
+      std::mutex               mutex;
+    };
+
+    Registry &
+    registry()
+    {
+      static Registry instance;
+      return instance;
+    }
+
+    /**
+     * Solvers that count their reductions exactly.
+     */
+    bool
+    counts_reductions(const std::string &solver_name)
+    {
+      return solver_name == "pipecg" || solver_name == "sstepcg" ||
+             solver_name == "srgmres" || solver_name == "dcg" ||
+             solver_name == "block cg";
+    }
+
+    /**
+     * Estimate of the number of global reductions of the solvers of deal.II,
+     * from the dot products and norms they compute at every iteration, plus
+     * the norm of the initial residual. For GMRES, the estimate assumes one
+     * reduction per basis vector in the orthogonalization, as in modified
+     * Gram-Schmidt, and a restart every @p restart_length iterations. This is
+     * an upper bound for the versions of deal.II that orthogonalize with
+     * classical Gram-Schmidt.
+     */
+    unsigned int
+    estimate_reductions(const std::string &solver_name,
+                        const unsigned int n_iterations,
+                        const unsigned int restart_length)
+    {
+      if (solver_name == "gmres" || solver_name == "fgmres")
+        {
+          const unsigned int restart      = std::max(restart_length, 1u);
+          unsigned int       n_reductions = 1;
+          for (unsigned int i = 0; i < n_iterations; ++i)
+            n_reductions += i % restart + 2;
+          return n_reductions;
+        }
+      unsigned int per_iteration = 1;
+      if (solver_name == "cg" || solver_name == "minres" ||
+          solver_name == "qmrs")
+        per_iteration = 3;
+      else if (solver_name == "bicgstab")
+        per_iteration = 5;
+      return 1 + per_iteration * n_iterations;
+    }
+
+    /**
+     * Write a double in json format.
+     */
+    void
+    write_json_number(std::ostream &out, const double value)
+    {
+      if (std::isfinite(value))
+        out << value;
+      else
+        out << "null";
+    }
+
+    /**
+     * Write a string in json format.
+     */
+    void
+    write_json_string(std::ostream &out, const std::string &value)
+    {
+      out << '"';
+      for (const char c : value)
+        {
+          if (c == '"' || c == '\\')
+            out << '\\';
+          out << c;
+        }
+      out << '"';
+    }
+  } // namespace
+
+
+
+  SolverTelemetry::SolverTelemetry(const std::string &section_name,
+                                   const std::string &base_name,
+                                   const std::string &format)
+    : ParameterAcceptor(section_name)
+    , base_name(base_name)
+    , format(format)
+  {
+    add_parameter("Output base name",
+                  this->base_name,
+                  "Prefix of the telemetry files. If empty, no telemetry is "
+                  "collected.");
+    add_parameter("Output format",
+                  this->format,
+                  "Format of the telemetry files.",
+                  this->prm,
+                  Patterns::Selection("csv|json"));
+
+    this->parse_parameters_call_back.connect([&]() {
+      if (this->base_name != "")
+        set_enabled(true);
+    });
+  }
+
+
+
+  void
+  SolverTelemetry::set_append(const bool append)
+  {
+    this->append = append;
+  }
+
+
+
+  void
+  SolverTelemetry::write(const unsigned int stage, const MPI_Comm &comm) const
+  {
+    if (base_name != "" && Utilities::MPI::this_mpi_process(comm) == 0)
+      {
+        const auto &records = get_records();
+        if (format == "csv")
+          {
+            const std::string fname = base_name + ".csv";
+            if (append && !csv_header_written)
+              csv_header_written = std::filesystem::exists(fname) &&
+                                   std::filesystem::file_size(fname) > 0;
+            const auto    mode = csv_header_written || append ? std::ios::app :
+                                                                std::ios::out;
+            std::ofstream out(fname, mode);
+            AssertThrow(out, ExcFileNotOpen(fname));
+            write_csv(out, stage, records, !csv_header_written);
+            csv_header_written = true;
+          }
+        else
+          {
+            const std::string fname =
+              base_name + "-" + Utilities::int_to_string(stage) + ".json";
+            std::ofstream out(fname);
+            AssertThrow(out, ExcFileNotOpen(fname));
+            write_json(out, stage, records);
+          }
+      }
+    clear();
+  }
+
+
+
+  void
+  SolverTelemetry::write_csv(std::ostream                   &out,
+                             const unsigned int              stage,
+                             const std::vector<SolveRecord> &records,
+                             const bool                      header)
+  {
+    if (header)
+      out << "stage,label,solver,iterations,converged,initial_residual,"
+          << "final_residual,solve_time,preconditioner_setup_time,"
+          << "preconditioner_apply_time,preconditioner_applications,"
+          << "matvecs,reductions,reductions_estimated,bytes_moved"
+          << std::endl;
+    out << std::setprecision(8);
+    for (const auto &r : records)
+      {
+        const double initial_residual =
+          r.residual_history.empty() ? 0.0 : r.residual_history.front();
+        const double final_residual =
+          r.residual_history.empty() ? 0.0 : r.residual_history.back();
+        out << stage << "," << r.label << "," << r.solver_name << ","
+            << r.n_iterations << "," << r.converged << ","
+            << initial_residual << "," << final_residual << ","
+            << r.solve_time << ","
+            << r.preconditioner_setup_time << ","
+            << r.preconditioner_apply_time << ","
+            << r.n_preconditioner_applications << "," << r.n_matvecs << ","
+            << r.n_reductions << "," << r.reductions_estimated << ","
+            << r.bytes_moved << std::endl;
+      }
+  }
+
+
+
+  void
+  SolverTelemetry::write_json(std::ostream                   &out,
+                              const unsigned int              stage,
+                              const std::vector<SolveRecord> &records)
+  {
+    out << std::setprecision(8);
+    out << "{\n  \"stage\": " << stage << ",\n  \"solves\": [";
+    for (unsigned int i = 0; i < records.size(); ++i)
+      {
+        const auto &r = records[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"label\": ";
+        write_json_string(out, r.label);
+        out << ", \"solver\": ";
+        write_json_string(out, r.solver_name);
+        out << ", \"iterations\": " << r.n_iterations
+            << ", \"converged\": " << (r.converged ? "true" : "false")
+            << ", \"solve_time\": ";
+        write_json_number(out, r.solve_time);
+        out << ", \"preconditioner_setup_time\": ";
+        write_json_number(out, r.preconditioner_setup_time);
+        out << ", \"preconditioner_apply_time\": ";
+        write_json_number(out, r.preconditioner_apply_time);
+        out << ", \"preconditioner_applications\": "
+            << r.n_preconditioner_applications
+            << ", \"matvecs\": " << r.n_matvecs
+            << ", \"reductions\": " << r.n_reductions
+            << ", \"reductions_estimated\": "
+            << (r.reductions_estimated ? "true" : "false")
+            << ", \"bytes_moved\": ";
+        write_json_number(out, r.bytes_moved);
+        out << ", \"residual_history\": [";
+        for (unsigned int j = 0; j < r.residual_history.size(); ++j)
+          {
+            if (j > 0)
+              out << ", ";
+            write_json_number(out, r.residual_history[j]);
+          }
+        out << "]}";
+      }
+    out << "\n  ]\n}" << std::endl;
+  }
+
+
+
+  bool
+  SolverTelemetry::enabled()
+  {
+    return registry().enabled;
+  }
+
+
+
+  void
+  SolverTelemetry::set_enabled(const bool enable)
+  {
+    registry().enabled = enable;
+  }
+
+
+
+  void
+  SolverTelemetry::add_record(const SolveRecord &record)
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().records.push_back(record);
+  }
+
+
+
+  const std::vector<SolveRecord> &
+  SolverTelemetry::get_records()
+  {
+    return registry().records;
+  }
+
+
+
+  void
+  SolverTelemetry::clear()
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().records.clear();
+    registry().pending_setup_time = 0;
+  }
+
+
+
+  void
+  SolverTelemetry::count_reduction()
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    ++registry().n_reductions;
+  }
+
+
+
+  unsigned int
+  SolverTelemetry::n_reductions()
+  {
+    return registry().n_reductions;
+  }
+
+
+
+  void
+  SolverTelemetry::add_preconditioner_setup_time(const double seconds)
+  {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().pending_setup_time += seconds;
+  }
+
+
+
+  SolverTelemetry::SetupTimer::SetupTimer()
+  {}
+
+
+
+  SolverTelemetry::SetupTimer::~SetupTimer()
+  {
+    if (SolverTelemetry::enabled())
+      SolverTelemetry::add_preconditioner_setup_time(timer.wall_time());
+  }
+
+
+
+  SolverTelemetry::Probe::Probe(const std::string &label,
+                                const std::string &solver_name,
+                                SolverControl     &control,
+                                const unsigned int restart_length)
+    : counters(std::make_shared<Counters>())
+    , label(label)
+    , solver_name(solver_name)
+    , control(control)
+    , restart_length(restart_length)
+    , reductions_at_start(SolverTelemetry::n_reductions())
+  {
+    control.enable_history_data();
+  }
+
+
+
+  void
+  SolverTelemetry::Probe::finish(const unsigned int n_local_dofs,
+                                 const std::size_t  matrix_memory)
+  {
+    SolveRecord record;
+    record.label        = label;
+    record.solver_name  = solver_name;
+    record.n_iterations = control.last_step();
+    record.converged    = control.last_check() == SolverControl::success;
+    record.solve_time   = timer.wall_time();
+
+    // The history may contain the residuals of previous solves with the same
+    // control: only keep the ones of this solve.
+    const auto        &history = control.get_history_data();
+    const std::size_t n_values =
+      std::min<std::size_t>(history.size(), record.n_iterations + 1);
+    record.residual_history.assign(history.end() - n_values, history.end());
+
+    record.n_matvecs = counters->n_matvecs;
+    record.n_preconditioner_applications =
+      counters->n_preconditioner_applications;
+    record.preconditioner_apply_time = counters->preconditioner_apply_time;
+
+    if (counts_reductions(solver_name))
+      record.n_reductions =
+        SolverTelemetry::n_reductions() - reductions_at_start;
+    else
+      {
+        record.n_reductions =
+          estimate_reductions(solver_name, record.n_iterations, restart_length);
+        record.reductions_estimated = true;
+      }
+
+    // The reductions of this solve are in its record: remove them from the
+    // counter, so that an enclosing solve (e.g., the outer solve of a Schur
+    // complement) does not count them again.
+    {
+      std::lock_guard<std::mutex> lock(registry().mutex);
+      registry().n_reductions = reductions_at_start;
+    }
+
+    // Every product reads the source vector and writes the destination one.
+    // The matrix is read once per product.
+    const double vector_bytes = 2.0 * n_local_dofs * sizeof(double);
+    record.bytes_moved =
+      (vector_bytes + matrix_memory) * record.n_matvecs +
+      vector_bytes * record.n_preconditioner_applications;
+
+    {
+      std::lock_guard<std::mutex> lock(registry().mutex);
+      record.preconditioner_setup_time = registry().pending_setup_time;
+      registry().pending_setup_time    = 0;
+    }
+    SolverTelemetry::add_record(record);
+  }
+} // namespace ParsedLAC
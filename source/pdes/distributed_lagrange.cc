@@ -16,6 +16,9 @@
 #include "pdes/distributed_lagrange.h"
 
 #include <deal.II/base/logstream.h>
+#include <deal.II/base/work_stream.h>
+
+#include <deal.II/grid/filtered_iterator.h>
 
 #include <deal.II/lac/linear_operator_tools.h>
 
@@ -116,41 +119,45 @@ namespace PDEs
       typename LinearProblem<spacedim, spacedim, LacType>::CopyData copy(
         space.finite_element().n_dofs_per_cell());
 
-      for (const auto &cell : space.dof_handler.active_cell_iterators())
-        if (cell->is_locally_owned())
+      auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
+        auto &cell_matrix     = copy.matrices[0];
+        auto &cell_rhs        = copy.vectors[0];
+        cell_matrix           = 0;
+        cell_rhs              = 0;
+        const auto &fe_values = scratch.reinit(cell);
+        cell->get_dof_indices(copy.local_dof_indices[0]);
+
+        for (const unsigned int q_index : fe_values.quadrature_point_indices())
           {
-            auto &cell_matrix     = copy.matrices[0];
-            auto &cell_rhs        = copy.vectors[0];
-            cell_matrix           = 0;
-            cell_rhs              = 0;
-            const auto &fe_values = scratch.reinit(cell);
-            cell->get_dof_indices(copy.local_dof_indices[0]);
-
-            for (const unsigned int q_index :
-                 fe_values.quadrature_point_indices())
+            for (const unsigned int i : fe_values.dof_indices())
               {
-                for (const unsigned int i : fe_values.dof_indices())
-                  {
-                    for (const unsigned int j : fe_values.dof_indices())
-                      cell_matrix(i, j) +=
-                        (fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
-                         fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
-                         fe_values.JxW(q_index));           // dx
-                    cell_rhs(i) +=
-                      (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                       space.forcing_term.value(
-                         fe_values.quadrature_point(q_index)) * // f(x_q)
-                       fe_values.JxW(q_index));                 // dx
-                  }
+                for (const unsigned int j : fe_values.dof_indices())
+                  cell_matrix(i, j) +=
+                    (fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
+                     fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
+                     fe_values.JxW(q_index));           // dx
+                cell_rhs(i) +=
+                  (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                   space.forcing_term.value(
+                     fe_values.quadrature_point(q_index)) * // f(x_q)
+                   fe_values.JxW(q_index));                 // dx
               }
-
-            space.constraints.distribute_local_to_global(
-              copy.matrices[0],
-              copy.vectors[0],
-              copy.local_dof_indices[0],
-              space.matrix,
-              space.rhs);
           }
+      };
+
+      auto copier = [&](const auto &copy) { space.copy_one_cell(copy); };
+
+      using CellFilter = FilteredIterator<
+        typename DoFHandler<spacedim, spacedim>::active_cell_iterator>;
+
+      WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                                 space.dof_handler.begin_active()),
+                      CellFilter(IteratorFilters::LocallyOwnedCell(),
+                                 space.dof_handler.end()),
+                      worker,
+                      copier,
+                      scratch,
+                      copy);
 
       space.matrix.compress(VectorOperation::add);
       space.rhs.compress(VectorOperation::add);
@@ -173,41 +180,45 @@ namespace PDEs
       typename LinearProblem<dim, spacedim, LacType>::CopyData copy(
         embedded.finite_element().n_dofs_per_cell());
 
-      for (const auto &cell : embedded.dof_handler.active_cell_iterators())
-        if (cell->is_locally_owned())
+      auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
+        auto &cell_matrix     = copy.matrices[0];
+        auto &cell_rhs        = copy.vectors[0];
+        cell_matrix           = 0;
+        cell_rhs              = 0;
+        const auto &fe_values = scratch.reinit(cell);
+        cell->get_dof_indices(copy.local_dof_indices[0]);
+
+        for (const unsigned int q_index : fe_values.quadrature_point_indices())
           {
-            auto &cell_matrix     = copy.matrices[0];
-            auto &cell_rhs        = copy.vectors[0];
-            cell_matrix           = 0;
-            cell_rhs              = 0;
-            const auto &fe_values = scratch.reinit(cell);
-            cell->get_dof_indices(copy.local_dof_indices[0]);
-
-            for (const unsigned int q_index :
-                 fe_values.quadrature_point_indices())
+            for (const unsigned int i : fe_values.dof_indices())
               {
-                for (const unsigned int i : fe_values.dof_indices())
-                  {
-                    for (const unsigned int j : fe_values.dof_indices())
-                      cell_matrix(i, j) +=
-                        (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                         fe_values.shape_value(j, q_index) * // phi_j(x_q)
-                         fe_values.JxW(q_index));            // dx
-                    cell_rhs(i) +=
-                      (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                       embedded.forcing_term.value(
-                         fe_values.quadrature_point(q_index)) * // f(x_q)
-                       fe_values.JxW(q_index));                 // dx
-                  }
+                for (const unsigned int j : fe_values.dof_indices())
+                  cell_matrix(i, j) +=
+                    (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                     fe_values.shape_value(j, q_index) * // phi_j(x_q)
+                     fe_values.JxW(q_index));            // dx
+                cell_rhs(i) +=
+                  (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                   embedded.forcing_term.value(
+                     fe_values.quadrature_point(q_index)) * // f(x_q)
+                   fe_values.JxW(q_index));                 // dx
               }
-
-            embedded.constraints.distribute_local_to_global(
-              copy.matrices[0],
-              copy.vectors[0],
-              copy.local_dof_indices[0],
-              embedded.matrix,
-              embedded.rhs);
           }
+      };
+
+      auto copier = [&](const auto &copy) { embedded.copy_one_cell(copy); };
+
+      using CellFilter = FilteredIterator<
+        typename DoFHandler<dim, spacedim>::active_cell_iterator>;
+
+      WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                                 embedded.dof_handler.begin_active()),
+                      CellFilter(IteratorFilters::LocallyOwnedCell(),
+                                 embedded.dof_handler.end()),
+                      worker,
+                      copier,
+                      scratch,
+                      copy);
 
       embedded.matrix.compress(VectorOperation::add);
       embedded.rhs.compress(VectorOperation::add);
@@ -239,8 +250,16 @@ namespace PDEs
     auto M     = linear_operator<Vec>(embedded.matrix.block(0, 0));
     auto M_inv = M;
 
-    space.preconditioner.initialize(space.matrix.block(0, 0));
-    A_inv = space.inverse_operator(A, space.preconditioner);
+    if (space.direct_solver.enabled())
+      {
+        space.direct_solver.initialize(space.matrix.block(0, 0));
+        A_inv = linear_operator<Vec>(A, space.direct_solver);
+      }
+    else
+      {
+        space.preconditioner.initialize(space.matrix.block(0, 0));
+        A_inv = space.inverse_operator(A, space.preconditioner);
+      }
 
     embedded.preconditioner.initialize(embedded.matrix.block(0, 0));
     auto M_prec = linear_operator<Vec>(M, embedded.preconditioner);
@@ -283,6 +302,8 @@ namespace PDEs
   DistributedLagrange<dim, spacedim, LacType>::run()
   {
     deallog.depth_console(space.verbosity_level);
+    // Set the number of threads used by the assembly loops
+    space.print_system_info();
     generate_grids();
     for (const auto &cycle : space.grid_refinement.get_refinement_cycles())
       {
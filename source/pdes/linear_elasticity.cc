@@ -18,6 +18,7 @@
 #include "deal.II/meshworker/mesh_loop.h"
 
 #include "parsed_tools/components.h"
+#include "pdes/shape_cache.h"
 
 using namespace dealii;
 
@@ -57,38 +58,41 @@ namespace PDEs
     cell->get_dof_indices(copy.local_dof_indices[0]);
 
     const auto &fe_values = scratch.reinit(cell);
+    const auto &shapes    = reinit_shape_cache(scratch, displacement);
+    const auto &dofs      = shapes.get_dofs();
     cell_matrix           = 0;
     cell_rhs              = 0;
 
     for (const unsigned int q_index : fe_values.quadrature_point_indices())
       {
-        for (const unsigned int i : fe_values.dof_indices())
-          {
-            const auto  x = fe_values.quadrature_point(q_index);
-            const auto &eps_v =
-              fe_values[displacement].symmetric_gradient(i, q_index);
-            const auto &div_v = fe_values[displacement].divergence(i, q_index);
-
-            for (const unsigned int j : fe_values.dof_indices())
-              {
-                const auto &eps_u =
-                  fe_values[displacement].symmetric_gradient(j, q_index);
-                const auto &div_u =
-                  fe_values[displacement].divergence(j, q_index);
-                cell_matrix(i, j) += (2 * mu.value(x) * eps_v * eps_u +
-                                      lambda.value(x) * div_v * div_u) *
-                                     fe_values.JxW(q_index); // dx
-              }
+        const auto   x        = fe_values.quadrature_point(q_index);
+        const double two_mu   = 2 * mu.value(x);
+        const double lambda_x = lambda.value(x);
+        const double JxW      = fe_values.JxW(q_index);
 
-            cell_rhs(i) +=
-              (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-               this->forcing_term.value(x,
-                                        this->finite_element()
-                                          .system_to_component_index(i)
-                                          .first) * // f(x_q)
-               fe_values.JxW(q_index));             // dx
+        // The bilinear form is symmetric: only assemble the lower triangle
+        for (unsigned int k = 0; k < shapes.n_dofs(); ++k)
+          {
+            const auto  &eps_v = shapes.symmetric_gradient(k, q_index);
+            const double div_v = shapes.divergence(k, q_index);
+
+            for (unsigned int l = 0; l <= k; ++l)
+              cell_matrix(dofs[k], dofs[l]) +=
+                (two_mu * eps_v * shapes.symmetric_gradient(l, q_index) +
+                 lambda_x * div_v * shapes.divergence(l, q_index)) *
+                JxW; // dx
           }
+
+        for (const unsigned int i : fe_values.dof_indices())
+          cell_rhs(i) +=
+            (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+             this->forcing_term.value(x,
+                                      this->finite_element()
+                                        .system_to_component_index(i)
+                                        .first) * // f(x_q)
+             JxW);                                // dx
       }
+    mirror_lower_triangle(cell_matrix);
   }
 
 
@@ -98,29 +102,133 @@ namespace PDEs
   LinearElasticity<dim, spacedim, LacType>::solve()
   {
     TimerOutput::Scope timer_section(this->timer, "solve");
-    const auto A = linear_operator<VectorType>(this->matrix.block(0, 0));
-    this->preconditioner.initialize(this->matrix.block(0, 0));
-    const auto Ainv         = this->inverse_operator(A, this->preconditioner);
-    this->solution.block(0) = Ainv * this->rhs.block(0);
+    if (this->direct_solver.enabled())
+      {
+        this->direct_solver.initialize(this->matrix.block(0, 0));
+        this->direct_solver.vmult(this->solution.block(0), this->rhs.block(0));
+      }
+    else
+      {
+        const auto A = linear_operator<VectorType>(this->matrix.block(0, 0));
+        auto &single_precision = this->single_precision_preconditioner;
+        auto &block_storage    = this->block_storage;
+        // The solution vector may contain an initial guess (see
+        // run_nested_iteration())
+        if (block_storage.enabled())
+          {
+            if constexpr (std::is_same<LacType, LAC::LAdealii>::value)
+              {
+                // One block per node: the spacedim components of the
+                // displacement are numbered consecutively
+                if (!this->reuse_preconditioner)
+                  {
+                    AssertThrow(
+                      ParsedTools::DoFRenumbering<dim, spacedim>::
+                        is_node_interleaved(this->dof_handler, spacedim),
+                      ExcMessage("Block storage requires the components of "
+                                 "each node to be numbered consecutively: "
+                                 "choose another DoF renumbering."));
+                    block_storage.initialize(this->matrix.block(0, 0),
+                                             spacedim);
+                  }
+                if (block_storage.has_smoother())
+                  this->inverse_operator.solve(block_storage.get_matrix(),
+                                               block_storage.get_smoother(),
+                                               this->rhs.block(0),
+                                               this->solution.block(0),
+                                               this->solver_tolerance);
+                else
+                  {
+                    // The rigid body modes are the near null space of the AMG
+                    // preconditioner
+                    if (!this->reuse_preconditioner)
+                      {
+                        this->set_rigid_body_modes(
+                          ComponentMask(spacedim, true));
+                        this->preconditioner.initialize(
+                          this->matrix.block(0, 0));
+                      }
+                    this->inverse_operator.solve(block_storage.get_matrix(),
+                                                 this->preconditioner,
+                                                 this->rhs.block(0),
+                                                 this->solution.block(0),
+                                                 this->solver_tolerance);
+                  }
+              }
+            else
+              AssertThrow(false,
+                          ExcMessage("Block storage is only available for "
+                                     "the deal.II linear algebra."));
+          }
+        else if (single_precision.enabled())
+          {
+            if (!this->reuse_preconditioner)
+              single_precision.initialize(this->matrix.block(0, 0));
+            this->inverse_operator.solve(A,
+                                         single_precision,
+                                         this->rhs.block(0),
+                                         this->solution.block(0),
+                                         this->solver_tolerance);
+          }
+        else
+          {
+            if (!this->reuse_preconditioner)
+              {
+                this->set_rigid_body_modes(ComponentMask(spacedim, true));
+                this->preconditioner.initialize(this->matrix.block(0, 0));
+              }
+            this->inverse_operator.solve(A,
+                                         this->preconditioner,
+                                         this->rhs.block(0),
+                                         this->solution.block(0),
+                                         this->solver_tolerance);
+          }
+      }
     this->constraints.distribute(this->solution);
     this->locally_relevant_solution = this->solution;
   }
 
 
 
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearElasticity<dim, spacedim, LacType>::solve_batch(
+    const std::vector<BlockVectorType> &rhs_batch,
+    std::vector<BlockVectorType>       &solutions)
+  {
+    if (this->direct_solver.enabled() || this->block_storage.enabled() ||
+        this->single_precision_preconditioner.enabled())
+      {
+        LinearProblem<dim, spacedim, LacType>::solve_batch(rhs_batch,
+                                                           solutions);
+        return;
+      }
+    // The rigid body modes are the near null space of the AMG preconditioner
+    if (!this->reuse_preconditioner)
+      this->set_rigid_body_modes(ComponentMask(spacedim, true));
+    this->solve_batch_block_cg(rhs_batch, solutions);
+  }
+
+
+
   template <int dim, int spacedim, class LacType>
   void
   LinearElasticity<dim, spacedim, LacType>::postprocess()
   {
+    TimerOutput::Scope timer_section(this->timer, "post_process");
+
     // Construct an object that will integrate on the faces only
     std::map<types::boundary_id, Tensor<1, spacedim>> forces;
 
+    // The copy data is reused across cells: start from an empty map on each
+    // cell, since the cell worker is called before the face workers.
+    const auto cell_integrator =
+      [](const auto &, auto &, auto &data) { data.clear(); };
+
     const auto face_integrator = [&](const auto &cell,
                                      const auto &face,
                                      auto       &scratch,
                                      auto       &data) {
-      data[cell->face(face)->boundary_id()] = Tensor<1, spacedim>();
-
       auto &f = data[cell->face(face)->boundary_id()];
 
       const auto &fe_face_values = scratch.reinit(cell, face);
@@ -176,13 +284,22 @@ namespace PDEs
                                      this->dof_handler.begin_active()),
                           CellFilter(IteratorFilters::LocallyOwnedCell(),
                                      this->dof_handler.end()),
-                          {},
+                          cell_integrator,
                           copyer,
                           scratch,
-                          forces,
-                          MeshWorker::assemble_boundary_faces,
+                          std::map<types::boundary_id, Tensor<1, spacedim>>(),
+                          MeshWorker::assemble_own_cells |
+                            MeshWorker::assemble_boundary_faces,
                           face_integrator);
 
+    // Sum over all processors. Not all processors own faces with all ids.
+    std::set<types::boundary_id> ids;
+    for (const auto &[id, force] : forces)
+      ids.insert(id);
+    ids = Utilities::MPI::compute_set_union(ids, this->mpi_communicator);
+    for (const auto &id : ids)
+      forces[id] = Utilities::MPI::sum(forces[id], this->mpi_communicator);
+
     deallog << "Forces: " << std::endl;
     for (const auto &[id, force] : forces)
       deallog << "ID " << id << ": " << force << std::endl;
@@ -19,19 +19,54 @@
 #include <deal.II/base/discrete_time.h>
 #include <deal.II/base/work_stream.h>
 
+#include <deal.II/distributed/solution_transfer.h>
+
 #include <deal.II/dofs/dof_renumbering.h>
 
 #include <deal.II/fe/fe_tools.h>
 
 #include <deal.II/lac/linear_operator_tools.h>
 
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
 #include "lac.h"
 #include "lac_initializer.h"
+#include "parsed_lac/rigid_body_modes.h"
 
 using namespace dealii;
 
 using ParsedTools::Components::join;
 
+namespace
+{
+  // Split the content of a sweep file into the members of an ensemble.
+  // Members are separated by lines containing only "---". Empty members are
+  // ignored.
+  std::vector<std::string>
+  read_ensemble_members(const std::string &file_name)
+  {
+    std::ifstream in(file_name);
+    AssertThrow(in, ExcFileNotOpen(file_name));
+    std::vector<std::string> members(1);
+    std::string              line;
+    while (std::getline(in, line))
+      if (Utilities::trim(line) == "---")
+        members.emplace_back();
+      else
+        members.back() += line + "\n";
+    members.erase(std::remove_if(members.begin(),
+                                 members.end(),
+                                 [](const std::string &member) {
+                                   return Utilities::trim(member).empty();
+                                 }),
+                  members.end());
+    return members;
+  }
+} // namespace
+
 namespace PDEs
 {
   template <int dim, int spacedim, class LacType>
@@ -68,8 +103,13 @@ namespace PDEs
                      component_names,
                      "FESystem[FE_Q(1)^" + std::to_string(n_components) + "]")
     , dof_handler(triangulation)
+    , dof_renumbering(section_name + "/DoF renumbering")
     , inverse_operator(section_name + "/Solver/System")
     , preconditioner(section_name + "/Solver/System AMG preconditioner")
+    , direct_solver(section_name + "/Solver/System")
+    , single_precision_preconditioner(
+        section_name + "/Solver/System single precision preconditioner")
+    , block_storage(section_name + "/Solver/System block storage")
     , mass_inverse_operator(section_name + "/Solver/Mass")
     , mass_preconditioner(section_name + "/Solver/Mass AMG preconditioner")
     , forcing_term(section_name + "/Functions",
@@ -94,6 +134,11 @@ namespace PDEs
                     ParsedTools::Components::n_blocks(component_names),
                     {VectorTools::H1_norm, VectorTools::L2_norm}))
     , data_out(section_name + "/Output")
+    , reduced_output(section_name + "/Reduced output",
+                     component_names,
+                     "reduced_output",
+                     mpi_communicator)
+    , telemetry(section_name + "/Solver telemetry")
     , ark_ode_data(section_name + "/ARKode")
   {
     add_parameter("n_threads",
@@ -105,12 +150,57 @@ namespace PDEs
     add_parameter("evolution type",
                   evolution_type,
                   "The type of time evolution to use in the linear problem.");
+    add_parameter("Block coupling",
+                  block_coupling,
+                  "Coupling between the blocks of the system matrix. One row "
+                  "per block, separated by semicolons, with one entry per "
+                  "block, separated by commas. Each entry is one of always, "
+                  "nonzero, diagonal, or none. If empty, all components are "
+                  "coupled.");
     enter_subsection("Quasi-static");
     add_parameter("start time", start_time, "Start time of the simulation");
     add_parameter("end time", end_time, "End time of the simulation");
     add_parameter("initial time step",
                   desired_start_step_size,
                   "Initial time step of the simulation");
+    add_parameter("output frequency",
+                  output_frequency,
+                  "Output the full solution every this many time steps. The "
+                  "reduced output is written at every time step.");
+    leave_subsection();
+    enter_subsection("Checkpoint");
+    add_parameter("Restart",
+                  restart,
+                  "Restart the simulation from the last saved checkpoint.");
+    add_parameter("Checkpoint frequency",
+                  checkpoint_frequency,
+                  "Save a checkpoint every this many time steps. Set it to "
+                  "zero to disable checkpointing.");
+    add_parameter("Base name",
+                  checkpoint_base_name,
+                  "Prefix of the checkpoint files.");
+    leave_subsection();
+    enter_subsection("Nested iteration");
+    add_parameter("Accuracy ratio",
+                  accuracy_ratio,
+                  "Ratio between the linear solver tolerance and the error "
+                  "estimated on the previous refinement cycle.");
+    add_parameter("Target error",
+                  target_error,
+                  "Stop refining when the estimated error is below this value. "
+                  "Set it to zero to perform all refinement cycles.");
+    leave_subsection();
+    enter_subsection("Ensemble");
+    add_parameter("Sweep file",
+                  sweep_file,
+                  "File containing the members of the ensemble, separated by "
+                  "lines containing only ---. Each member is a fragment of "
+                  "parameter file, applied on top of this one.");
+    add_parameter("Share preconditioner",
+                  share_preconditioner,
+                  "Do not rebuild the preconditioner for members of the "
+                  "ensemble whose system matrix is equal to the one of the "
+                  "previous member.");
     leave_subsection();
 
     advance_time_call_back.connect(
@@ -150,16 +240,19 @@ namespace PDEs
     // Since our code runs both for simplex grids and for hyper-cube grids, we
     // need to make sure that we build the correct mapping for the grid. In
     // this code we actually use a linear mapping, independently on the order
-    // of the finite element space.
-    mapping = get_default_linear_mapping(triangulation).clone();
+    // of the finite element space. The mapping only depends on the type of
+    // cells, so we build it only once, and keep it across refinement cycles
+    // and time steps.
+    if (!mapping)
+      mapping = get_default_linear_mapping(triangulation).clone();
 
     const auto [block_names, block_multiplicities] =
       ParsedTools::Components::names_to_blocks(component_names);
 
     const auto blocks =
       ParsedTools::Components::block_indices(component_names, component_names);
-    // renumber dofs in a blockwise manner.
-    DoFRenumbering::component_wise(dof_handler, blocks);
+    // renumber dofs in a blockwise manner, and then within each block.
+    dof_renumbering.renumber(dof_handler, blocks);
     dofs_per_block = DoFTools::count_dofs_per_fe_block(dof_handler, blocks);
 
     locally_owned_dofs =
@@ -176,45 +269,14 @@ namespace PDEs
             << dof_handler.n_dofs() << " / ("
             << Patterns::Tools::to_string(dofs_per_block) << ")]" << std::endl;
 
-    constraints.clear();
-    constraints.reinit(non_blocked_locally_relevant_dofs);
-    DoFTools::make_hanging_node_constraints(dof_handler, constraints);
-
-    // We now check that the boundary conditions are consistent with the
-    // triangulation object, that is, we check that the boundary indicators
-    // specified in the parameter file are actually present in the
-    // triangulation, that no boundary indicator is specified twice, and that
-    // all boundary ids of the triangulation are actually covered by the
-    // parameter file configuration.
-    boundary_conditions.check_consistency(triangulation);
-
-    // This is where we apply essential boundary conditions. The
-    // ParsedTools::BoundaryConditions class takes care of collecting boundary
-    // ids, and calling the appropriate function to apply the boundary
-    // condition on the selected boundary ids. Essential boundary conditions
-    // need to be incorporated in the constraints of the linear system, since
-    // they are part of the definition of the solution space.
-    //
-    // Natural bondary conditions, on the other hand, need access to the rhs
-    // of the problem and are not treated via constraints. We will deal with
-    // them later on.
-    boundary_conditions.apply_essential_boundary_conditions(dof_handler,
-                                                            constraints);
-
-    // If necessary, derived functions can add constraints to the system here.
-    add_constraints_call_back();
-    constraints.close();
+    setup_constraints();
 
     LAC::BlockInitializer initializer(dofs_per_block,
                                       locally_owned_dofs,
                                       locally_relevant_dofs,
                                       mpi_communicator);
 
-    Table<2, DoFTools::Coupling> coupling(n_components, n_components);
-    for (unsigned int i = 0; i < n_components; ++i)
-      for (unsigned int j = 0; j < n_components; ++j)
-        coupling[i][j] = DoFTools::always;
-    initializer(sparsity, dof_handler, constraints, coupling);
+    initializer(sparsity, dof_handler, constraints, get_coupling());
     initializer(sparsity, matrix);
     if (evolution_type == EvolutionType::transient)
       initializer(sparsity, mass_matrix);
@@ -244,6 +306,133 @@ namespace PDEs
 
 
 
+  template <int dim, int spacedim, class LacType>
+  Table<2, DoFTools::Coupling>
+  LinearProblem<dim, spacedim, LacType>::get_coupling() const
+  {
+    Table<2, DoFTools::Coupling> coupling(n_components, n_components);
+    coupling.fill(DoFTools::always);
+    if (block_coupling.empty())
+      return coupling;
+
+    const auto n_blocks = ParsedTools::Components::n_blocks(component_names);
+    const auto blocks =
+      ParsedTools::Components::block_indices(component_names, component_names);
+    AssertThrow(block_coupling.size() == n_blocks,
+                ExcDimensionMismatch(block_coupling.size(), n_blocks));
+    for (unsigned int b = 0; b < n_blocks; ++b)
+      {
+        AssertThrow(block_coupling[b].size() == n_blocks,
+                    ExcDimensionMismatch(block_coupling[b].size(), n_blocks));
+        AssertThrow(block_coupling[b][b] != "none",
+                    ExcMessage("The diagonal blocks of the system matrix "
+                               "cannot be empty."));
+      }
+
+    // Index of each component within its block
+    std::vector<unsigned int> index_in_block(n_components, 0);
+    for (unsigned int i = 1; i < n_components; ++i)
+      if (blocks[i] == blocks[i - 1])
+        index_in_block[i] = index_in_block[i - 1] + 1;
+
+    for (unsigned int i = 0; i < n_components; ++i)
+      for (unsigned int j = 0; j < n_components; ++j)
+        {
+          const auto &type = block_coupling[blocks[i]][blocks[j]];
+          if (type == "always")
+            coupling[i][j] = DoFTools::always;
+          else if (type == "nonzero")
+            coupling[i][j] = DoFTools::nonzero;
+          else if (type == "diagonal")
+            coupling[i][j] = (index_in_block[i] == index_in_block[j]) ?
+                               DoFTools::always :
+                               DoFTools::none;
+          else if (type == "none")
+            coupling[i][j] = DoFTools::none;
+          else
+            AssertThrow(false,
+                        ExcMessage("Unknown coupling type <" + type +
+                                   ">. Use one of always, nonzero, "
+                                   "diagonal, or none."));
+        }
+    return coupling;
+  }
+
+
+
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::set_rigid_body_modes(
+    const ComponentMask &component_mask)
+  {
+    if constexpr (std::is_same<typename LacType::AMG,
+                               SparseDirectUMFPACK>::value)
+      (void)component_mask;
+    else
+      {
+        const auto modes =
+          ParsedLAC::rigid_body_modes(*mapping, dof_handler, component_mask);
+        if constexpr (std::is_same<LacType, LAC::LAPETSc>::value)
+          {
+            // Hypre only uses the modes if it treats the matrix as a system
+            // with all the components of the problem on each node, and this
+            // requires the components of each node to be numbered
+            // consecutively
+            const bool system_amg =
+              component_mask.n_selected_components(n_components) ==
+                n_components &&
+              ParsedTools::DoFRenumbering<dim, spacedim>::is_node_interleaved(
+                dof_handler, n_components);
+            preconditioner.set_rigid_body_modes(modes,
+                                                system_amg ? n_components : 1);
+          }
+        else
+          preconditioner.set_rigid_body_modes(modes);
+        deallog << "Rigid body modes: " << modes.size() << std::endl;
+      }
+  }
+
+
+
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::setup_constraints()
+  {
+    IndexSet locally_relevant_set;
+    DoFTools::extract_locally_relevant_dofs(dof_handler, locally_relevant_set);
+
+    constraints.clear();
+    constraints.reinit(locally_relevant_set);
+    DoFTools::make_hanging_node_constraints(dof_handler, constraints);
+
+    // We now check that the boundary conditions are consistent with the
+    // triangulation object, that is, we check that the boundary indicators
+    // specified in the parameter file are actually present in the
+    // triangulation, that no boundary indicator is specified twice, and that
+    // all boundary ids of the triangulation are actually covered by the
+    // parameter file configuration.
+    boundary_conditions.check_consistency(triangulation);
+
+    // This is where we apply essential boundary conditions. The
+    // ParsedTools::BoundaryConditions class takes care of collecting boundary
+    // ids, and calling the appropriate function to apply the boundary
+    // condition on the selected boundary ids. Essential boundary conditions
+    // need to be incorporated in the constraints of the linear system, since
+    // they are part of the definition of the solution space.
+    //
+    // Natural bondary conditions, on the other hand, need access to the rhs
+    // of the problem and are not treated via constraints. We will deal with
+    // them later on.
+    boundary_conditions.apply_essential_boundary_conditions(dof_handler,
+                                                            constraints);
+
+    // If necessary, derived functions can add constraints to the system here.
+    add_constraints_call_back();
+    constraints.close();
+  }
+
+
+
   template <int dim, int spacedim, class LacType>
   void
   LinearProblem<dim, spacedim, LacType>::assemble_system_one_cell(
@@ -366,6 +555,162 @@ namespace PDEs
 
 
 
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::assemble_rhs_batch(
+    const std::vector<const Function<spacedim> *> &forcing_terms,
+    std::vector<BlockVectorType>                  &rhs_batch)
+  {
+    TimerOutput::Scope timer_section(timer, "assemble_rhs_batch");
+    const unsigned int n_rhs = forcing_terms.size();
+    for (const auto &f : forcing_terms)
+      AssertThrow(f != nullptr && f->n_components == n_components,
+                  ExcMessage("All forcing terms must have " +
+                             std::to_string(n_components) + " components."));
+
+    rhs_batch.resize(n_rhs);
+    for (auto &r : rhs_batch)
+      r = rhs;
+
+    // Local contributions of all right hand sides on a single cell
+    struct BatchCopyData
+    {
+      std::vector<Vector<double>>          vectors;
+      std::vector<types::global_dof_index> local_dof_indices;
+    };
+
+    const auto n_dofs_per_cell = finite_element().n_dofs_per_cell();
+
+    ScratchData scratch(*mapping,
+                        finite_element(),
+                        cell_quadrature,
+                        update_values | update_quadrature_points |
+                          update_JxW_values);
+
+    BatchCopyData copy{std::vector<Vector<double>>(n_rhs,
+                                                   Vector<double>(
+                                                     n_dofs_per_cell)),
+                       std::vector<types::global_dof_index>(n_dofs_per_cell)};
+
+    auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
+      const auto &fe_values = scratch.reinit(cell);
+      cell->get_dof_indices(copy.local_dof_indices);
+      for (auto &v : copy.vectors)
+        v = 0;
+
+      Vector<double>              base_values(n_components);
+      std::vector<Vector<double>> values(n_rhs, Vector<double>(n_components));
+
+      for (const unsigned int q : fe_values.quadrature_point_indices())
+        {
+          // Evaluate all forcing terms only once per quadrature point
+          const auto &x = fe_values.quadrature_point(q);
+          forcing_term.vector_value(x, base_values);
+          for (unsigned int k = 0; k < n_rhs; ++k)
+            forcing_terms[k]->vector_value(x, values[k]);
+
+          for (const unsigned int i : fe_values.dof_indices())
+            {
+              const auto comp =
+                finite_element().system_to_component_index(i).first;
+              const auto phi_JxW = fe_values.shape_value(i, q) * // phi_i(x_q)
+                                   fe_values.JxW(q);             // dx
+              for (unsigned int k = 0; k < n_rhs; ++k)
+                copy.vectors[k](i) +=
+                  (values[k][comp] - base_values[comp]) * phi_JxW;
+            }
+        }
+    };
+
+    // The inhomogeneities of the constraints are already part of rhs
+    auto copier = [&](const auto &copy) {
+      for (unsigned int k = 0; k < n_rhs; ++k)
+        constraints.distribute_local_to_global(copy.vectors[k],
+                                               copy.local_dof_indices,
+                                               rhs_batch[k]);
+    };
+
+    using CellFilter = FilteredIterator<
+      typename DoFHandler<dim, spacedim>::active_cell_iterator>;
+
+    WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               dof_handler.begin_active()),
+                    CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               dof_handler.end()),
+                    worker,
+                    copier,
+                    scratch,
+                    copy);
+
+    for (auto &r : rhs_batch)
+      r.compress(VectorOperation::add);
+  }
+
+
+
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::solve_batch(
+    const std::vector<BlockVectorType> &rhs_batch,
+    std::vector<BlockVectorType>       &solutions)
+  {
+    const auto saved_rhs                  = rhs;
+    const auto saved_reuse_preconditioner = reuse_preconditioner;
+
+    solutions.resize(rhs_batch.size());
+    for (unsigned int k = 0; k < rhs_batch.size(); ++k)
+      {
+        deallog << "Solving for right hand side " << k << std::endl;
+        rhs = rhs_batch[k];
+        solve();
+        // The matrix is the same for the whole batch
+        reuse_preconditioner = true;
+        solutions[k]         = solution;
+      }
+
+    reuse_preconditioner = saved_reuse_preconditioner;
+    rhs                  = saved_rhs;
+  }
+
+
+
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::solve_batch_block_cg(
+    const std::vector<BlockVectorType> &rhs_batch,
+    std::vector<BlockVectorType>       &solutions)
+  {
+    TimerOutput::Scope timer_section(timer, "solve_batch");
+    AssertThrow(matrix.n_block_rows() == 1,
+                ExcMessage("The block CG method is only available for "
+                           "problems with a single block."));
+
+    if (!reuse_preconditioner)
+      preconditioner.initialize(matrix.block(0, 0));
+
+    const unsigned int      n_rhs = rhs_batch.size();
+    std::vector<VectorType> src(n_rhs);
+    std::vector<VectorType> dst(n_rhs);
+    for (unsigned int k = 0; k < n_rhs; ++k)
+      {
+        src[k] = rhs_batch[k].block(0);
+        dst[k] = solution.block(0);
+      }
+
+    inverse_operator.solve_block(
+      matrix.block(0, 0), preconditioner, src, dst, solver_tolerance);
+
+    solutions.resize(n_rhs);
+    for (unsigned int k = 0; k < n_rhs; ++k)
+      {
+        solutions[k]          = solution;
+        solutions[k].block(0) = dst[k];
+        constraints.distribute(solutions[k]);
+      }
+  }
+
+
+
   template <int dim, int spacedim, class LacType>
   void
   LinearProblem<dim, spacedim, LacType>::solve()
@@ -463,6 +808,107 @@ namespace PDEs
 
 
 
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::save_checkpoint(
+    const unsigned int step_number,
+    const double       time,
+    const unsigned int output_cycle)
+  {
+    TimerOutput::Scope timer_section(timer, "save_checkpoint");
+    if constexpr (dim > 1)
+      {
+        deallog << "Saving checkpoint " << checkpoint_base_name
+                << " at time step " << step_number << std::endl;
+        std::vector<std::pair<BlockVectorType *, BlockVectorType *>> vectors{
+          {&locally_relevant_solution, &solution}};
+        add_checkpoint_vectors(vectors);
+
+        std::vector<const BlockVectorType *> ghosted_vectors;
+        for (const auto &[ghosted, owned] : vectors)
+          {
+            (void)owned;
+            ghosted_vectors.push_back(ghosted);
+          }
+
+        parallel::distributed::SolutionTransfer<dim, BlockVectorType, spacedim>
+          transfer(dof_handler);
+        transfer.prepare_for_serialization(ghosted_vectors);
+        triangulation.save(checkpoint_base_name + ".tria");
+
+        // Write the time information last, so that a checkpoint is only
+        // considered valid when all of its data is on disk.
+        if (mpi_rank == 0)
+          {
+            std::ofstream out(checkpoint_base_name + ".time");
+            AssertThrow(out, ExcFileNotOpen(checkpoint_base_name + ".time"));
+            out << std::setprecision(17) << step_number << " " << time << " "
+                << output_cycle << std::endl;
+          }
+      }
+    else
+      {
+        (void)step_number;
+        (void)time;
+        (void)output_cycle;
+        AssertThrow(false,
+                    ExcMessage("Checkpointing requires a parallel distributed "
+                               "triangulation, which is not available in "
+                               "one dimension."));
+      }
+  }
+
+
+
+  template <int dim, int spacedim, class LacType>
+  std::tuple<unsigned int, double, unsigned int>
+  LinearProblem<dim, spacedim, LacType>::load_checkpoint()
+  {
+    TimerOutput::Scope timer_section(timer, "load_checkpoint");
+    unsigned int step_number  = 0;
+    double       time         = 0;
+    unsigned int output_cycle = 0;
+    if constexpr (dim > 1)
+      {
+        std::ifstream in(checkpoint_base_name + ".time");
+        AssertThrow(in, ExcFileNotOpen(checkpoint_base_name + ".time"));
+        in >> step_number >> time >> output_cycle;
+        deallog << "Restarting from checkpoint " << checkpoint_base_name
+                << " at time step " << step_number << std::endl;
+
+        triangulation.load(checkpoint_base_name + ".tria");
+        setup_system();
+
+        std::vector<std::pair<BlockVectorType *, BlockVectorType *>> vectors{
+          {&locally_relevant_solution, &solution}};
+        add_checkpoint_vectors(vectors);
+
+        std::vector<BlockVectorType *> owned_vectors;
+        for (const auto &[ghosted, owned] : vectors)
+          {
+            (void)ghosted;
+            owned_vectors.push_back(owned);
+          }
+
+        parallel::distributed::SolutionTransfer<dim, BlockVectorType, spacedim>
+          transfer(dof_handler);
+        transfer.deserialize(owned_vectors);
+
+        for (const auto &[ghosted, owned] : vectors)
+          *ghosted = *owned;
+      }
+    else
+      {
+        AssertThrow(false,
+                    ExcMessage("Checkpointing requires a parallel distributed "
+                               "triangulation, which is not available in "
+                               "one dimension."));
+      }
+    return {step_number, time, output_cycle};
+  }
+
+
+
   template <int dim, int spacedim, class LacType>
   void
   LinearProblem<dim, spacedim, LacType>::run()
@@ -478,6 +924,12 @@ namespace PDEs
         case EvolutionType::transient:
           run_transient();
           break;
+        case EvolutionType::nested_iteration:
+          run_nested_iteration();
+          break;
+        case EvolutionType::ensemble:
+          run_ensemble();
+          break;
         default:
           Assert(false, ExcNotImplemented());
       }
@@ -491,9 +943,25 @@ namespace PDEs
   {
     print_system_info();
     deallog << "Solving quasi-static problem" << std::endl;
-    grid_generator.generate(triangulation);
+    grid_generator.generate(triangulation, restart == false);
     DiscreteTime time(start_time, end_time, desired_start_step_size);
     unsigned int output_cycle = 0;
+    if (restart)
+      {
+        const auto [step_number, saved_time, saved_output_cycle] =
+          load_checkpoint();
+        // Replay the time steps, to reproduce exactly the same sequence of
+        // times of the original run.
+        while (time.get_step_number() < step_number)
+          time.advance_time();
+        AssertThrow(time.get_current_time() == saved_time,
+                    ExcMessage("The time stored in the checkpoint does not "
+                               "match the time step size of this run."));
+        output_cycle = saved_output_cycle;
+        data_out.resume_pvd_record(output_cycle);
+        reduced_output.set_append(true);
+        telemetry.set_append(true);
+      }
     while (time.is_at_end() == false)
       {
         const auto cycle = time.get_step_number();
@@ -511,6 +979,11 @@ namespace PDEs
 
         assemble_system();
         solve();
+        reduced_output.write(t,
+                             *mapping,
+                             dof_handler,
+                             locally_relevant_solution);
+        telemetry.write(cycle, mpi_communicator);
         time.advance_time();
         // Check if we need to output one last time
         if (time.is_at_end())
@@ -521,6 +994,11 @@ namespace PDEs
             if (time.get_step_number() % output_frequency == 0)
               output_results(output_cycle++);
           }
+        if (checkpoint_frequency > 0 &&
+            time.get_step_number() % checkpoint_frequency == 0)
+          save_checkpoint(time.get_step_number(),
+                          time.get_current_time(),
+                          output_cycle);
       }
   }
 
@@ -531,9 +1009,26 @@ namespace PDEs
   LinearProblem<dim, spacedim, LacType>::setup_transient(ARKode &arkode)
   {
     arkode.output_step =
-      [&](const double, const auto &vector, const auto step) {
+      [&](const double t, const auto &vector, const auto local_step) {
+        // After a restart, the first output step is the checkpointed state,
+        // which was already written by the previous run.
+        if (restart && local_step == 0)
+          return;
+
+        // ARKode numbers the output steps from zero. Continue the numbering
+        // of the run that wrote the checkpoint.
+        const unsigned int step = transient_step_offset + local_step;
+
         locally_relevant_solution = vector;
-        output_results(step);
+        if (step % output_frequency == 0)
+          output_results(transient_output_cycle++);
+        reduced_output.write(t,
+                             *mapping,
+                             dof_handler,
+                             locally_relevant_solution);
+        telemetry.write(step, mpi_communicator);
+        if (checkpoint_frequency > 0 && step % checkpoint_frequency == 0)
+          save_checkpoint(step, t, transient_output_cycle);
       };
 
     arkode.implicit_function = [&](const double t, const auto &y, auto &res) {
@@ -595,11 +1090,31 @@ namespace PDEs
   {
     print_system_info();
     deallog << "Solving transient problem" << std::endl;
-    grid_generator.generate(triangulation);
-    setup_system();
+    grid_generator.generate(triangulation, restart == false);
+    if (restart)
+      {
+        // The internal state of ARKode cannot be saved: we restart the time
+        // integration from the last saved solution.
+        const auto [step_number, saved_time, output_cycle] = load_checkpoint();
+        ark_ode_data.initial_time = saved_time;
+        // The first output step of ARKode is the checkpointed one, which was
+        // already written, while the saved output cycle is the next one.
+        transient_step_offset  = step_number;
+        transient_output_cycle = output_cycle;
+        data_out.resume_pvd_record(output_cycle);
+        reduced_output.set_append(true);
+        telemetry.set_append(true);
+      }
+    else
+      {
+        transient_step_offset  = 0;
+        transient_output_cycle = 0;
+        setup_system();
+      }
     assemble_system();
 
-    VectorTools::interpolate(*mapping, dof_handler, initial_value, solution);
+    if (restart == false)
+      VectorTools::interpolate(*mapping, dof_handler, initial_value, solution);
 
     ARKode arkode(ark_ode_data, mpi_communicator);
     setup_transient(arkode);
@@ -631,16 +1146,166 @@ namespace PDEs
         solve();
         estimate(error_per_cell);
         output_results(cycle);
+        reduced_output.write(cycle,
+                             *mapping,
+                             dof_handler,
+                             locally_relevant_solution);
+        telemetry.write(cycle, mpi_communicator);
+        if (cycle < grid_refinement.get_n_refinement_cycles() - 1)
+          {
+            mark(error_per_cell);
+            refine();
+          }
+      }
+    if (this->mpi_rank == 0)
+      error_table.output_table(std::cout);
+  }
+
+
+
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::run_nested_iteration()
+  {
+    print_system_info();
+    deallog << "Solving steady state problem with nested iteration"
+            << std::endl;
+    grid_generator.generate(triangulation);
+
+    // Parallel distributed triangulations need their own SolutionTransfer
+    // class. In one dimension we fall back to a zero initial guess.
+    std::unique_ptr<
+      parallel::distributed::SolutionTransfer<dim, BlockVectorType, spacedim>>
+      solution_transfer;
+
+    // On the coarsest cycle, the tolerance of the parameter file is used.
+    solver_tolerance = 0.0;
+    for (const auto &cycle : grid_refinement.get_refinement_cycles())
+      {
+        deallog << "Cycle " << cycle << std::endl;
+        setup_system();
+        if (solution_transfer)
+          {
+            // Use the interpolation of the previous solution as initial guess
+            solution_transfer->interpolate(solution);
+            constraints.distribute(solution);
+            locally_relevant_solution = solution;
+            solution_transfer.reset();
+          }
+        assemble_system();
+        solve();
+        estimate(error_per_cell);
+        output_results(cycle);
+        reduced_output.write(cycle,
+                             *mapping,
+                             dof_handler,
+                             locally_relevant_solution);
+        telemetry.write(cycle, mpi_communicator);
+
+        const double estimated_error =
+          std::sqrt(Utilities::MPI::sum<double>(error_per_cell.norm_sqr(),
+                                                mpi_communicator));
+        deallog << "Estimated error: " << estimated_error
+                << ", solver tolerance: " << solver_tolerance << std::endl;
+
+        if (target_error > 0 && estimated_error <= target_error)
+          {
+            deallog << "Target error reached in " << cycle + 1 << " cycles"
+                    << std::endl;
+            break;
+          }
+
         if (cycle < grid_refinement.get_n_refinement_cycles() - 1)
           {
+            // The next cycle has a smaller discretization error than the
+            // current one: there is no need to solve below a fraction of it.
+            solver_tolerance = accuracy_ratio * estimated_error;
             mark(error_per_cell);
+            if constexpr (dim > 1)
+              {
+                solution_transfer = std::make_unique<
+                  parallel::distributed::
+                    SolutionTransfer<dim, BlockVectorType, spacedim>>(
+                  dof_handler);
+                solution_transfer->prepare_for_coarsening_and_refinement(
+                  locally_relevant_solution);
+              }
             refine();
           }
       }
+    solver_tolerance = 0.0;
     if (this->mpi_rank == 0)
       error_table.output_table(std::cout);
   }
 
+
+
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearProblem<dim, spacedim, LacType>::run_ensemble()
+  {
+    print_system_info();
+    deallog << "Solving an ensemble of steady state problems" << std::endl;
+    const auto members = read_ensemble_members(sweep_file);
+    AssertThrow(!members.empty(),
+                ExcMessage("The sweep file <" + sweep_file +
+                           "> does not contain any member."));
+
+    // All members are applied on top of the current parameters.
+    std::ostringstream base_parameters;
+    ParameterAcceptor::prm.print_parameters(base_parameters,
+                                            ParameterHandler::JSON);
+
+    grid_generator.generate(triangulation);
+
+    // Detects if the matrix of a member is the same as the previous one
+    ParsedLAC::MatrixChecksum checksum;
+    for (unsigned int member = 0; member < members.size(); ++member)
+      {
+        deallog << "Ensemble member " << member << std::endl;
+        {
+          std::istringstream in(base_parameters.str());
+          ParameterAcceptor::prm.parse_input_from_json(in);
+          ParameterAcceptor::prm.parse_input_from_string(members[member]);
+          ParameterAcceptor::parse_all_parameters();
+        }
+
+        if (member == 0)
+          setup_system();
+        else
+          {
+            // Grid, dofs, and sparsity pattern are shared with the previous
+            // members. Only recompute what depends on the parameters.
+            TimerOutput::Scope timer_section(timer, "setup_system");
+            setup_constraints();
+            matrix   = 0;
+            rhs      = 0;
+            solution = 0;
+            boundary_conditions.apply_natural_boundary_conditions(
+              *mapping, dof_handler, constraints, matrix, rhs);
+            exact_solution.update_constants({});
+            forcing_term.update_constants({});
+            setup_system_call_back();
+          }
+        assemble_system();
+
+        const bool matrix_changed = checksum.update(matrix);
+        reuse_preconditioner      = share_preconditioner && !matrix_changed;
+        if (reuse_preconditioner)
+          deallog << "Reusing the preconditioner of the previous member"
+                  << std::endl;
+
+        solve();
+        output_results(member);
+        reduced_output.write(member,
+                             *mapping,
+                             dof_handler,
+                             locally_relevant_solution);
+        telemetry.write(member, mpi_communicator);
+      }
+    reuse_preconditioner = false;
+  }
+
   template class LinearProblem<1, 1, LAC::LAdealii>;
   template class LinearProblem<1, 2, LAC::LAdealii>;
   template class LinearProblem<1, 3, LAC::LAdealii>;
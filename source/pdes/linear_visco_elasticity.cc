@@ -15,10 +15,14 @@
 #include "pdes/linear_visco_elasticity.h"
 
 #include <deal.II/base/symmetric_tensor.h>
+#include <deal.II/base/work_stream.h>
+
+#include <deal.II/grid/filtered_iterator.h>
 
 #include "deal.II/meshworker/mesh_loop.h"
 
 #include "parsed_tools/components.h"
+#include "pdes/shape_cache.h"
 
 using namespace dealii;
 
@@ -44,6 +48,7 @@ namespace PDEs
                    "Second Lame coefficient",
                    "Shear viscosity",
                    "Bulk viscosity"})
+    , materials{{Material(constants_0), Material(constants_1)}}
     , material_ids_0({0})
     , eulerian_mapping(this->dof_handler, "/LinearViscoElasticity/Mapping")
   {
@@ -76,8 +81,10 @@ namespace PDEs
     });
 
     this->setup_system_call_back.connect([&]() {
-      // Make sure we only setup the displacement vector once
-      if (current_cycle == 0)
+      // Make sure we only setup the displacement vector once. When restarting
+      // from a checkpoint, the first cycle is not zero, but the vector has
+      // not been initialized yet.
+      if (current_cycle == 0 || current_displacement.n_blocks() == 0)
         {
           current_displacement_locally_relevant.reinit(
             this->locally_relevant_solution);
@@ -94,6 +101,11 @@ namespace PDEs
         this->current_cycle = n;
       });
 
+    this->add_checkpoint_vectors.connect([&](auto &vectors) {
+      vectors.emplace_back(&current_displacement_locally_relevant,
+                           &current_displacement);
+    });
+
     this->add_data_vector.connect([&](auto &d) {
       d.add_data_vector(current_displacement_locally_relevant,
                         ParsedTools::Components::blocks_to_names({"W"},
@@ -113,125 +125,248 @@ namespace PDEs
       ParsedTools::Components::get_cell_quadrature(
         this->triangulation, this->finite_element().tensor_degree() + 1);
 
-
-    ScratchData scratch(this->finite_element(),
-                        quadrature_formula,
-                        update_gradients | update_JxW_values);
-
-    ScratchData mapped_scratch(eulerian_mapping(),
-                               this->finite_element(),
-                               quadrature_formula,
-                               update_values | update_gradients |
-                                 update_quadrature_points | update_JxW_values);
+    ScratchDataPair scratch{
+      ScratchData(this->finite_element(),
+                  quadrature_formula,
+                  update_gradients | update_JxW_values),
+      ScratchData(eulerian_mapping(),
+                  this->finite_element(),
+                  quadrature_formula,
+                  update_values | update_gradients | update_quadrature_points |
+                    update_JxW_values)};
 
     CopyData copy(this->finite_element().n_dofs_per_cell());
 
     this->rhs    = 0;
     this->matrix = 0;
 
-    for (const auto &cell : this->dof_handler.active_cell_iterators())
-      if (cell->is_locally_owned())
-        {
-          auto &cell_matrix = copy.matrices[0];
-          auto &cell_rhs    = copy.vectors[0];
+    const auto identity = unit_symmetric_tensor<spacedim>();
 
-          cell->get_dof_indices(copy.local_dof_indices[0]);
+    auto worker = [&](const auto &cell, auto &scratch_pair, auto &copy) {
+      auto &scratch        = scratch_pair.lagrangian;
+      auto &mapped_scratch = scratch_pair.eulerian;
+      auto &cell_matrix    = copy.matrices[0];
+      auto &cell_rhs       = copy.vectors[0];
 
-          const auto &fe_values        = scratch.reinit(cell);
-          const auto &mapped_fe_values = mapped_scratch.reinit(cell);
+      cell->get_dof_indices(copy.local_dof_indices[0]);
 
-          cell_matrix = 0;
-          cell_rhs    = 0;
+      const auto &fe_values        = scratch.reinit(cell);
+      const auto &mapped_fe_values = mapped_scratch.reinit(cell);
 
-          scratch.extract_local_dof_values(
-            "Wn", this->current_displacement_locally_relevant);
-          const auto &div_Wn = scratch.get_divergences("Wn", displacement);
-          const auto &eps_Wn =
-            scratch.get_symmetric_gradients("Wn", displacement);
+      cell_matrix = 0;
+      cell_rhs    = 0;
 
-          const ParsedTools::Constants &c =
-            (material_ids_0.find(cell->material_id()) != material_ids_0.end()) ?
-              constants_0 :
-              constants_1;
+      scratch.extract_local_dof_values(
+        "Wn", this->current_displacement_locally_relevant);
+      const auto &div_Wn = scratch.get_divergences("Wn", displacement);
+      const auto &eps_Wn = scratch.get_symmetric_gradients("Wn", displacement);
 
-          static const auto identity = unit_symmetric_tensor<spacedim>();
+      const auto &material =
+        materials[material_ids_0.count(cell->material_id()) > 0 ? 0 : 1];
 
-          for (const unsigned int q_index :
-               fe_values.quadrature_point_indices())
-            for (const unsigned int i : fe_values.dof_indices())
-              {
-                const auto x = mapped_fe_values.quadrature_point(q_index);
+      const double mu     = material.mu;
+      const double lambda = material.lambda;
+      const double eta    = material.eta;
+      const double kappa  = material.kappa;
 
-                // Lagrangian
-                const auto &eps_V =
-                  fe_values[displacement].symmetric_gradient(i, q_index);
+      // Lagrangian and Eulerian shape functions
+      const auto &shapes        = reinit_shape_cache(scratch, displacement);
+      const auto &mapped_shapes = reinit_shape_cache(mapped_scratch,
+                                                     displacement);
+      const auto &dofs          = shapes.get_dofs();
 
-                // Eulerian
-                const auto eps_v =
-                  mapped_fe_values[displacement].symmetric_gradient(i, q_index);
+      for (const unsigned int q_index : fe_values.quadrature_point_indices())
+        {
+          const auto   x   = mapped_fe_values.quadrature_point(q_index);
+          const double JxW = fe_values.JxW(q_index);
+          const double JxW_mapped = mapped_fe_values.JxW(q_index);
 
-                for (const unsigned int j : fe_values.dof_indices())
-                  {
-                    // Elastic part.
-                    const auto &eps_W =
-                      fe_values[displacement].symmetric_gradient(j, q_index);
-                    const auto &div_W =
-                      fe_values[displacement].divergence(j, q_index);
-
-                    const auto P_el = this->dt * 2 * c["mu"] * eps_W +
-                                      c["lambda"] * div_W * identity;
-
-                    const auto &eps_u =
-                      mapped_fe_values[displacement].symmetric_gradient(
-                        j, q_index);
-
-                    const auto &div_u =
-                      mapped_fe_values[displacement].divergence(j, q_index);
-
-                    const auto sigma_vis =
-                      2 * c["eta"] * eps_u + c["kappa"] * div_u * identity;
-
-                    cell_matrix(i, j) +=
-                      (scalar_product(sigma_vis, eps_v) *
-                         mapped_fe_values.JxW(q_index) + // dx
-                       scalar_product(P_el, eps_V) *
-                         fe_values.JxW(q_index)); // dX
-                  }
+          // The bilinear form is symmetric: only assemble the lower triangle
+          for (unsigned int k = 0; k < shapes.n_dofs(); ++k)
+            {
+              const auto  &eps_V = shapes.symmetric_gradient(k, q_index);
+              const double div_V = shapes.divergence(k, q_index);
+              const auto  &eps_v = mapped_shapes.symmetric_gradient(k, q_index);
+              const double div_v = mapped_shapes.divergence(k, q_index);
+
+              for (unsigned int l = 0; l <= k; ++l)
+                {
+                  // Elastic part
+                  const double elastic =
+                    this->dt * 2 * mu *
+                      scalar_product(shapes.symmetric_gradient(l, q_index),
+                                     eps_V) +
+                    lambda * shapes.divergence(l, q_index) * div_V;
+
+                  // Viscous part
+                  const double viscous =
+                    2 * eta *
+                      scalar_product(
+                        mapped_shapes.symmetric_gradient(l, q_index), eps_v) +
+                    kappa * mapped_shapes.divergence(l, q_index) * div_v;
+
+                  cell_matrix(dofs[k], dofs[l]) +=
+                    viscous * JxW_mapped + // dx
+                    elastic * JxW;         // dX
+                }
+            }
 
-                const auto Pn = 2 * c["mu"] * eps_Wn[q_index] +
-                                c["lambda"] * div_Wn[q_index] * identity;
-
-                cell_rhs(i) +=
-                  (-scalar_product(Pn, eps_V) * fe_values.JxW(q_index) + // dX
-                   mapped_fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                     this->forcing_term.value(x,
-                                              this->finite_element()
-                                                .system_to_component_index(i)
-                                                .first) * // f(x_q)
-                     fe_values.JxW(q_index));             // dx
-              }
-          this->constraints.distribute_local_to_global(
-            cell_matrix,
-            cell_rhs,
-            copy.local_dof_indices[0],
-            this->matrix,
-            this->rhs);
+          const auto Pn = 2 * mu * eps_Wn[q_index] +
+                          lambda * div_Wn[q_index] * identity;
+
+          for (const unsigned int i : fe_values.dof_indices())
+            cell_rhs(i) +=
+              (-scalar_product(Pn,
+                               fe_values[displacement].symmetric_gradient(
+                                 i, q_index)) *
+                 JxW +                                    // dX
+               mapped_fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                 this->forcing_term.value(x,
+                                          this->finite_element()
+                                            .system_to_component_index(i)
+                                            .first) * // f(x_q)
+                 JxW);                                // dx
         }
+      mirror_lower_triangle(cell_matrix);
+    };
+
+    auto copier = [&](const auto &copy) { this->copy_one_cell(copy); };
+
+    using CellFilter = FilteredIterator<
+      typename DoFHandler<dim, spacedim>::active_cell_iterator>;
+
+    WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               this->dof_handler.begin_active()),
+                    CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               this->dof_handler.end()),
+                    worker,
+                    copier,
+                    scratch,
+                    copy);
+
     this->matrix.compress(VectorOperation::add);
     this->rhs.compress(VectorOperation::add);
   }
 
 
 
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearViscoElasticity<dim, spacedim, LacType>::assemble_rhs_batch(
+    const std::vector<const Function<spacedim> *> &,
+    std::vector<BlockVectorType> &)
+  {
+    AssertThrow(false,
+                ExcMessage("Batches of right hand sides are not supported by "
+                           "LinearViscoElasticity: its forcing term is "
+                           "evaluated at the points of the deformed "
+                           "configuration."));
+  }
+
+
+
+  template <int dim, int spacedim, class LacType>
+  void
+  LinearViscoElasticity<dim, spacedim, LacType>::solve_batch(
+    const std::vector<BlockVectorType> &,
+    std::vector<BlockVectorType> &)
+  {
+    AssertThrow(false,
+                ExcNotImplemented("Batches of right hand sides are not "
+                                  "supported by LinearViscoElasticity: every "
+                                  "solve advances the displacement by one "
+                                  "time step."));
+  }
+
+
+
   template <int dim, int spacedim, class LacType>
   void
   LinearViscoElasticity<dim, spacedim, LacType>::solve()
   {
     TimerOutput::Scope timer_section(this->timer, "solve");
-    const auto A = linear_operator<VectorType>(this->matrix.block(0, 0));
-    this->preconditioner.initialize(this->matrix.block(0, 0));
-    const auto Ainv         = this->inverse_operator(A, this->preconditioner);
-    this->solution.block(0) = Ainv * this->rhs.block(0);
+    if (this->direct_solver.enabled())
+      {
+        // The matrix is assembled on the deformed configuration, and changes
+        // at every time step: the direct solver compares the checksum of the
+        // matrix with the one of the last factorization, and refactorizes.
+        this->direct_solver.initialize(this->matrix.block(0, 0));
+        this->direct_solver.vmult(this->solution.block(0), this->rhs.block(0));
+      }
+    else
+      {
+        const auto A = linear_operator<VectorType>(this->matrix.block(0, 0));
+        auto &single_precision = this->single_precision_preconditioner;
+        auto &block_storage    = this->block_storage;
+        // The velocity of the previous time step is the initial guess
+        if (block_storage.enabled())
+          {
+            if constexpr (std::is_same<LacType, LAC::LAdealii>::value)
+              {
+                if (!this->reuse_preconditioner)
+                  {
+                    AssertThrow(
+                      ParsedTools::DoFRenumbering<dim, spacedim>::
+                        is_node_interleaved(this->dof_handler, spacedim),
+                      ExcMessage("Block storage requires the components of "
+                                 "each node to be numbered consecutively: "
+                                 "choose another DoF renumbering."));
+                    block_storage.initialize(this->matrix.block(0, 0),
+                                             spacedim);
+                  }
+                if (block_storage.has_smoother())
+                  this->inverse_operator.solve(block_storage.get_matrix(),
+                                               block_storage.get_smoother(),
+                                               this->rhs.block(0),
+                                               this->solution.block(0),
+                                               this->solver_tolerance);
+                else
+                  {
+                    // The rigid body modes are the near null space of the AMG
+                    // preconditioner
+                    if (!this->reuse_preconditioner)
+                      {
+                        this->set_rigid_body_modes(
+                          ComponentMask(spacedim, true));
+                        this->preconditioner.initialize(
+                          this->matrix.block(0, 0));
+                      }
+                    this->inverse_operator.solve(block_storage.get_matrix(),
+                                                 this->preconditioner,
+                                                 this->rhs.block(0),
+                                                 this->solution.block(0),
+                                                 this->solver_tolerance);
+                  }
+              }
+            else
+              AssertThrow(false,
+                          ExcMessage("Block storage is only available for "
+                                     "the deal.II linear algebra."));
+          }
+        else if (single_precision.enabled())
+          {
+            if (!this->reuse_preconditioner)
+              single_precision.initialize(this->matrix.block(0, 0));
+            this->inverse_operator.solve(A,
+                                         single_precision,
+                                         this->rhs.block(0),
+                                         this->solution.block(0),
+                                         this->solver_tolerance);
+          }
+        else
+          {
+            if (!this->reuse_preconditioner)
+              {
+                this->set_rigid_body_modes(ComponentMask(spacedim, true));
+                this->preconditioner.initialize(this->matrix.block(0, 0));
+              }
+            this->inverse_operator.solve(A,
+                                         this->preconditioner,
+                                         this->rhs.block(0),
+                                         this->solution.block(0),
+                                         this->solver_tolerance);
+          }
+      }
     this->constraints.distribute(this->solution);
     this->locally_relevant_solution = this->solution;
     current_displacement.sadd(1.0, dt, this->solution);
@@ -249,78 +384,100 @@ namespace PDEs
       ParsedTools::Components::get_cell_quadrature(
         this->triangulation, this->finite_element().tensor_degree() + 1);
 
-    ScratchData scratch(this->finite_element(),
-                        quadrature_formula,
-                        update_gradients | update_JxW_values);
-
-    ScratchData mapped_scratch(eulerian_mapping(),
-                               this->finite_element(),
-                               quadrature_formula,
-                               update_quadrature_points | update_values |
-                                 update_gradients | update_JxW_values);
-
-    static std::ofstream outfile("visco_elastic_energies.txt");
-    if (current_cycle == 0)
-      outfile
-        << "# t \t E_pot[0] \t E_pot[1] \t Diss[0] \t Diss[1] \t Ext[0] \t Ext[1]"
-        << std::endl;
+    ScratchDataPair scratch{
+      ScratchData(this->finite_element(),
+                  quadrature_formula,
+                  update_gradients | update_JxW_values),
+      ScratchData(eulerian_mapping(),
+                  this->finite_element(),
+                  quadrature_formula,
+                  update_quadrature_points | update_values | update_gradients |
+                    update_JxW_values)};
+
+    // Energies of a single cell
+    struct EnergyData
+    {
+      unsigned int id               = 0;
+      double       potential_energy = 0.0;
+      double       dissipation      = 0.0;
+      double       external_energy  = 0.0;
+    };
 
     // One per material
     std::vector<double> potential_energy(2, 0.0);
     std::vector<double> dissipation(2, 0.0);
     std::vector<double> external_energy(2, 0.0);
 
-    for (const auto &cell : this->dof_handler.active_cell_iterators())
-      if (cell->is_locally_owned())
+    auto worker = [&](const auto &cell, auto &scratch_pair, auto &data) {
+      auto &scratch        = scratch_pair.lagrangian;
+      auto &mapped_scratch = scratch_pair.eulerian;
+
+      const auto &fe_values        = scratch.reinit(cell);
+      const auto &mapped_fe_values = mapped_scratch.reinit(cell);
+
+      scratch.extract_local_dof_values(
+        "Wn", this->current_displacement_locally_relevant);
+      mapped_scratch.extract_local_dof_values("Un",
+                                              this->locally_relevant_solution);
+
+      const auto &div_Wn = scratch.get_divergences("Wn", displacement);
+      const auto &eps_Wn = scratch.get_symmetric_gradients("Wn", displacement);
+
+      const auto &un     = mapped_scratch.get_values("Un", displacement);
+      const auto &div_un = mapped_scratch.get_divergences("Un", displacement);
+      const auto &eps_un =
+        mapped_scratch.get_symmetric_gradients("Un", displacement);
+
+      const auto id =
+        material_ids_0.find(cell->material_id()) != material_ids_0.end() ?
+          0 :
+          1;
+      data    = EnergyData();
+      data.id = id;
+      const auto  &material = materials[data.id];
+      const double mu       = material.mu;
+      const double lambda   = material.lambda;
+      const double eta      = material.eta;
+      const double kappa    = material.kappa;
+
+      for (const unsigned int q_index : fe_values.quadrature_point_indices())
         {
-          const auto &fe_values        = scratch.reinit(cell);
-          const auto &mapped_fe_values = mapped_scratch.reinit(cell);
-
-          scratch.extract_local_dof_values(
-            "Wn", this->current_displacement_locally_relevant);
-          mapped_scratch.extract_local_dof_values(
-            "Un", this->locally_relevant_solution);
-
-          const auto &div_Wn = scratch.get_divergences("Wn", displacement);
-          const auto &eps_Wn =
-            scratch.get_symmetric_gradients("Wn", displacement);
-
-
-          const auto &un = mapped_scratch.get_values("Un", displacement);
-          const auto &div_un =
-            mapped_scratch.get_divergences("Un", displacement);
-          const auto &eps_un =
-            mapped_scratch.get_symmetric_gradients("Un", displacement);
-
-          const auto id =
-            material_ids_0.find(cell->material_id()) != material_ids_0.end() ?
-              0 :
-              1;
-
-          const ParsedTools::Constants &c =
-            (id == 0 ? constants_0 : constants_1);
-
-          for (const unsigned int q_index :
-               fe_values.quadrature_point_indices())
-            {
-              potential_energy[id] +=
-                c["mu"] * scalar_product(eps_Wn[q_index], eps_Wn[q_index]) +
-                0.5 * c["lambda"] * div_Wn[q_index] * div_Wn[q_index] *
-                  fe_values.JxW(q_index);
-
-              dissipation[id] +=
-                c["eta"] * scalar_product(eps_un[q_index], eps_un[q_index]) +
-                0.5 * c["kappa"] * div_un[q_index] * div_un[q_index] *
-                  mapped_fe_values.JxW(q_index);
-
-              for (unsigned int i = 0; i < spacedim; ++i)
-                external_energy[id] +=
-                  un[q_index][i] *
-                  this->forcing_term.value(
-                    mapped_fe_values.quadrature_point(q_index), i) *
-                  mapped_fe_values.JxW(q_index);
-            }
+          data.potential_energy +=
+            (mu * scalar_product(eps_Wn[q_index], eps_Wn[q_index]) +
+             0.5 * lambda * div_Wn[q_index] * div_Wn[q_index]) *
+            fe_values.JxW(q_index);
+
+          data.dissipation +=
+            (eta * scalar_product(eps_un[q_index], eps_un[q_index]) +
+             0.5 * kappa * div_un[q_index] * div_un[q_index]) *
+            mapped_fe_values.JxW(q_index);
+
+          for (unsigned int i = 0; i < spacedim; ++i)
+            data.external_energy +=
+              un[q_index][i] *
+              this->forcing_term.value(
+                mapped_fe_values.quadrature_point(q_index), i) *
+              mapped_fe_values.JxW(q_index);
         }
+    };
+
+    auto copier = [&](const auto &data) {
+      potential_energy[data.id] += data.potential_energy;
+      dissipation[data.id] += data.dissipation;
+      external_energy[data.id] += data.external_energy;
+    };
+
+    using CellFilter = FilteredIterator<
+      typename DoFHandler<dim, spacedim>::active_cell_iterator>;
+
+    WorkStream::run(CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               this->dof_handler.begin_active()),
+                    CellFilter(IteratorFilters::LocallyOwnedCell(),
+                               this->dof_handler.end()),
+                    worker,
+                    copier,
+                    scratch,
+                    EnergyData());
 
     // Sum over all processors
     Utilities::MPI::sum(ArrayView<const double>(potential_energy),
@@ -333,10 +490,27 @@ namespace PDEs
                         this->mpi_communicator,
                         ArrayView<double>(external_energy));
 
-    outfile << current_time << " \t " << potential_energy[0] << " \t "
-            << potential_energy[1] << " \t " << dissipation[0] << " \t "
-            << dissipation[1] << " \t "
-            << external_energy[0] + external_energy[1] << std::endl;
+    // Only the first process writes the energies
+    if (this->mpi_rank != 0)
+      return;
+
+    if (!energy_file.is_open())
+      {
+        // When restarting, append to the energies of the previous run
+        energy_file.open("visco_elastic_energies.txt",
+                         this->restart ? std::ios::app : std::ios::out);
+        AssertThrow(energy_file,
+                    ExcFileNotOpen("visco_elastic_energies.txt"));
+      }
+    if (current_cycle == 0)
+      energy_file
+        << "# t \t E_pot[0] \t E_pot[1] \t Diss[0] \t Diss[1] \t Ext"
+        << std::endl;
+
+    energy_file << current_time << " \t " << potential_energy[0] << " \t "
+                << potential_energy[1] << " \t " << dissipation[0] << " \t "
+                << dissipation[1] << " \t "
+                << external_energy[0] + external_energy[1] << std::endl;
   }
 
 
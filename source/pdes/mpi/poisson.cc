@@ -72,16 +72,46 @@ namespace PDEs
     Poisson<dim, spacedim>::solve()
     {
       TimerOutput::Scope timer_section(this->timer, "solve");
-      const auto A = linear_operator<VectorType>(this->matrix.block(0, 0));
-      this->preconditioner.initialize(this->matrix.block(0, 0));
-      const auto Ainv         = this->inverse_operator(A, this->preconditioner);
-      this->solution.block(0) = Ainv * this->rhs.block(0);
+      if (this->direct_solver.enabled())
+        {
+          this->direct_solver.initialize(this->matrix.block(0, 0));
+          this->direct_solver.vmult(this->solution.block(0),
+                                    this->rhs.block(0));
+        }
+      else
+        {
+          const auto A = linear_operator<VectorType>(this->matrix.block(0, 0));
+          if (!this->reuse_preconditioner)
+            this->preconditioner.initialize(this->matrix.block(0, 0));
+          // The solution vector may contain an initial guess (see
+          // run_nested_iteration())
+          this->inverse_operator.solve(A,
+                                       this->preconditioner,
+                                       this->rhs.block(0),
+                                       this->solution.block(0),
+                                       this->solver_tolerance);
+        }
       this->constraints.distribute(this->solution);
       this->locally_relevant_solution = this->solution;
     }
 
 
 
+    template <int dim, int spacedim>
+    void
+    Poisson<dim, spacedim>::solve_batch(
+      const std::vector<BlockVectorType> &rhs_batch,
+      std::vector<BlockVectorType>       &solutions)
+    {
+      if (this->direct_solver.enabled())
+        LinearProblem<dim, spacedim, LAC::LATrilinos>::solve_batch(rhs_batch,
+                                                                   solutions);
+      else
+        this->solve_batch_block_cg(rhs_batch, solutions);
+    }
+
+
+
     template <int dim, int spacedim>
     void
     Poisson<dim, spacedim>::custom_estimator(
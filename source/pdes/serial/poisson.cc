@@ -15,8 +15,14 @@
 
 #include "pdes/serial/poisson.h"
 
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/work_stream.h>
+
 #include <deal.II/lac/linear_operator_tools.h>
 
+#include <deal.II/meshworker/copy_data.h>
+#include <deal.II/meshworker/scratch_data.h>
+
 #include <deal.II/numerics/error_estimator.h>
 
 
@@ -34,6 +40,8 @@ namespace PDEs
       , dof_handler(triangulation)
       , inverse_operator("/Poisson/Solver")
       , preconditioner("/Poisson/Solver/AMG Preconditioner")
+      , single_precision_preconditioner(
+          "/Poisson/Solver/Single precision preconditioner")
       , constants("/Poisson/Constants",
                   {"kappa"},
                   {1.0},
@@ -49,6 +57,11 @@ namespace PDEs
       , data_out("/Poisson/Output")
     {
       add_parameter("Console level", this->console_level);
+      add_parameter("Number of threads",
+                    this->number_of_threads,
+                    "Maximum number of threads used in the assembly. A "
+                    "non-positive number means that all available cores are "
+                    "used.");
     }
 
 
@@ -148,47 +161,68 @@ namespace PDEs
       // Again, since we support also tria and tets, we need to make sure we
       // pass a compatible mapping to the FEValues object, otherwise things may
       // not work.
-      FEValues<dim, spacedim> fe_values(*mapping,
-                                        finite_element,
-                                        quadrature_formula,
-                                        update_values | update_gradients |
-                                          update_quadrature_points |
-                                          update_JxW_values);
-
-      const unsigned int dofs_per_cell = finite_element().n_dofs_per_cell();
-      FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
-      Vector<double>     cell_rhs(dofs_per_cell);
-      std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
-      for (const auto &cell : dof_handler.active_cell_iterators())
-        {
-          fe_values.reinit(cell);
-          cell_matrix = 0;
-          cell_rhs    = 0;
-          for (const unsigned int q_index :
-               fe_values.quadrature_point_indices())
-            {
-              for (const unsigned int i : fe_values.dof_indices())
-                for (const unsigned int j : fe_values.dof_indices())
-                  cell_matrix(i, j) +=
-                    (constants["kappa"] *
-                     fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
-                     fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
-                     fe_values.JxW(q_index));           // dx
-              for (const unsigned int i : fe_values.dof_indices())
-                cell_rhs(i) +=
-                  (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                   forcing_term.value(
-                     fe_values.quadrature_point(q_index)) * // f(x_q)
-                   fe_values.JxW(q_index));                 // dx
-            }
-
-          cell->get_dof_indices(local_dof_indices);
-          constraints.distribute_local_to_global(cell_matrix,
-                                                 cell_rhs,
-                                                 local_dof_indices,
-                                                 system_matrix,
-                                                 system_rhs);
-        }
+      //
+      // Differently from step-3, the loop over the cells is executed in
+      // parallel by all available threads, through the WorkStream class (see
+      // step-9). Each thread owns a copy of the MeshWorker::ScratchData
+      // object, that contains the FEValues object, and fills a
+      // MeshWorker::CopyData object with the local matrix, the local right
+      // hand side, and the local dof indices. The copier is called on one
+      // cell at the time, and distributes the local contributions to the
+      // global system.
+      using ScratchData = MeshWorker::ScratchData<dim, spacedim>;
+      using CopyData    = MeshWorker::CopyData<1, 1, 1>;
+
+      ScratchData scratch(*mapping,
+                          finite_element(),
+                          quadrature_formula,
+                          update_values | update_gradients |
+                            update_quadrature_points | update_JxW_values);
+
+      CopyData copy(finite_element().n_dofs_per_cell());
+
+      // Look up the diffusion coefficient once, outside of the cell loop
+      const double kappa = constants["kappa"];
+
+      auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
+        const auto &fe_values   = scratch.reinit(cell);
+        auto       &cell_matrix = copy.matrices[0];
+        auto       &cell_rhs    = copy.vectors[0];
+        cell_matrix             = 0;
+        cell_rhs                = 0;
+        for (const unsigned int q_index : fe_values.quadrature_point_indices())
+          {
+            for (const unsigned int i : fe_values.dof_indices())
+              for (const unsigned int j : fe_values.dof_indices())
+                cell_matrix(i, j) +=
+                  (kappa *
+                   fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
+                   fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
+                   fe_values.JxW(q_index));           // dx
+            for (const unsigned int i : fe_values.dof_indices())
+              cell_rhs(i) +=
+                (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                 forcing_term.value(
+                   fe_values.quadrature_point(q_index)) * // f(x_q)
+                 fe_values.JxW(q_index));                 // dx
+          }
+        cell->get_dof_indices(copy.local_dof_indices[0]);
+      };
+
+      auto copier = [&](const CopyData &copy) {
+        constraints.distribute_local_to_global(copy.matrices[0],
+                                               copy.vectors[0],
+                                               copy.local_dof_indices[0],
+                                               system_matrix,
+                                               system_rhs);
+      };
+
+      WorkStream::run(dof_handler.begin_active(),
+                      dof_handler.end(),
+                      worker,
+                      copier,
+                      scratch,
+                      copy);
     }
 
 
@@ -201,10 +235,20 @@ namespace PDEs
     Poisson<dim, spacedim>::solve()
     {
       deallog << "Solve system" << std::endl;
-      preconditioner.initialize(system_matrix);
-      const auto A    = linear_operator<Vector<double>>(system_matrix);
-      const auto Ainv = inverse_operator(A, preconditioner);
-      solution        = Ainv * system_rhs;
+      const auto A = linear_operator<Vector<double>>(system_matrix);
+      if (single_precision_preconditioner.enabled())
+        {
+          single_precision_preconditioner.initialize(system_matrix);
+          const auto Ainv =
+            inverse_operator(A, single_precision_preconditioner);
+          solution = Ainv * system_rhs;
+        }
+      else
+        {
+          preconditioner.initialize(system_matrix);
+          const auto Ainv = inverse_operator(A, preconditioner);
+          solution        = Ainv * system_rhs;
+        }
       constraints.distribute(solution);
     }
 
@@ -251,6 +295,8 @@ namespace PDEs
     {
       deallog.pop();
       deallog.depth_console(console_level);
+      if (number_of_threads > 0)
+        MultithreadInfo::set_thread_limit(number_of_threads);
       grid_generator.generate(triangulation);
       for (const auto &cycle : grid_refinement.get_refinement_cycles())
         {
@@ -17,8 +17,14 @@
 
 #include <deal.II/grid/grid_out.h>
 
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/work_stream.h>
+
 #include <deal.II/lac/linear_operator_tools.h>
 
+#include <deal.II/meshworker/copy_data.h>
+#include <deal.II/meshworker/scratch_data.h>
+
 #include <deal.II/numerics/error_estimator.h>
 
 
@@ -61,6 +67,11 @@ namespace PDEs
       , data_out("/PoissonNitscheInterface/Output")
     {
       add_parameter("Console level", this->console_level);
+      add_parameter("Number of threads",
+                    this->number_of_threads,
+                    "Maximum number of threads used in the assembly. A "
+                    "non-positive number means that all available cores are "
+                    "used.");
     }
 
 
@@ -151,48 +162,62 @@ namespace PDEs
             space_fe().tensor_degree() + 1);
 
 
-        FEValues<spacedim, spacedim> fe_values(*mapping,
-                                               space_fe,
-                                               quadrature_formula,
-                                               update_values |
-                                                 update_gradients |
-                                                 update_quadrature_points |
-                                                 update_JxW_values);
-
-        const unsigned int dofs_per_cell = space_fe().n_dofs_per_cell();
-        FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
-        Vector<double>     cell_rhs(dofs_per_cell);
-        std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
-        for (const auto &cell : space_dh.active_cell_iterators())
-          {
-            fe_values.reinit(cell);
-            cell_matrix = 0;
-            cell_rhs    = 0;
-            for (const unsigned int q_index :
-                 fe_values.quadrature_point_indices())
-              {
-                for (const unsigned int i : fe_values.dof_indices())
-                  for (const unsigned int j : fe_values.dof_indices())
-                    cell_matrix(i, j) +=
-                      (constants["kappa"] *
-                       fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
-                       fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
-                       fe_values.JxW(q_index));           // dx
-                for (const unsigned int i : fe_values.dof_indices())
-                  cell_rhs(i) +=
-                    (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                     forcing_term.value(
-                       fe_values.quadrature_point(q_index)) * // f(x_q)
-                     fe_values.JxW(q_index));                 // dx
-              }
-
-            cell->get_dof_indices(local_dof_indices);
-            space_constraints.distribute_local_to_global(cell_matrix,
-                                                         cell_rhs,
-                                                         local_dof_indices,
-                                                         system_matrix,
-                                                         system_rhs);
-          }
+        using ScratchData = MeshWorker::ScratchData<spacedim, spacedim>;
+        using CopyData    = MeshWorker::CopyData<1, 1, 1>;
+
+        ScratchData scratch(*mapping,
+                            space_fe(),
+                            quadrature_formula,
+                            update_values | update_gradients |
+                              update_quadrature_points | update_JxW_values);
+
+        CopyData copy(space_fe().n_dofs_per_cell());
+
+        // Look up the diffusion coefficient once, outside of the cell loop
+        const double kappa = constants["kappa"];
+
+        // The cell loop runs in parallel on all available threads
+        auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
+          const auto &fe_values   = scratch.reinit(cell);
+          auto       &cell_matrix = copy.matrices[0];
+          auto       &cell_rhs    = copy.vectors[0];
+          cell_matrix             = 0;
+          cell_rhs                = 0;
+          for (const unsigned int q_index :
+               fe_values.quadrature_point_indices())
+            {
+              for (const unsigned int i : fe_values.dof_indices())
+                for (const unsigned int j : fe_values.dof_indices())
+                  cell_matrix(i, j) +=
+                    (kappa *
+                     fe_values.shape_grad(i, q_index) * // grad phi_i(x_q)
+                     fe_values.shape_grad(j, q_index) * // grad phi_j(x_q)
+                     fe_values.JxW(q_index));           // dx
+              for (const unsigned int i : fe_values.dof_indices())
+                cell_rhs(i) +=
+                  (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                   forcing_term.value(
+                     fe_values.quadrature_point(q_index)) * // f(x_q)
+                   fe_values.JxW(q_index));                 // dx
+            }
+          cell->get_dof_indices(copy.local_dof_indices[0]);
+        };
+
+        auto copier = [&](const CopyData &copy) {
+          space_constraints.distribute_local_to_global(
+            copy.matrices[0],
+            copy.vectors[0],
+            copy.local_dof_indices[0],
+            system_matrix,
+            system_rhs);
+        };
+
+        WorkStream::run(space_dh.begin_active(),
+                        space_dh.end(),
+                        worker,
+                        copier,
+                        scratch,
+                        copy);
       }
 
 
@@ -283,6 +308,8 @@ namespace PDEs
     {
       deallog.pop();
       deallog.depth_console(console_level);
+      if (number_of_threads > 0)
+        MultithreadInfo::set_thread_limit(number_of_threads);
 
       generate_grids();
       for (const auto &cycle : grid_refinement.get_refinement_cycles())
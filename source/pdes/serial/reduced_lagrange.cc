@@ -23,9 +23,12 @@
 
 #include <deal.II/dofs/dof_tools.h>
 
+#include <deal.II/fe/fe_values.h>
+
 #include <deal.II/grid/grid_generator.h>
 #include <deal.II/grid/grid_tools.h>
 
+#include <deal.II/lac/lapack_full_matrix.h>
 #include <deal.II/lac/linear_operator_tools.h>
 #include <deal.II/lac/precondition.h>
 #include <deal.II/lac/trilinos_solver.h>
@@ -36,10 +39,16 @@
 #include <deal.II/numerics/matrix_tools.h>
 #include <deal.II/numerics/vector_tools.h>
 
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
 #include <boost/geometry.hpp>
+#include <boost/serialization/vector.hpp>
 
+#include <cmath>
+#include <complex>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 
 #include "parsed_tools/enum.h"
 #include "projection_operator.h"
@@ -70,6 +79,7 @@ namespace PDEs
       , boundary_conditions("/Boundary conditions")
       , stiffness_inverse_operator("/Solver/Stiffness")
       , stiffness_preconditioner("/Solver/Stiffness AMG")
+      , stiffness_direct_solver("/Solver/Stiffness", true)
       , mass_preconditioner("/Solver/Mass AMG")
       , schur_inverse_operator("/Solver/Schur")
       , data_out("/Data out/Space", "output/space")
@@ -81,6 +91,10 @@ namespace PDEs
       add_parameter("Console level", console_level);
       add_parameter("Delta refinement", delta_refinement);
       add_parameter("Number of basis functions", n_basis);
+      add_parameter("Solve full order system",
+                    solve_full_order,
+                    "Solve also the full order system, and compare the "
+                    "reduced solution with the full order one.");
       add_parameter("Finite element degree (ambient space)",
                     finite_element_degree);
       add_parameter("Finite element degree (embedded space)",
@@ -88,15 +102,40 @@ namespace PDEs
       add_parameter("Finite element degree (configuration)",
                     embedded_configuration_finite_element_degree);
       enter_subsection("Solver");
-      enter_subsection("Stiffness");
-      add_parameter("Use direct solver", use_direct_solver);
-      leave_subsection();
-      leave_subsection();
-      enter_subsection("Solver");
       enter_subsection("Schur");
       add_parameter("Preconditioner type", schur_preconditioner);
       leave_subsection();
       leave_subsection();
+      enter_subsection("Reduced operators");
+      add_parameter("Save to file",
+                    save_reduced_operators_file,
+                    "If not empty, write the reduced operators computed in "
+                    "the offline stage to this file.");
+      add_parameter("Load from file",
+                    load_reduced_operators_file,
+                    "If not empty, read the reduced operators from this file "
+                    "instead of computing them in the offline stage of the "
+                    "first cycle. The full order system is then only "
+                    "assembled and solved if required.");
+      leave_subsection();
+      enter_subsection("Basis");
+      add_parameter("Basis type",
+                    basis_type,
+                    "Type of basis functions for the reduced Lagrange "
+                    "multiplier: harmonic polynomials, POD modes of the "
+                    "snapshot function, or eigenfunctions of the embedded "
+                    "Laplacian.");
+      add_parameter("Snapshot function",
+                    snapshot_function,
+                    "Expression of the POD snapshots in x, y, z, and in the "
+                    "snapshot parameter t.");
+      add_parameter("Snapshot parameters",
+                    snapshot_parameters,
+                    "Values of t used to generate the POD snapshots.");
+      leave_subsection();
+
+      embedded_grid_connection = embedded_grid.signals.any_change.connect(
+        [&]() { basis_is_valid = false; });
     }
 
 
@@ -247,42 +286,202 @@ namespace PDEs
     void
     ReducedLagrange<dim, spacedim>::update_basis_functions()
     {
-      basis_functions.resize(n_basis, Vector<double>(embedded_dh.n_dofs()));
+      if (basis_is_valid && basis_functions.size() == n_basis &&
+          (n_basis == 0 || basis_functions[0].size() == embedded_dh.n_dofs()))
+        {
+          deallog << "Reusing cached basis functions" << std::endl;
+          return;
+        }
+
+      TimerOutput::Scope timer_section(monitor, "Update basis functions");
+      basis_functions.assign(n_basis, Vector<double>(embedded_dh.n_dofs()));
 
       if (n_basis > 0)
-        basis_functions[0] = 1.0;
+        switch (basis_type)
+          {
+            case BasisType::harmonic:
+              compute_harmonic_basis();
+              break;
+            case BasisType::pod:
+              compute_pod_basis();
+              break;
+            case BasisType::eigenfunctions:
+              compute_eigenfunction_basis();
+              break;
+            default:
+              Assert(false, ExcInternalError());
+          }
+
+      for (unsigned int c = 0; c < n_basis; ++c)
+        deallog << "Basis function " << c
+                << " norm: " << basis_functions[c].l2_norm() << std::endl;
+      basis_is_valid = true;
+    }
 
-      for (unsigned int c = 1; c < n_basis; ++c)
+
+
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::interpolate_on_embedded_space(
+      const std::function<void(const Point<spacedim> &, Vector<double> &)> &f,
+      std::vector<Vector<double>> &vectors)
+    {
+      const Quadrature<dim> support_points(
+        embedded_fe->get_unit_support_points());
+      FEValues<dim, spacedim> fe_values(embedded_mapping(),
+                                        *embedded_fe,
+                                        support_points,
+                                        update_quadrature_points);
+
+      std::vector<types::global_dof_index> dof_indices(
+        embedded_fe->n_dofs_per_cell());
+      std::vector<bool> touched(embedded_dh.n_dofs(), false);
+      Vector<double>    values(vectors.size());
+
+      for (const auto &cell : embedded_dh.active_cell_iterators())
         {
-          unsigned int k = (c + 1) / 2;
+          fe_values.reinit(cell);
+          cell->get_dof_indices(dof_indices);
+          for (const auto q : fe_values.quadrature_point_indices())
+            if (touched[dof_indices[q]] == false)
+              {
+                f(fe_values.quadrature_point(q), values);
+                for (unsigned int i = 0; i < vectors.size(); ++i)
+                  vectors[i][dof_indices[q]] = values[i];
+                touched[dof_indices[q]] = true;
+              }
+        }
+      for (auto &v : vectors)
+        embedded_constraints.distribute(v);
+    }
 
-          FunctionParser<spacedim> b1(
-            "sqrt(pi^k*(2*k + 2))*(x^2 + y^2)^(k/2)*cos(k*atan2(y, x))",
-            "k=" + std::to_string(k) + ", pi=" + std::to_string(M_PI));
-          FunctionParser<spacedim> b2(
-            "sqrt(pi^k*(2*k + 2))*(x^2 + y^2)^(k/2)*sin(k*atan2(y, x))",
-            "k=" + std::to_string(k) + ", pi=" + std::to_string(M_PI));
 
-          if ((c + 1) % 2 == 0)
-            {
-              VectorTools::interpolate(embedded_mapping(),
-                                       embedded_dh,
-                                       b1,
-                                       basis_functions[c]);
-            }
-          else
-            {
-              VectorTools::interpolate(embedded_mapping(),
-                                       embedded_dh,
-                                       b2,
-                                       basis_functions[c]);
-            }
-          deallog << "Basis function " << c
-                  << " norm: " << basis_functions[c].l2_norm() << std::endl;
+
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::compute_harmonic_basis()
+    {
+      // Basis c is 1 for c = 0, and the real or imaginary part of
+      // sqrt(pi^k*(2*k + 2)) (x + iy)^k, with k = (c+1)/2, otherwise.
+      const auto harmonics = [&](const Point<spacedim> &p,
+                                 Vector<double>        &values) {
+        const std::complex<double> z(p[0], p[1]);
+        std::complex<double>       zk(1.0, 0.0);
+        values[0] = 1.0;
+        for (unsigned int c = 1; c < n_basis; ++c)
+          {
+            const unsigned int k = (c + 1) / 2;
+            if ((c + 1) % 2 == 0)
+              zk *= z;
+            const double scaling =
+              std::sqrt(std::pow(numbers::PI, k) * (2.0 * k + 2.0));
+            values[c] = scaling * ((c + 1) % 2 == 0 ? zk.real() : zk.imag());
+          }
+      };
+      interpolate_on_embedded_space(harmonics, basis_functions);
+    }
+
+
+
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::compute_pod_basis()
+    {
+      const unsigned int n_snapshots = snapshot_parameters.size();
+      AssertThrow(n_snapshots >= n_basis,
+                  ExcMessage("The POD basis requires at least as many "
+                             "snapshot parameters as basis functions."));
+
+      // Snapshots, where the parameter of the snapshot function is t
+      FunctionParser<spacedim> function(snapshot_function,
+                                        "pi=" + std::to_string(numbers::PI));
+      std::vector<Vector<double>> snapshots(n_snapshots,
+                                            Vector<double>(
+                                              embedded_dh.n_dofs()));
+      const auto evaluate_snapshots = [&](const Point<spacedim> &p,
+                                          Vector<double>        &values) {
+        for (unsigned int i = 0; i < n_snapshots; ++i)
+          {
+            function.set_time(snapshot_parameters[i]);
+            values[i] = function.value(p);
+          }
+      };
+      interpolate_on_embedded_space(evaluate_snapshots, snapshots);
+
+      // Method of snapshots: correlation matrix in the L2 scalar product
+      LAPACKFullMatrix<double> correlation(n_snapshots, n_snapshots);
+      Vector<double>           M_snapshot(embedded_dh.n_dofs());
+      for (unsigned int i = 0; i < n_snapshots; ++i)
+        {
+          embedded_mass_matrix.vmult(M_snapshot, snapshots[i]);
+          for (unsigned int j = 0; j < n_snapshots; ++j)
+            correlation(i, j) = snapshots[j] * M_snapshot;
+        }
+      correlation.compute_svd();
+      const auto &U = correlation.get_svd_u();
+
+      for (unsigned int k = 0; k < n_basis; ++k)
+        {
+          const double sigma = correlation.singular_value(k);
+          AssertThrow(sigma > 1e-12 * correlation.singular_value(0),
+                      ExcMessage("The snapshots span only " +
+                                 std::to_string(k) +
+                                 " independent directions."));
+          for (unsigned int j = 0; j < n_snapshots; ++j)
+            basis_functions[k].add(U(j, k) / std::sqrt(sigma), snapshots[j]);
+          deallog << "POD singular value " << k << ": " << sigma << std::endl;
+        }
+    }
+
+
+
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::compute_eigenfunction_basis()
+    {
+      const auto embedded_quad = ParsedTools::Components::get_cell_quadrature(
+        embedded_grid, embedded_fe->tensor_degree() + 1);
+
+      // The embedded stiffness matrix used for the preconditioner has one
+      // constrained dof. Build the full Laplace matrix here.
+      SparseMatrix<double> laplace_matrix(embedded_sparsity);
+      MatrixTools::create_laplace_matrix(
+        embedded_mapping(),
+        embedded_dh,
+        embedded_quad,
+        laplace_matrix,
+        static_cast<const Function<spacedim> *>(nullptr),
+        embedded_constraints);
+
+      const unsigned int       n_dofs = embedded_dh.n_dofs();
+      LAPACKFullMatrix<double> K(n_dofs, n_dofs);
+      LAPACKFullMatrix<double> M(n_dofs, n_dofs);
+      K = laplace_matrix;
+      M = embedded_mass_matrix;
+
+      // Push the eigenvalues of constrained dofs to the end of the spectrum
+      const double large = 1e10 * laplace_matrix.linfty_norm();
+      for (unsigned int i = 0; i < n_dofs; ++i)
+        if (embedded_constraints.is_constrained(i))
+          {
+            K(i, i) = large;
+            M(i, i) = 1.0;
+          }
+
+      std::vector<Vector<double>> eigenvectors(n_basis,
+                                               Vector<double>(n_dofs));
+      K.compute_generalized_eigenvalues_symmetric(M, eigenvectors);
+      for (unsigned int k = 0; k < n_basis; ++k)
+        {
+          basis_functions[k] = eigenvectors[k];
+          embedded_constraints.distribute(basis_functions[k]);
+          deallog << "Eigenvalue " << k << ": " << K.eigenvalue(k).real()
+                  << std::endl;
         }
     }
 
 
+
     template <int dim, int spacedim>
     void
     ReducedLagrange<dim, spacedim>::setup_dofs()
@@ -375,17 +574,21 @@ namespace PDEs
         space_grid, space_fe->tensor_degree() + 1);
       const auto embedded_quad = ParsedTools::Components::get_cell_quadrature(
         embedded_grid, embedded_fe->tensor_degree() + 1);
+      // With stored reduced operators, the full order system is not needed
+      const bool assemble_full_order =
+        solve_full_order || !loads_reduced_operators();
       {
         TimerOutput::Scope timer_section(monitor, "Assemble system");
         // Stiffness matrix and rhs
-        MatrixTools::create_laplace_matrix(
-          space_dh,
-          space_quad,
-          stiffness_matrix,
-          forcing_term,
-          rhs,
-          static_cast<const Function<spacedim> *>(nullptr),
-          constraints);
+        if (assemble_full_order)
+          MatrixTools::create_laplace_matrix(
+            space_dh,
+            space_quad,
+            stiffness_matrix,
+            forcing_term,
+            rhs,
+            static_cast<const Function<spacedim> *>(nullptr),
+            constraints);
 
         // Embedded mass matrix
         MatrixCreator::create_mass_matrix(
@@ -412,16 +615,17 @@ namespace PDEs
       }
       {
         TimerOutput::Scope timer_section(monitor, "Assemble coupling system");
-        NonMatching::create_coupling_mass_matrix(*space_grid_tools_cache,
-                                                 space_dh,
-                                                 embedded_dh,
-                                                 embedded_quad,
-                                                 coupling_matrix,
-                                                 constraints,
-                                                 ComponentMask(),
-                                                 ComponentMask(),
-                                                 embedded_mapping(),
-                                                 embedded_constraints);
+        if (assemble_full_order)
+          NonMatching::create_coupling_mass_matrix(*space_grid_tools_cache,
+                                                   space_dh,
+                                                   embedded_dh,
+                                                   embedded_quad,
+                                                   coupling_matrix,
+                                                   constraints,
+                                                   ComponentMask(),
+                                                   ComponentMask(),
+                                                   embedded_mapping(),
+                                                   embedded_constraints);
 
         // The rhs of the Lagrange multiplier as a function to plot
         VectorTools::interpolate(embedded_mapping(),
@@ -438,107 +642,327 @@ namespace PDEs
       }
       update_basis_functions();
     }
+    template <int dim, int spacedim>
+    bool
+    ReducedLagrange<dim, spacedim>::loads_reduced_operators() const
+    {
+      return n_basis > 0 && load_reduced_operators_file != "" &&
+             !reduced_operators_loaded;
+    }
+
+
+
     template <int dim, int spacedim>
     void
     ReducedLagrange<dim, spacedim>::solve()
     {
       TimerOutput::Scope timer_section(monitor, "Solve system");
 
-      auto                A     = linear_operator(stiffness_matrix);
-      auto                Bt    = linear_operator(coupling_matrix);
-      auto                B     = transpose_operator(Bt);
-      auto                A_inv = A;
-      SparseDirectUMFPACK A_inv_direct;
+      AssertThrow(solve_full_order || n_basis > 0,
+                  ExcMessage("Nothing to solve: either solve the full order "
+                             "system, or use at least one basis function."));
 
-      if (use_direct_solver)
+      const bool load_operators = loads_reduced_operators();
+      if (solve_full_order || !load_operators)
         {
-          A_inv_direct.initialize(stiffness_matrix);
-          A_inv = linear_operator(A, A_inv_direct);
+          auto A     = linear_operator(stiffness_matrix);
+          auto Bt    = linear_operator(coupling_matrix);
+          auto B     = transpose_operator(Bt);
+          auto A_inv = A;
+
+          if (stiffness_direct_solver.enabled())
+            {
+              stiffness_direct_solver.initialize(stiffness_matrix);
+              A_inv = linear_operator(A, stiffness_direct_solver);
+            }
+          else
+            {
+              stiffness_preconditioner.initialize(stiffness_matrix);
+              A_inv = stiffness_inverse_operator(A, stiffness_preconditioner);
+            }
+
+          if (solve_full_order)
+            {
+              auto M = linear_operator(embedded_mass_matrix);
+              auto K = linear_operator(embedded_stiffness_matrix);
+
+              mass_preconditioner.initialize(embedded_mass_matrix);
+              auto Minv = linear_operator(M, mass_preconditioner);
+
+              auto S      = B * A_inv * Bt;
+              auto S_prec = identity_operator(S);
+              switch (schur_preconditioner)
+                {
+                  case SchurPreconditioner::identity:
+                    break;
+                  case SchurPreconditioner::M:
+                    S_prec = M;
+                    break;
+                  case SchurPreconditioner::Minv:
+                    S_prec = Minv;
+                    break;
+                  case SchurPreconditioner::K:
+                    S_prec = K;
+                    break;
+                  case SchurPreconditioner::Minv_K_Minv:
+                    S_prec = Minv * K * Minv;
+                    break;
+                  default:
+                    Assert(false, ExcInternalError());
+                }
+              auto S_inv = schur_inverse_operator(S, S_prec);
+
+              deallog << "Solving full order system" << std::endl;
+
+              lambda = S_inv * (B * A_inv * rhs - embedded_rhs);
+              embedded_constraints.distribute(lambda);
+
+              solution = A_inv * (rhs - Bt * lambda);
+              constraints.distribute(solution);
+            }
+
+          if (n_basis > 0 && !load_operators)
+            compute_reduced_operators(A_inv);
         }
-      else
+
+      if (n_basis > 0)
         {
-          stiffness_preconditioner.initialize(stiffness_matrix);
-          A_inv = stiffness_inverse_operator(A, stiffness_preconditioner);
+          if (load_operators)
+            {
+              load_reduced_operators(load_reduced_operators_file);
+              reduced_operators_loaded = true;
+            }
+
+          if (save_reduced_operators_file != "")
+            save_reduced_operators(save_reduced_operators_file);
+
+          solve_online();
         }
+    }
 
-      auto M = linear_operator(embedded_mass_matrix);
-      auto K = linear_operator(embedded_stiffness_matrix);
 
-      mass_preconditioner.initialize(embedded_mass_matrix);
-      auto Minv = linear_operator(M, mass_preconditioner);
 
-      auto S      = B * A_inv * Bt;
-      auto S_prec = identity_operator(S);
-      switch (schur_preconditioner)
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::compute_reduced_operators(
+      const LinearOperator<Vector<double>> &A_inv)
+    {
+      TimerOutput::Scope timer_section(monitor, "Offline reduced operators");
+      deallog << "Computing reduced operators" << std::endl;
+
+      // The affine component of the reduced rhs that does not depend on the
+      // embedded data.
+      full_order_offset = A_inv * rhs;
+
+      // Columns of C^T = B^T R^T, and their responses A^{-1} C^T e_j.
+      std::vector<Vector<double>> coupled_basis(n_basis,
+                                                Vector<double>(
+                                                  space_dh.n_dofs()));
+      reduced_responses.resize(n_basis);
+      for (unsigned int j = 0; j < n_basis; ++j)
         {
-          case SchurPreconditioner::identity:
-            break;
-          case SchurPreconditioner::M:
-            S_prec = M;
-            break;
-          case SchurPreconditioner::Minv:
-            S_prec = Minv;
-            break;
-          case SchurPreconditioner::K:
-            S_prec = K;
-            break;
-          case SchurPreconditioner::Minv_K_Minv:
-            S_prec = Minv * K * Minv;
-            break;
-          default:
-            Assert(false, ExcInternalError());
+          coupling_matrix.vmult(coupled_basis[j], basis_functions[j]);
+          reduced_responses[j] = A_inv * coupled_basis[j];
         }
-      auto S_inv = schur_inverse_operator(S, S_prec);
 
-      deallog << "Solving full order system" << std::endl;
+      reduced_schur_complement.reinit(n_basis, n_basis);
+      reduced_rhs.reinit(n_basis);
+      for (unsigned int i = 0; i < n_basis; ++i)
+        {
+          reduced_rhs[i] = coupled_basis[i] * full_order_offset;
+          for (unsigned int j = 0; j < n_basis; ++j)
+            reduced_schur_complement(i, j) =
+              coupled_basis[i] * reduced_responses[j];
+        }
+      reduced_schur_complement_inverse.reinit(n_basis, n_basis);
+      reduced_schur_complement_inverse.invert(reduced_schur_complement);
+
+      FullMatrix<double> G(n_basis, n_basis);
+      Vector<double>     M_phi(embedded_dh.n_dofs());
+      for (unsigned int i = 0; i < n_basis; ++i)
+        {
+          embedded_mass_matrix.vmult(M_phi, basis_functions[i]);
+          for (unsigned int j = 0; j < n_basis; ++j)
+            G(i, j) = basis_functions[j] * M_phi;
+        }
+      reduced_mass_matrix_inverse.reinit(n_basis, n_basis);
+      reduced_mass_matrix_inverse.invert(G);
+    }
 
-      lambda = S_inv * (B * A_inv * rhs - embedded_rhs);
-      embedded_constraints.distribute(lambda);
 
-      solution = A_inv * (rhs - Bt * lambda);
-      constraints.distribute(solution);
 
-      if (n_basis > 0)
-        {
-          deallog << "Solving Reduced order system" << std::endl;
-          Vector<double> reduced(n_basis);
-          std::vector<std::reference_wrapper<const Vector<double>>> basis(
-            basis_functions.begin(), basis_functions.end());
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::solve_online()
+    {
+      TimerOutput::Scope timer_section(monitor, "Online reduced solve");
+      deallog << "Solving Reduced order system" << std::endl;
+
+      Vector<double> reduced(n_basis);
+      std::vector<std::reference_wrapper<const Vector<double>>> basis(
+        basis_functions.begin(), basis_functions.end());
+
+      auto R  = projection_operator(reduced, basis);
+      auto Rt = transpose_operator(R);
+
+      small_rhs = R * embedded_rhs;
+      reduced_mass_matrix_inverse.vmult(small_value, small_rhs);
+
+      Vector<double> tmp(reduced_rhs);
+      tmp -= small_rhs;
+      reduced_schur_complement_inverse.vmult(small_lambda, tmp);
+
+      reduced_solution = full_order_offset;
+      for (unsigned int j = 0; j < n_basis; ++j)
+        reduced_solution.add(-small_lambda[j], reduced_responses[j]);
+      constraints.distribute(reduced_solution);
+
+      reduced_lambda = Rt * small_lambda;
+      embedded_constraints.distribute(reduced_lambda);
+
+      reduced_embedded_value = Rt * small_value;
+      embedded_constraints.distribute(reduced_embedded_value);
+
+      deallog << "Small lambda: " << small_lambda << std::endl;
+      deallog << "Small value: " << small_value << std::endl;
+      deallog << "Small rhs: " << small_rhs << std::endl;
+    }
+
+
+
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::save_reduced_operators(
+      const std::string &filename) const
+    {
+      std::ofstream ofs(filename);
+      AssertThrow(ofs, ExcFileNotOpen(filename));
+      boost::archive::binary_oarchive oa(ofs);
+
+      // Store what the reduced operators depend on, to validate them on load
+      const unsigned int type       = static_cast<unsigned int>(basis_type);
+      const unsigned int n_space    = space_dh.n_dofs();
+      const unsigned int n_embedded = embedded_dh.n_dofs();
+      const auto         hash       = reduced_operators_parameters_hash();
+      oa << n_basis << type << n_space << n_embedded << hash;
+
+      oa << reduced_schur_complement << reduced_schur_complement_inverse
+         << reduced_mass_matrix_inverse << reduced_rhs << full_order_offset
+         << reduced_responses;
+    }
+
+
+
+    template <int dim, int spacedim>
+    void
+    ReducedLagrange<dim, spacedim>::load_reduced_operators(
+      const std::string &filename)
+    {
+      TimerOutput::Scope timer_section(monitor, "Load reduced operators");
+      deallog << "Loading reduced operators from " << filename << std::endl;
+      std::ifstream ifs(filename);
+      AssertThrow(ifs, ExcFileNotOpen(filename));
+      boost::archive::binary_iarchive ia(ifs);
+
+      unsigned int stored_n_basis         = 0;
+      unsigned int stored_basis_type      = 0;
+      unsigned int stored_n_space_dofs    = 0;
+      unsigned int  stored_n_embedded_dofs = 0;
+      std::uint64_t stored_parameters_hash = 0;
+      ia >> stored_n_basis >> stored_basis_type >> stored_n_space_dofs >>
+        stored_n_embedded_dofs >> stored_parameters_hash;
+
+      AssertThrow(stored_n_basis == n_basis,
+                  ExcMessage("The reduced operators in " + filename +
+                             " were computed with " +
+                             std::to_string(stored_n_basis) +
+                             " basis functions, but " +
+                             std::to_string(n_basis) + " are required."));
+      AssertThrow(stored_basis_type == static_cast<unsigned int>(basis_type),
+                  ExcMessage("The reduced operators in " + filename +
+                             " were computed with a different basis type."));
+      AssertThrow(stored_n_space_dofs == space_dh.n_dofs(),
+                  ExcMessage("The reduced operators in " + filename +
+                             " were computed with " +
+                             std::to_string(stored_n_space_dofs) +
+                             " space degrees of freedom, but the current "
+                             "space discretization has " +
+                             std::to_string(space_dh.n_dofs()) + "."));
+      AssertThrow(stored_n_embedded_dofs == embedded_dh.n_dofs(),
+                  ExcMessage("The reduced operators in " + filename +
+                             " were computed with " +
+                             std::to_string(stored_n_embedded_dofs) +
+                             " embedded degrees of freedom, but the current "
+                             "embedded discretization has " +
+                             std::to_string(embedded_dh.n_dofs()) + "."));
+      AssertThrow(stored_parameters_hash ==
+                    reduced_operators_parameters_hash(),
+                  ExcMessage("The reduced operators in " + filename +
+                             " were computed with different parameters, "
+                             "e.g., a different forcing term, boundary "
+                             "conditions, grids, or basis functions."));
+
+      ia >> reduced_schur_complement >> reduced_schur_complement_inverse >>
+        reduced_mass_matrix_inverse >> reduced_rhs >> full_order_offset >>
+        reduced_responses;
+    }
 
-          FullMatrix<double> G(n_basis, n_basis);
-          for (unsigned int i = 0; i < n_basis; ++i)
+
+
+    template <int dim, int spacedim>
+    std::uint64_t
+    ReducedLagrange<dim, spacedim>::reduced_operators_parameters_hash() const
+    {
+      // Parameters that do not change the reduced operators. The operators
+      // are only read on the first cycle, before any refinement.
+      const std::vector<std::string> ignored = {"Console level",
+                                                "Solve full order system",
+                                                "Data out",
+                                                "Error table",
+                                                "Reduced operators",
+                                                "Grid/Refinement",
+                                                "Solver/Mass AMG",
+                                                "Solver/Schur",
+                                                "Functions/Embedded value"};
+
+      std::stringstream prm_stream;
+      ParameterAcceptor::prm.print_parameters(prm_stream,
+                                              ParameterHandler::ShortPRM);
+
+      // 64 bits FNV-1a hash of the full names and values of the parameters,
+      // which does not depend on the alignment of the parameter file
+      std::uint64_t hash = 14695981039346656037ull;
+      auto          add  = [&](const std::string &text) {
+        for (const unsigned char c : text)
+          hash = (hash ^ c) * 1099511628211ull;
+      };
+
+      std::vector<std::string> path;
+      std::string              line;
+      while (std::getline(prm_stream, line))
+        {
+          line = Utilities::trim(line);
+          if (line.rfind("subsection ", 0) == 0)
+            path.push_back(Utilities::trim(line.substr(11)));
+          else if (line == "end" && !path.empty())
+            path.pop_back();
+          else if (line.rfind("set ", 0) == 0)
             {
-              embedded_value = M * basis_functions[i];
-              for (unsigned int j = 0; j < n_basis; ++j)
-                G(i, j) = basis_functions[j] * embedded_value;
+              const auto equal = line.find('=');
+              std::string name;
+              for (const auto &section : path)
+                name += section + "/";
+              name += Utilities::trim(line.substr(4, equal - 4));
+
+              bool skip = false;
+              for (const auto &prefix : ignored)
+                skip = skip || name.rfind(prefix, 0) == 0;
+              if (skip == false)
+                add(name + "=" + Utilities::trim(line.substr(equal + 1)) +
+                    "\n");
             }
-          FullMatrix<double> Ginv(n_basis, n_basis);
-          Ginv.invert(G);
-
-          auto R  = projection_operator(reduced, basis);
-          auto Rt = transpose_operator(R);
-
-          auto Ct      = Bt * Rt;
-          auto C       = R * B;
-          auto RS      = C * A_inv * Ct;
-          auto RS_prec = identity_operator(RS);
-          auto RS_inv  = schur_inverse_operator(RS, RS_prec);
-          small_rhs    = R * embedded_rhs;
-          Ginv.vmult(small_value, small_rhs);
-          small_lambda     = RS_inv * (C * A_inv * rhs - small_rhs);
-          reduced_solution = A_inv * (rhs - Ct * small_lambda);
-          constraints.distribute(reduced_solution);
-
-          reduced_lambda = Rt * small_lambda;
-          embedded_constraints.distribute(reduced_lambda);
-
-          reduced_embedded_value = Rt * small_value;
-          embedded_constraints.distribute(reduced_embedded_value);
-
-          deallog << "Small lambda: " << small_lambda << std::endl;
-          deallog << "Small value: " << small_value << std::endl;
-          deallog << "Small rhs: " << small_rhs << std::endl;
         }
+      return hash;
     }
 
 
@@ -598,14 +1022,14 @@ namespace PDEs
           setup_coupling();
           assemble_system();
           solve();
-          if (n_basis == 0)
+          if (solve_full_order && n_basis == 0)
             {
               error_table_space.error_from_exact(*space_mapping,
                                                  space_dh,
                                                  solution,
                                                  exact_solution);
             }
-          else
+          else if (solve_full_order)
             {
               error_table_space.difference(*space_mapping,
                                            space_dh,
@@ -621,7 +1045,9 @@ namespace PDEs
           if (cycle < grid_refinement.get_n_refinement_cycles() - 1)
             {
               grid_refinement.estimate_mark_refine(space_dh,
-                                                   solution,
+                                                   solve_full_order ?
+                                                     solution :
+                                                     reduced_solution,
                                                    space_grid);
               adjust_grid_refinements(false);
             }
@@ -15,11 +15,17 @@
 
 #include "pdes/serial/stokes.h"
 
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/work_stream.h>
+
 #include <deal.II/dofs/dof_renumbering.h>
 
 #include <deal.II/lac/linear_operator_tools.h>
 #include <deal.II/lac/sparse_direct.h>
 
+#include <deal.II/meshworker/copy_data.h>
+#include <deal.II/meshworker/scratch_data.h>
+
 #include <deal.II/numerics/error_estimator.h>
 
 using namespace dealii;
@@ -73,6 +79,11 @@ namespace PDEs
       leave_my_subsection(this->prm);
       leave_subsection();
       add_parameter("Console level", this->console_level);
+      add_parameter("Number of threads",
+                    this->number_of_threads,
+                    "Maximum number of threads used in the assembly. A "
+                    "non-positive number means that all available cores are "
+                    "used.");
     }
 
 
@@ -160,61 +171,74 @@ namespace PDEs
             QGauss<dim - 1>(finite_element().tensor_degree() + 1);
         }
 
-      FEValues<dim, dim> fe_values(*mapping,
-                                   finite_element,
-                                   quadrature_formula,
-                                   update_values | update_gradients |
-                                     update_quadrature_points |
-                                     update_JxW_values);
-
-      const unsigned int dofs_per_cell = finite_element().n_dofs_per_cell();
-      FullMatrix<double> cell_matrix(dofs_per_cell, dofs_per_cell);
-      Vector<double>     cell_rhs(dofs_per_cell);
-      std::vector<types::global_dof_index> local_dof_indices(dofs_per_cell);
-      for (const auto &cell : dof_handler.active_cell_iterators())
-        {
-          fe_values.reinit(cell);
-          cell_matrix = 0;
-          cell_rhs    = 0;
-          for (const unsigned int q_index :
-               fe_values.quadrature_point_indices())
-            {
-              for (const unsigned int i : fe_values.dof_indices())
-                {
-                  const auto &eps_v = fe_values[velocity].gradient(i, q_index);
-                  const auto &div_v =
-                    fe_values[velocity].divergence(i, q_index);
-                  const auto &q = fe_values[pressure].value(i, q_index);
-
-                  for (const unsigned int j : fe_values.dof_indices())
-                    {
-                      const auto &eps_u =
-                        fe_values[velocity].gradient(j, q_index);
-                      const auto &div_u =
-                        fe_values[velocity].divergence(j, q_index);
-                      const auto &p = fe_values[pressure].value(j, q_index);
-                      cell_matrix(i, j) +=
-                        (constants["eta"] * scalar_product(eps_v, eps_u) -
-                         p * div_v - q * div_u + q * p / constants["eta"]) *
-                        fe_values.JxW(q_index); // dx
-                    }
-
-                  cell_rhs(i) +=
-                    (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-                     forcing_term.value(fe_values.quadrature_point(q_index),
-                                        finite_element()
-                                          .system_to_component_index(i)
-                                          .first) * // f(x_q)
-                     fe_values.JxW(q_index));       // dx
-                }
-            }
-          cell->get_dof_indices(local_dof_indices);
-          constraints.distribute_local_to_global(cell_matrix,
-                                                 cell_rhs,
-                                                 local_dof_indices,
-                                                 system_matrix,
-                                                 system_rhs);
-        }
+      using ScratchData = MeshWorker::ScratchData<dim>;
+      using CopyData    = MeshWorker::CopyData<1, 1, 1>;
+
+      ScratchData scratch(*mapping,
+                          finite_element(),
+                          quadrature_formula,
+                          update_values | update_gradients |
+                            update_quadrature_points | update_JxW_values);
+
+      CopyData copy(finite_element().n_dofs_per_cell());
+
+      // Look up the viscosity once, outside of the cell loop
+      const double eta = constants["eta"];
+
+      // The cell loop runs in parallel on all available threads
+      auto worker = [&](const auto &cell, auto &scratch, auto &copy) {
+        const auto &fe_values   = scratch.reinit(cell);
+        auto       &cell_matrix = copy.matrices[0];
+        auto       &cell_rhs    = copy.vectors[0];
+        cell_matrix             = 0;
+        cell_rhs                = 0;
+        for (const unsigned int q_index : fe_values.quadrature_point_indices())
+          {
+            for (const unsigned int i : fe_values.dof_indices())
+              {
+                const auto &eps_v = fe_values[velocity].gradient(i, q_index);
+                const auto &div_v = fe_values[velocity].divergence(i, q_index);
+                const auto &q     = fe_values[pressure].value(i, q_index);
+
+                for (const unsigned int j : fe_values.dof_indices())
+                  {
+                    const auto &eps_u =
+                      fe_values[velocity].gradient(j, q_index);
+                    const auto &div_u =
+                      fe_values[velocity].divergence(j, q_index);
+                    const auto &p = fe_values[pressure].value(j, q_index);
+                    cell_matrix(i, j) +=
+                      (eta * scalar_product(eps_v, eps_u) - p * div_v -
+                       q * div_u + q * p / eta) *
+                      fe_values.JxW(q_index); // dx
+                  }
+
+                cell_rhs(i) +=
+                  (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+                   forcing_term.value(fe_values.quadrature_point(q_index),
+                                      finite_element()
+                                        .system_to_component_index(i)
+                                        .first) * // f(x_q)
+                   fe_values.JxW(q_index));       // dx
+              }
+          }
+        cell->get_dof_indices(copy.local_dof_indices[0]);
+      };
+
+      auto copier = [&](const CopyData &copy) {
+        constraints.distribute_local_to_global(copy.matrices[0],
+                                               copy.vectors[0],
+                                               copy.local_dof_indices[0],
+                                               system_matrix,
+                                               system_rhs);
+      };
+
+      WorkStream::run(dof_handler.begin_active(),
+                      dof_handler.end(),
+                      worker,
+                      copier,
+                      scratch,
+                      copy);
     }
 
 
@@ -325,6 +349,8 @@ namespace PDEs
     {
       deallog.pop();
       deallog.depth_console(console_level);
+      if (number_of_threads > 0)
+        MultithreadInfo::set_thread_limit(number_of_threads);
       grid_generator.generate(triangulation);
       for (unsigned int cycle = 0;
            cycle < grid_refinement.get_n_refinement_cycles();
@@ -0,0 +1,201 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "pdes/shape_cache.h"
+
+#include <string>
+
+using namespace dealii;
+
+namespace PDEs
+{
+  template <int dim, int spacedim>
+  void
+  VectorShapeCache<dim, spacedim>::reinit(
+    const FEValuesBase<dim, spacedim> &fe_values,
+    const FEValuesExtractors::Vector  &extractor)
+  {
+    const auto        &fe    = fe_values.get_fe();
+    const unsigned int first = extractor.first_vector_component;
+
+    dofs.clear();
+    for (unsigned int i = 0; i < fe.n_dofs_per_cell(); ++i)
+      {
+        const auto &nonzero = fe.get_nonzero_components(i);
+        for (unsigned int d = 0; d < spacedim; ++d)
+          if (nonzero[first + d])
+            {
+              dofs.push_back(i);
+              break;
+            }
+      }
+
+    const unsigned int n_q_points = fe_values.n_quadrature_points;
+    const auto        &field      = fe_values[extractor];
+    const auto         flags      = fe_values.get_update_flags();
+
+    if (flags & update_values)
+      {
+        values.reinit(n_q_points, dofs.size());
+        for (unsigned int q = 0; q < n_q_points; ++q)
+          for (unsigned int k = 0; k < dofs.size(); ++k)
+            values(q, k) = field.value(dofs[k], q);
+      }
+
+    if (flags & update_gradients)
+      {
+        symmetric_gradients.reinit(n_q_points, dofs.size());
+        divergences.reinit(n_q_points, dofs.size());
+        for (unsigned int q = 0; q < n_q_points; ++q)
+          for (unsigned int k = 0; k < dofs.size(); ++k)
+            {
+              symmetric_gradients(q, k) = field.symmetric_gradient(dofs[k], q);
+              divergences(q, k)         = field.divergence(dofs[k], q);
+            }
+      }
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  ScalarShapeCache<dim, spacedim>::reinit(
+    const FEValuesBase<dim, spacedim> &fe_values,
+    const FEValuesExtractors::Scalar  &extractor)
+  {
+    const auto &fe = fe_values.get_fe();
+
+    dofs.clear();
+    for (unsigned int i = 0; i < fe.n_dofs_per_cell(); ++i)
+      if (fe.get_nonzero_components(i)[extractor.component])
+        dofs.push_back(i);
+
+    const unsigned int n_q_points = fe_values.n_quadrature_points;
+    const auto        &field      = fe_values[extractor];
+    const auto         flags      = fe_values.get_update_flags();
+
+    if (flags & update_values)
+      {
+        values.reinit(n_q_points, dofs.size());
+        for (unsigned int q = 0; q < n_q_points; ++q)
+          for (unsigned int k = 0; k < dofs.size(); ++k)
+            values(q, k) = field.value(dofs[k], q);
+      }
+
+    if (flags & update_gradients)
+      {
+        gradients.reinit(n_q_points, dofs.size());
+        for (unsigned int q = 0; q < n_q_points; ++q)
+          for (unsigned int k = 0; k < dofs.size(); ++k)
+            gradients(q, k) = field.gradient(dofs[k], q);
+      }
+  }
+
+
+
+  template <int dim, int spacedim>
+  const VectorShapeCache<dim, spacedim> &
+  reinit_shape_cache(MeshWorker::ScratchData<dim, spacedim> &scratch,
+                     const FEValuesExtractors::Vector       &extractor)
+  {
+    auto &cache =
+      scratch.get_general_data_storage()
+        .template get_or_add_object_with_name<VectorShapeCache<dim, spacedim>>(
+          "PDEs::VectorShapeCache " +
+          std::to_string(extractor.first_vector_component));
+    cache.reinit(scratch.get_current_fe_values(), extractor);
+    return cache;
+  }
+
+
+
+  template <int dim, int spacedim>
+  const ScalarShapeCache<dim, spacedim> &
+  reinit_shape_cache(MeshWorker::ScratchData<dim, spacedim> &scratch,
+                     const FEValuesExtractors::Scalar       &extractor)
+  {
+    auto &cache =
+      scratch.get_general_data_storage()
+        .template get_or_add_object_with_name<ScalarShapeCache<dim, spacedim>>(
+          "PDEs::ScalarShapeCache " + std::to_string(extractor.component));
+    cache.reinit(scratch.get_current_fe_values(), extractor);
+    return cache;
+  }
+
+
+
+  void
+  mirror_lower_triangle(FullMatrix<double> &matrix)
+  {
+    AssertDimension(matrix.m(), matrix.n());
+    for (unsigned int i = 0; i < matrix.m(); ++i)
+      for (unsigned int j = 0; j < i; ++j)
+        matrix(j, i) = matrix(i, j);
+  }
+
+
+
+  template class VectorShapeCache<1, 1>;
+  template class VectorShapeCache<1, 2>;
+  template class VectorShapeCache<1, 3>;
+  template class VectorShapeCache<2, 2>;
+  template class VectorShapeCache<2, 3>;
+  template class VectorShapeCache<3, 3>;
+
+  template class ScalarShapeCache<1, 1>;
+  template class ScalarShapeCache<1, 2>;
+  template class ScalarShapeCache<1, 3>;
+  template class ScalarShapeCache<2, 2>;
+  template class ScalarShapeCache<2, 3>;
+  template class ScalarShapeCache<3, 3>;
+
+  template const VectorShapeCache<1, 1> &
+  reinit_shape_cache(MeshWorker::ScratchData<1, 1> &,
+                     const FEValuesExtractors::Vector &);
+  template const VectorShapeCache<1, 2> &
+  reinit_shape_cache(MeshWorker::ScratchData<1, 2> &,
+                     const FEValuesExtractors::Vector &);
+  template const VectorShapeCache<1, 3> &
+  reinit_shape_cache(MeshWorker::ScratchData<1, 3> &,
+                     const FEValuesExtractors::Vector &);
+  template const VectorShapeCache<2, 2> &
+  reinit_shape_cache(MeshWorker::ScratchData<2, 2> &,
+                     const FEValuesExtractors::Vector &);
+  template const VectorShapeCache<2, 3> &
+  reinit_shape_cache(MeshWorker::ScratchData<2, 3> &,
+                     const FEValuesExtractors::Vector &);
+  template const VectorShapeCache<3, 3> &
+  reinit_shape_cache(MeshWorker::ScratchData<3, 3> &,
+                     const FEValuesExtractors::Vector &);
+
+  template const ScalarShapeCache<1, 1> &
+  reinit_shape_cache(MeshWorker::ScratchData<1, 1> &,
+                     const FEValuesExtractors::Scalar &);
+  template const ScalarShapeCache<1, 2> &
+  reinit_shape_cache(MeshWorker::ScratchData<1, 2> &,
+                     const FEValuesExtractors::Scalar &);
+  template const ScalarShapeCache<1, 3> &
+  reinit_shape_cache(MeshWorker::ScratchData<1, 3> &,
+                     const FEValuesExtractors::Scalar &);
+  template const ScalarShapeCache<2, 2> &
+  reinit_shape_cache(MeshWorker::ScratchData<2, 2> &,
+                     const FEValuesExtractors::Scalar &);
+  template const ScalarShapeCache<2, 3> &
+  reinit_shape_cache(MeshWorker::ScratchData<2, 3> &,
+                     const FEValuesExtractors::Scalar &);
+  template const ScalarShapeCache<3, 3> &
+  reinit_shape_cache(MeshWorker::ScratchData<3, 3> &,
+                     const FEValuesExtractors::Scalar &);
+} // namespace PDEs
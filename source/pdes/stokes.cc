@@ -19,7 +19,10 @@
 
 #include <deal.II/lac/linear_operator_tools.h>
 
+#include <algorithm>
+
 #include "parsed_tools/components.h"
+#include "pdes/shape_cache.h"
 
 using namespace dealii;
 
@@ -36,6 +39,7 @@ namespace PDEs
                    "cg",
                    ParsedLAC::SolverControlType::iteration_number,
                    5)
+    , viscosity(constants.get_handle("eta"))
     , velocity(0)
     , pressure(dim)
   {
@@ -82,42 +86,62 @@ namespace PDEs
 
     cell->get_dof_indices(copy.local_dof_indices[0]);
 
-    const auto &fe_values = scratch.reinit(cell);
-    cell_matrix           = 0;
-    cell_rhs              = 0;
-
+    const auto  &fe_values = scratch.reinit(cell);
+    const auto  &u_shapes  = reinit_shape_cache(scratch, velocity);
+    const auto  &p_shapes  = reinit_shape_cache(scratch, pressure);
+    const auto  &u_dofs    = u_shapes.get_dofs();
+    const auto  &p_dofs    = p_shapes.get_dofs();
+    const double eta       = viscosity;
+    cell_matrix            = 0;
+    cell_rhs               = 0;
+
+    // The bilinear form is symmetric: only assemble the lower triangle. We
+    // assemble also the mass matrix for the pressure, to be used as a
+    // preconditioner.
     for (const unsigned int q_index : fe_values.quadrature_point_indices())
       {
-        for (const unsigned int i : fe_values.dof_indices())
-          {
-            const auto &eps_v =
-              fe_values[velocity].symmetric_gradient(i, q_index);
-            const auto &div_v = fe_values[velocity].divergence(i, q_index);
-            const auto &q     = fe_values[pressure].value(i, q_index);
+        const double JxW = fe_values.JxW(q_index);
 
-            for (const unsigned int j : fe_values.dof_indices())
+        for (unsigned int k = 0; k < u_shapes.n_dofs(); ++k)
+          {
+            const unsigned int i     = u_dofs[k];
+            const auto        &eps_v = u_shapes.symmetric_gradient(k, q_index);
+            const double       div_v = u_shapes.divergence(k, q_index);
+
+            for (unsigned int l = 0; l <= k; ++l)
+              cell_matrix(i, u_dofs[l]) +=
+                eta *
+                scalar_product(eps_v,
+                               u_shapes.symmetric_gradient(l, q_index)) *
+                JxW; // dx
+
+            // Velocity and pressure shape functions are distinct
+            for (unsigned int l = 0; l < p_shapes.n_dofs(); ++l)
               {
-                const auto &eps_u =
-                  fe_values[velocity].symmetric_gradient(j, q_index);
-                const auto &div_u = fe_values[velocity].divergence(j, q_index);
-                const auto &p     = fe_values[pressure].value(j, q_index);
-                // We assemble also the mass matrix for the pressure, to be
-                // used as a preconditioner
-                cell_matrix(i, j) +=
-                  (constants["eta"] * scalar_product(eps_v, eps_u) - div_v * p -
-                   div_u * q + p * q / constants["eta"]) *
-                  fe_values.JxW(q_index); // dx
+                const unsigned int j = p_dofs[l];
+                cell_matrix(std::max(i, j), std::min(i, j)) -=
+                  div_v * p_shapes.value(l, q_index) * JxW; // dx
               }
+          }
 
-            cell_rhs(i) +=
-              (fe_values.shape_value(i, q_index) * // phi_i(x_q)
-               this->forcing_term.value(fe_values.quadrature_point(q_index),
-                                        this->finite_element()
-                                          .system_to_component_index(i)
-                                          .first) * // f(x_q)
-               fe_values.JxW(q_index));             // dx
+        for (unsigned int k = 0; k < p_shapes.n_dofs(); ++k)
+          {
+            const double q = p_shapes.value(k, q_index);
+            for (unsigned int l = 0; l <= k; ++l)
+              cell_matrix(p_dofs[k], p_dofs[l]) +=
+                p_shapes.value(l, q_index) * q / eta * JxW; // dx
           }
+
+        for (const unsigned int i : fe_values.dof_indices())
+          cell_rhs(i) +=
+            (fe_values.shape_value(i, q_index) * // phi_i(x_q)
+             this->forcing_term.value(fe_values.quadrature_point(q_index),
+                                      this->finite_element()
+                                        .system_to_component_index(i)
+                                        .first) * // f(x_q)
+             JxW);                                // dx
       }
+    mirror_lower_triangle(cell_matrix);
   }
 
 
@@ -162,10 +186,23 @@ namespace PDEs
     // AA.block(1, 1) *= 0;
 
 
-    this->preconditioner.initialize(m.block(0, 0));
-    schur_preconditioner.initialize(m.block(1, 1));
+    // With a direct solver, the velocity block is inverted exactly
+    auto &single_precision = this->single_precision_preconditioner;
+    if (this->direct_solver.enabled())
+      this->direct_solver.initialize(m.block(0, 0));
+    else if (!this->reuse_preconditioner && single_precision.enabled())
+      single_precision.initialize(m.block(0, 0));
+    else if (!this->reuse_preconditioner)
+      this->preconditioner.initialize(m.block(0, 0));
+
+    if (!this->reuse_preconditioner)
+      schur_preconditioner.initialize(m.block(1, 1));
 
     auto precA = linear_operator<Vec>(A, this->preconditioner);
+    if (this->direct_solver.enabled())
+      precA = linear_operator<Vec>(A, this->direct_solver);
+    else if (single_precision.enabled())
+      precA = linear_operator<Vec>(A, single_precision);
 
     const auto S     = -1.0 * B * precA * Bt;
     auto       precM = linear_operator<Vec>(Mp, schur_preconditioner);
@@ -182,12 +219,14 @@ namespace PDEs
     if (this->inverse_operator.get_solver_name() != "minres")
       {
         const auto precAA = block_forward_substitution(AA, diagprecAA);
-        const auto inv    = this->inverse_operator(AA, precAA);
-        this->solution    = inv * this->rhs;
+        const auto inv =
+          this->inverse_operator(AA, precAA, this->solver_tolerance);
+        this->solution = inv * this->rhs;
       }
     else
       {
-        const auto inv = this->inverse_operator(AA, diagprecAA);
+        const auto inv =
+          this->inverse_operator(AA, diagprecAA, this->solver_tolerance);
         this->solution = inv * this->rhs;
       }
 
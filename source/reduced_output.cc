@@ -0,0 +1,226 @@
+// ---------------------------------------------------------------------
+//
+// Copyright (C) 2022 by Luca Heltai
+//
+// This file is part of the FSI-suite platform, based on the deal.II library.
+//
+// The FSI-suite platform is free software; you can use it, redistribute it,
+// and/or modify it under the terms of the GNU Lesser General Public License as
+// published by the Free Software Foundation; either version 3.0 of the License,
+// or (at your option) any later version. The full text of the license can be
+// found in the file LICENSE at the top level of the FSI-suite platform
+// distribution.
+//
+// ---------------------------------------------------------------------
+
+#include "parsed_tools/reduced_output.h"
+
+#include <deal.II/base/utilities.h>
+
+#include <deal.II/grid/grid_tools.h>
+#include <deal.II/grid/grid_tools_cache.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace dealii;
+
+namespace ParsedTools
+{
+  template <int dim, int spacedim>
+  ReducedOutput<dim, spacedim>::ReducedOutput(
+    const std::string &section_name,
+    const std::string &component_names,
+    const std::string &base_name,
+    const MPI_Comm    &comm)
+    : ParameterAcceptor(section_name)
+    , component_names(Utilities::split_string_list(component_names))
+    , n_components(this->component_names.size())
+    , comm(comm)
+    , base_name(base_name)
+    , integral_weights(section_name,
+                       Components::join(std::vector<std::string>(n_components,
+                                                                 "1"),
+                                        ";"),
+                       "Integral weights")
+  {
+    add_parameter("Base name", this->base_name, "Prefix of the output files.");
+
+    add_parameter("Probe points",
+                  probe_points,
+                  "Points where all components of the solution are written "
+                  "at every output step.");
+
+    add_parameter("Line samples",
+                  line_samples,
+                  "Segments where the solution is sampled, given as start "
+                  "point : end point : number of equally spaced samples.");
+
+    add_parameter("Boundary ids",
+                  boundary_ids,
+                  "Boundary ids where the weighted integral of each "
+                  "component is computed.");
+
+    add_parameter("Volume integrals",
+                  volume_integrals,
+                  "Compute the weighted integral of each component on the "
+                  "whole domain.");
+  }
+
+
+
+  template <int dim, int spacedim>
+  bool
+  ReducedOutput<dim, spacedim>::enabled() const
+  {
+    return !probe_points.empty() || !line_samples.empty() ||
+           !boundary_ids.empty() || volume_integrals;
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  ReducedOutput<dim, spacedim>::set_append(const bool append)
+  {
+    this->append = append;
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  ReducedOutput<dim, spacedim>::update_cache(
+    const Mapping<dim, spacedim>    &mapping,
+    const DoFHandler<dim, spacedim> &dof_handler)
+  {
+    sample_points = probe_points;
+    for (const auto &[start, end, n_samples] : line_samples)
+      {
+        AssertThrow(n_samples > 1,
+                    ExcMessage("Each line sample needs at least two points."));
+        for (unsigned int i = 0; i < n_samples; ++i)
+          sample_points.emplace_back(start +
+                                     (end - start) * (i / (n_samples - 1.0)));
+      }
+
+    const auto &tria = dof_handler.get_triangulation();
+    const GridTools::Cache<dim, spacedim> cache(tria, mapping);
+
+    cached_points.clear();
+    n_owners.assign(sample_points.size(), 0.0);
+    for (unsigned int i = 0; i < sample_points.size(); ++i)
+      {
+        try
+          {
+            const auto [cell, reference_point] =
+              GridTools::find_active_cell_around_point(cache,
+                                                       sample_points[i]);
+            if (cell.state() == IteratorState::valid &&
+                cell->is_locally_owned())
+              {
+                CachedPoint point;
+                point.index = i;
+                point.cell  = typename DoFHandler<dim, spacedim>::
+                  active_cell_iterator(&tria,
+                                       cell->level(),
+                                       cell->index(),
+                                       &dof_handler);
+                point.fe_values =
+                  std::make_unique<FEValues<dim, spacedim>>(
+                    mapping,
+                    dof_handler.get_fe(),
+                    Quadrature<dim>(reference_point),
+                    update_values);
+                cached_points.emplace_back(std::move(point));
+                n_owners[i] = 1.0;
+              }
+          }
+        catch (...)
+          {
+            // The point is not in the locally known part of the domain.
+          }
+      }
+    Utilities::MPI::sum(n_owners, comm, n_owners);
+    for (unsigned int i = 0; i < sample_points.size(); ++i)
+      AssertThrow(n_owners[i] > 0,
+                  ExcMessage("The sample point " +
+                             Patterns::Tools::to_string(sample_points[i]) +
+                             " is not inside the domain."));
+
+    cached_dof_handler = &dof_handler;
+    cached_mapping     = &mapping;
+    cached_n_dofs      = dof_handler.n_dofs();
+    cache_is_valid     = true;
+    triangulation_connection =
+      tria.signals.any_change.connect([&]() { cache_is_valid = false; });
+  }
+
+
+
+  template <int dim, int spacedim>
+  void
+  ReducedOutput<dim, spacedim>::open_files()
+  {
+    // Open a file, and return true if its header line must be written
+    const auto open = [&](std::ofstream &out, const std::string &name) {
+      const bool empty = !append || !std::filesystem::exists(name) ||
+                         std::filesystem::file_size(name) == 0;
+      out.open(name, append ? std::ios::app : std::ios::out);
+      AssertThrow(out, ExcFileNotOpen(name));
+      out << std::setprecision(16);
+      return empty;
+    };
+    const auto header = [&](std::ofstream &out, const std::string &prefix) {
+      for (const auto &name : component_names)
+        out << ", " << prefix << name;
+    };
+
+    if (!probe_points.empty())
+      if (open(probes_file, base_name + "_probes.csv"))
+        {
+          probes_file << "time";
+          for (unsigned int i = 0; i < probe_points.size(); ++i)
+            header(probes_file, "p" + std::to_string(i) + "_");
+          probes_file << std::endl;
+        }
+
+    line_files.clear();
+    for (unsigned int l = 0; l < line_samples.size(); ++l)
+      {
+        line_files.emplace_back(std::make_unique<std::ofstream>());
+        auto &out = *line_files.back();
+        if (open(out, base_name + "_line_" + std::to_string(l) + ".csv"))
+          {
+            out << "time";
+            for (unsigned int i = 0; i < std::get<2>(line_samples[l]); ++i)
+              header(out, "s" + std::to_string(i) + "_");
+            out << std::endl;
+          }
+      }
+
+    if (volume_integrals || !boundary_ids.empty())
+      if (open(integrals_file, base_name + "_integrals.csv"))
+        {
+          integrals_file << "time";
+          if (volume_integrals)
+            header(integrals_file, "volume_");
+          for (const auto id : boundary_ids)
+            header(integrals_file, "boundary_" + std::to_string(id) + "_");
+          integrals_file << std::endl;
+        }
+    files_are_open = true;
+  }
+
+
+
+  template class ReducedOutput<1, 1>;
+  template class ReducedOutput<1, 2>;
+  template class ReducedOutput<1, 3>;
+  template class ReducedOutput<2, 2>;
+  template class ReducedOutput<2, 3>;
+  template class ReducedOutput<3, 3>;
+} // namespace ParsedTools
@@ -21,11 +21,48 @@
 #include <deal.II/base/parameter_handler.h>
 #include <deal.II/base/utilities.h>
 
+#include <string>
+#include <vector>
+
 #include "argh.hpp"
 #include "text_flow.hpp"
 
 using namespace dealii;
 
+namespace
+{
+  /**
+   * Return true if @p arg is the `-r` or `--restart` flag.
+   */
+  bool
+  is_restart_flag(const std::string &arg)
+  {
+    return arg == "-r" || arg == "--r" || arg == "-restart" ||
+           arg == "--restart";
+  }
+
+
+
+  /**
+   * Parse the command line, skipping the `-r` or `--restart` flag. Options
+   * that are not registered take the next argument as their value, so that
+   * `-r input.prm` would otherwise swallow the parameter file.
+   */
+  argh::parser
+  parse_command_line(char **argv)
+  {
+    std::vector<const char *> args;
+    for (char **arg = argv; *arg != nullptr; ++arg)
+      if (!is_restart_flag(*arg))
+        args.push_back(*arg);
+    args.push_back(nullptr);
+
+    argh::parser cli;
+    cli.parse(args.data(), argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+    return cli;
+  }
+} // namespace
+
 namespace Runner
 {
   /**
@@ -88,7 +125,7 @@ namespace Runner
   std::tuple<int, int, std::string, std::string>
   get_dimensions_and_parameter_files(char **argv)
   {
-    argh::parser cli(argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+    auto         cli                   = parse_command_line(argv);
     unsigned int dim                   = 2;
     unsigned int spacedim              = 2;
     std::string  input_parameter_file  = "";
@@ -184,7 +221,7 @@ namespace Runner
                             const std::string &input_parameter_file,
                             const std::string &output_parameter_file)
   {
-    argh::parser cli(argv, argh::parser::PREFER_PARAM_FOR_UNREG_OPTION);
+    auto cli = parse_command_line(argv);
     ParameterAcceptor::initialize(input_parameter_file, output_parameter_file);
 
     if (cli[{"h", "help"}])
@@ -225,6 +262,9 @@ namespace Runner
                "-s, --spacedim <value>",
                "Space dimension at which this program should run. Defaults to 2.")
           << std::endl
+          << format("-r, --restart",
+                    "Restart the simulation from the last saved checkpoint.")
+          << std::endl
           << format(
                "-\"Section/option name\"=<value>",
                "Any of the options that you can specify in the parameter file. "
@@ -251,6 +291,8 @@ namespace Runner
                                   "dim",
                                   "s",
                                   "spacedim",
+                                  "r",
+                                  "restart",
                                   "pause"};
     for (auto &p : cli.params())
       if (non_prm.find(p.first) == non_prm.end())
@@ -298,4 +340,15 @@ namespace Runner
     // Everything went fine, so return 0 or 1
     return ret;
   }
+
+
+
+  bool
+  restart_requested(char **argv)
+  {
+    for (char **arg = argv; *arg != nullptr; ++arg)
+      if (is_restart_flag(*arg))
+        return true;
+    return false;
+  }
 } // namespace Runner
\ No newline at end of file